@@ -59,10 +59,10 @@ GLuint InitShader( const char* vertexShaderFile,
 //  Defined constant for when numbers are too small to be used in the
 //    denominator of a division operation.  This is only used if the
 //    DEBUG macro is defined.
-const GLfloat  DivideByZeroTolerance = GLfloat(1.0e-07);
+constexpr GLfloat  DivideByZeroTolerance = GLfloat(1.0e-07);
 
 //  Degrees-to-radians constant 
-const GLfloat  DegreesToRadians = M_PI / 180.0;
+constexpr GLfloat  DegreesToRadians = M_PI / 180.0;
 
 }  // namespace Angel
 
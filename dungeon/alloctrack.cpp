@@ -0,0 +1,257 @@
+#define ALLOC_TRACK_IMPLEMENTATION
+#include "alloctrack.h"
+
+#ifdef ENABLE_ALLOC_TRACKING
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <malloc.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+// counts of one subsystem, the frees are those done by the subsystem
+struct AllocSubsystem
+{
+	const char* name; // NULL for the allocations outside any scope
+	std::atomic<long long> allocations, frees, bytes;
+};
+
+// everything here is zero before the static constructors run, new may come first
+static AllocSubsystem subsystems[maxAllocSubsystems];
+static std::atomic<int> nSubsystems;
+static std::mutex subsystemsMutex; // guards adding subsystems
+static std::atomic<long long> totalAllocations, totalFrees, totalBytes, currentBytes, peakBytes;
+static std::atomic<long long> assetPeakBytes; // peak since the start of the asset being loaded
+
+static thread_local int threadSubsystem = 0;
+static thread_local const char* threadSubsystemName = NULL;
+static thread_local long long threadAllocations = 0;
+
+// frames checked by AllocFrame
+static int frames = 0;
+static long long frameAllocationsMax = 0; // high water of the allocations in a frame
+static int allocatingFrames = 0;          // frames allocating after the warm-up
+
+// usable size of a heap block
+static size_t blockSize(void* memory)
+{
+#ifdef _WIN32
+	return _msize(memory);
+#else
+	return malloc_usable_size(memory);
+#endif
+}
+
+// raise the peak to the value
+static void raisePeak(std::atomic<long long>& peak, long long value)
+{
+	long long old = peak.load(std::memory_order_relaxed);
+	while(value > old && !peak.compare_exchange_weak(old, value, std::memory_order_relaxed));
+}
+
+// count an allocation of the calling thread
+void allocTrack(size_t size)
+{
+	AllocSubsystem& subsystem = subsystems[threadSubsystem];
+	subsystem.allocations.fetch_add(1, std::memory_order_relaxed);
+	subsystem.bytes.fetch_add(size, std::memory_order_relaxed);
+	totalAllocations.fetch_add(1, std::memory_order_relaxed);
+	totalBytes.fetch_add(size, std::memory_order_relaxed);
+	long long current = currentBytes.fetch_add(size, std::memory_order_relaxed) + size;
+	raisePeak(peakBytes, current);
+	raisePeak(assetPeakBytes, current);
+	threadAllocations++;
+}
+
+// count a free of the calling thread
+void allocUntrack(size_t size)
+{
+	subsystems[threadSubsystem].frees.fetch_add(1, std::memory_order_relaxed);
+	totalFrees.fetch_add(1, std::memory_order_relaxed);
+	currentBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+// totals of all subsystems
+AllocStats allocTotals()
+{
+	AllocStats stats;
+	stats.allocations = totalAllocations.load();
+	stats.frees = totalFrees.load();
+	stats.bytes = totalBytes.load();
+	stats.currentBytes = currentBytes.load();
+	stats.peakBytes = peakBytes.load();
+	return stats;
+}
+
+// make the named subsystem the current one of the calling thread, returns the previous name
+const char* allocSetSubsystem(const char* name)
+{
+	const char* previous = threadSubsystemName;
+	threadSubsystemName = name;
+	threadSubsystem = 0;
+	if(!name) return previous;
+
+	int n = nSubsystems.load(std::memory_order_acquire);
+	for(int i = 1; i < n; i++)
+	{
+		if(subsystems[i].name == name || !strcmp(subsystems[i].name, name))
+		{
+			threadSubsystem = i;
+			return previous;
+		}
+	}
+
+	// add it, the others see it once the count is raised
+	std::lock_guard<std::mutex> lock(subsystemsMutex);
+	n = nSubsystems.load();
+	for(int i = 1; i < n; i++)
+	{
+		if(!strcmp(subsystems[i].name, name)) threadSubsystem = i;
+	}
+	if(!threadSubsystem && n < maxAllocSubsystems)
+	{
+		int index = n > 0 ? n : 1; // the first slot is for the allocations outside any scope
+		subsystems[index].name = name;
+		nSubsystems.store(index + 1, std::memory_order_release);
+		threadSubsystem = index;
+	}
+	return previous;
+}
+
+// allocations of the calling thread so far
+long long allocThreadCount()
+{
+	return threadAllocations;
+}
+
+// count the frame and check it did not allocate
+AllocFrame::~AllocFrame()
+{
+	long long count = allocThreadCount() - start;
+	if(count > frameAllocationsMax) frameAllocationsMax = count;
+	if(++frames > allocWarmupFrames && count > 0)
+	{
+		if(!allocatingFrames++) fprintf(stderr, "alloc: frame %d allocated %lld times after the warm-up\n", frames, count);
+		assert(count == 0 && "the frame allocated after the warm-up");
+	}
+}
+
+AllocAsset::AllocAsset(const char* name) : name(name), start(allocTotals())
+{
+	assetPeakBytes.store(start.currentBytes);
+}
+
+// what loading the asset allocated
+AllocAsset::~AllocAsset()
+{
+	AllocStats end = allocTotals();
+	printf("alloc: %-24s %7lld allocations %7lld frees %10lld bytes %10lld peak %10lld kept\n", name, end.allocations - start.allocations, end.frees - start.frees,
+		end.bytes - start.bytes, assetPeakBytes.load() - start.currentBytes, end.currentBytes - start.currentBytes);
+}
+
+// print the totals, the subsystems and the frames
+void allocReport()
+{
+	AllocStats stats = allocTotals();
+	printf("alloc: %lld allocations, %lld frees, %lld bytes allocated, %lld bytes still allocated, %lld bytes peak\n",
+		stats.allocations, stats.frees, stats.bytes, stats.currentBytes, stats.peakBytes);
+	printf("alloc: %d frames, at most %lld allocations in a frame, %d frames allocating after the warm-up\n", frames, frameAllocationsMax, allocatingFrames);
+
+	printf("%-20s %12s %12s %14s\n", "subsystem", "allocations", "frees", "bytes");
+	int n = nSubsystems.load() > 0 ? nSubsystems.load() : 1;
+	for(int i = 0; i < n; i++)
+	{
+		const AllocSubsystem& subsystem = subsystems[i];
+		printf("%-20s %12lld %12lld %14lld\n", subsystem.name ? subsystem.name : "(other)", subsystem.allocations.load(), subsystem.frees.load(), subsystem.bytes.load());
+	}
+}
+
+// the C allocation functions
+void* trackedMalloc(size_t size)
+{
+	void* memory = malloc(size);
+	if(memory) allocTrack(blockSize(memory));
+	return memory;
+}
+
+void* trackedCalloc(size_t count, size_t size)
+{
+	void* memory = calloc(count, size);
+	if(memory) allocTrack(blockSize(memory));
+	return memory;
+}
+
+void* trackedRealloc(void* memory, size_t size)
+{
+	size_t oldSize = memory ? blockSize(memory) : 0;
+	void* moved = realloc(memory, size);
+	if(moved)
+	{
+		if(memory) allocUntrack(oldSize);
+		allocTrack(blockSize(moved));
+	}
+	return moved;
+}
+
+void trackedFree(void* memory)
+{
+	if(!memory) return;
+	allocUntrack(blockSize(memory));
+	free(memory);
+}
+
+char* trackedStrdup(const char* string)
+{
+	size_t size = strlen(string) + 1;
+	char* copy = (char*)trackedMalloc(size);
+	if(copy) memcpy(copy, string, size);
+	return copy;
+}
+
+// every new and delete of the program
+void* operator new(size_t size)
+{
+	void* memory = trackedMalloc(size ? size : 1);
+	if(!memory) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return trackedMalloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return trackedMalloc(size ? size : 1);
+}
+
+void operator delete(void* memory) noexcept
+{
+	trackedFree(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	trackedFree(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	trackedFree(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	trackedFree(memory);
+}
+
+#endif // ENABLE_ALLOC_TRACKING
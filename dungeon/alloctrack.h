@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- alloctrack.h ---
+//
+//   Heap allocation tracking.  new/delete everywhere and malloc/free in the
+//   files including this header are counted per subsystem, ALLOC_SCOPE
+//   naming the subsystem of the enclosing scope.  ALLOC_FRAME() checks that
+//   the frame loop does not allocate after the warm-up (an assert in debug
+//   builds), ALLOC_ASSET(name) prints what loading an asset allocated and
+//   ALLOC_REPORT() prints the totals and the peaks.
+//
+//   Include it after the other headers, its malloc/free macros must not
+//   reach the standard headers.  Compiled out unless ENABLE_ALLOC_TRACKING
+//   is defined (-DENABLE_ALLOC_TRACKING).
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __ALLOCTRACK_H__
+#define __ALLOCTRACK_H__
+
+#ifdef ENABLE_ALLOC_TRACKING
+
+#include <stddef.h>
+
+const int maxAllocSubsystems = 16; // subsystems told apart
+const int allocWarmupFrames = 60;  // frames allowed to allocate at start
+
+// counts of the tracked allocations
+struct AllocStats
+{
+	long long allocations;
+	long long frees;
+	long long bytes;        // allocated in total
+	long long currentBytes; // still allocated
+	long long peakBytes;    // most allocated at once
+};
+
+void allocTrack(size_t size);
+void allocUntrack(size_t size);
+AllocStats allocTotals();
+const char* allocSetSubsystem(const char* name);
+long long allocThreadCount();
+void allocReport();
+
+void* trackedMalloc(size_t size);
+void* trackedCalloc(size_t count, size_t size);
+void* trackedRealloc(void* memory, size_t size);
+void trackedFree(void* memory);
+char* trackedStrdup(const char* string);
+
+// allocations of its scope go to the subsystem
+class AllocScope
+{
+public:
+	AllocScope(const char* name) : previous(allocSetSubsystem(name)) {}
+	~AllocScope() { allocSetSubsystem(previous); }
+
+private:
+	const char* previous;
+};
+
+// checks that its scope does not allocate once warmed up
+class AllocFrame
+{
+public:
+	AllocFrame() : start(allocThreadCount()) {}
+	~AllocFrame();
+
+private:
+	long long start;
+};
+
+// prints what its scope allocated
+class AllocAsset
+{
+public:
+	AllocAsset(const char* name);
+	~AllocAsset();
+
+private:
+	const char* name;
+	AllocStats start;
+};
+
+#define ALLOC_CONCAT2(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT2(a, b)
+#define ALLOC_SCOPE(name) AllocScope ALLOC_CONCAT(allocScope, __LINE__)(name)
+#define ALLOC_FRAME() AllocFrame ALLOC_CONCAT(allocFrame, __LINE__)
+#define ALLOC_ASSET(name) AllocAsset ALLOC_CONCAT(allocAsset, __LINE__)(name)
+#define ALLOC_REPORT() allocReport()
+
+// the C allocations of the including file
+#ifndef ALLOC_TRACK_IMPLEMENTATION
+#define malloc(size) trackedMalloc(size)
+#define calloc(count, size) trackedCalloc(count, size)
+#define realloc(memory, size) trackedRealloc(memory, size)
+#define free(memory) trackedFree(memory)
+#define strdup(string) trackedStrdup(string)
+#endif
+
+#else
+
+#define ALLOC_SCOPE(name)
+#define ALLOC_FRAME()
+#define ALLOC_ASSET(name)
+#define ALLOC_REPORT()
+
+#endif // ENABLE_ALLOC_TRACKING
+
+#endif // __ALLOCTRACK_H__
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "arena.h"
+#include "alloctrack.h"
+
+Arena::Arena() : overflows(0), memory(NULL), capacity(0), used(0), highWater(0)
+{
+}
+
+Arena::~Arena()
+{
+	destroy();
+}
+
+// allocate the block
+bool Arena::create(size_t capacity)
+{
+	destroy();
+	memory = (char*)malloc(capacity);
+	if(!memory) return false;
+	this->capacity = capacity;
+	return true;
+}
+
+// free the block
+void Arena::destroy()
+{
+	free(memory);
+	memory = NULL;
+	capacity = used = 0;
+}
+
+// aligned memory from the block, NULL if it is full
+void* Arena::allocate(size_t size, size_t alignment)
+{
+	size_t start = (used + alignment - 1) & ~(alignment - 1);
+	if(!memory || start + size > capacity)
+	{
+		overflows++;
+		return NULL;
+	}
+
+	used = start + size;
+	if(used > highWater) highWater = used;
+	return memory + start;
+}
+
+// release everything
+void Arena::reset()
+{
+	used = 0;
+}
+
+// print the use of the arena
+void Arena::report(const char* name) const
+{
+	printf("%s: %lu of %lu bytes at most, %d overflows\n", name, (unsigned long)highWater, (unsigned long)capacity, overflows);
+}
+
+// arena of the calling thread, created at its first use
+Arena& threadArena()
+{
+	static thread_local Arena arena;
+	if(!arena.getCapacity()) arena.create(threadArenaSize);
+	return arena;
+}
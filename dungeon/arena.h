@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- arena.h ---
+//
+//   Linear allocator for transient data.  Allocations bump a pointer in
+//   one block and are all released at once by reset(), or back to a mark
+//   by ArenaMark.  The frame arena is reset at the top of every frame, the
+//   thread arenas serve the scratch data of worker jobs.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+const size_t frameArenaSize = 4 << 20;  // bytes of the frame arena
+const size_t threadArenaSize = 1 << 20; // bytes of each thread arena
+
+// bump allocator over one block
+class Arena
+{
+public:
+	int overflows; // allocations that did not fit
+
+	Arena();
+	~Arena();
+
+	bool create(size_t capacity);
+	void destroy();
+
+	void* allocate(size_t size, size_t alignment = 16);
+	void reset();
+	void report(const char* name) const;
+
+	// memory for count values of the type, NULL if they do not fit
+	template<class T> T* allocateArray(size_t count)
+	{
+		return (T*)allocate(count * sizeof(T));
+	}
+
+	size_t getCapacity() const { return capacity; }
+	size_t getUsed() const { return used; }
+	size_t getHighWater() const { return highWater; }
+
+private:
+	friend class ArenaMark;
+
+	char* memory;
+	size_t capacity;
+	size_t used;
+	size_t highWater; // most bytes used at once
+};
+
+// releases the allocations made in its scope
+class ArenaMark
+{
+public:
+	ArenaMark(Arena& arena) : arena(arena), used(arena.used) {}
+	~ArenaMark() { arena.used = used; }
+
+private:
+	Arena& arena;
+	size_t used;
+};
+
+Arena& threadArena();
+
+#endif // __ARENA_H__
@@ -0,0 +1,919 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- benchmark.cpp ---
+//
+//   Benchmarks of the engine parts that run without a window: the model
+//   and texture loaders, the mesh processing of glm, the matrix functions
+//   of mat.h, the scene graph traversal and the bounding volume hierarchy.
+//   Every benchmark is repeated for a while and reported with its
+//   percentiles and throughput, the mesh and scene benchmarks over
+//   synthetic data sweeping the size.  Run it in this directory, it reads
+//   the data files.  The mat4 kernels are timed against their scalar
+//   references, build with -mavx for the AVX multiply and the 8-wide
+//   batch transforms.  The chained vector arithmetic is timed against the
+//   same code over floats, build with -DANGEL_EXPRESSION_TEMPLATES to time
+//   it and the normals of glm with the expression templates of vecexpr.h.  The per-object scene
+//   submission is timed through the null render device, which records the
+//   commands without a driver.
+//
+//   benchmark [-json file] [-max size] [-filter text]
+//
+//     -json file    also write the results to the file as JSON
+//     -max size     largest synthetic mesh in triangles (10000000) and
+//                   scene in objects (1000000)
+//     -filter text  run only the benchmarks whose name contains the text
+//
+//   Linux:  g++ -std=c++14 -O2 -I. benchmark.cpp bvh.cpp glm.cpp arena.cpp renderdevice.cpp InitShader.cpp -lGLEW -lGL -o benchmark
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "Angel.h"
+#include "bvh.h"
+#include "glm.h"
+#include "scene.h"
+#include "renderdevice.h"
+#include "timer.h"
+
+const double benchmarkBudget = 300; // milliseconds a benchmark is repeated for
+const int minRuns = 3;              // runs of every benchmark however long they take
+const int maxRuns = 100;            // runs of every benchmark however short they take
+const int weldLimit = 10000;        // largest mesh welded, glmWeld is quadratic in the vertices
+const int mathOperations = 100000;  // operations in one run of the matrix benchmarks
+
+// timing of one benchmark
+struct Result
+{
+	std::string name;          // benchmark and its size
+	const char* unit;          // what the items are
+	double items;              // items processed by one run
+	std::vector<double> times; // milliseconds of every run, sorted
+};
+
+static std::vector<Result> results;
+static const char* filter = NULL;     // text the names of the benchmarks run contain
+static int maxTriangles = 10000000;   // largest synthetic mesh
+static int maxObjects = 1000000;      // largest synthetic scene
+static volatile float sink;           // keeps the results of the matrix benchmarks alive
+
+// random number in the range a..b
+static float random(float a, float b)
+{
+	return a + (b - a) * (rand() / (float)RAND_MAX);
+}
+
+// name of a benchmark of the given size
+static std::string sized(const char* name, int size)
+{
+	char text[64];
+	sprintf(text, "%s/%d", name, size);
+	return text;
+}
+
+// whether the benchmark is run
+static bool selected(const std::string& name)
+{
+	return !filter || strstr(name.c_str(), filter);
+}
+
+// value below which the given fraction of the sorted times fall
+static double percentile(const std::vector<double>& times, double fraction)
+{
+	int index = (int)ceil(fraction * times.size()) - 1;
+	return times[std::max(0, std::min(index, (int)times.size() - 1))];
+}
+
+static double mean(const std::vector<double>& times)
+{
+	double sum = 0;
+	for(int i = 0; i < (int)times.size(); i++) sum += times[i];
+	return sum / times.size();
+}
+
+// keep and print the timing
+static void record(Result& result)
+{
+	std::sort(result.times.begin(), result.times.end());
+	double p50 = percentile(result.times, 0.5);
+	printf("%-36s %4d runs  p50 %10.4f ms  p95 %10.4f ms  p99 %10.4f ms  %10.4g %s/s\n", result.name.c_str(), (int)result.times.size(),
+		p50, percentile(result.times, 0.95), percentile(result.times, 0.99), result.items * 1000 / p50, result.unit);
+	fflush(stdout);
+	results.push_back(result);
+}
+
+static void noSetup()
+{
+}
+
+// time the run for a while, the untimed setup preparing every run
+template<class Setup, class Run> static void measure(const std::string& name, const char* unit, double items, Setup setup, Run run)
+{
+	if(!selected(name)) return;
+
+	Result result;
+	result.name = name;
+	result.unit = unit;
+	result.items = items;
+	double total = 0;
+	while((int)result.times.size() < minRuns || (total < benchmarkBudget && (int)result.times.size() < maxRuns))
+	{
+		setup();
+		double start = currentTime();
+		run();
+		double time = currentTime() - start;
+		result.times.push_back(time);
+		total += time;
+	}
+	record(result);
+}
+
+// write the results as JSON
+static bool writeJson(const char* filename)
+{
+	FILE* file = fopen(filename, "w");
+	if(!file) return false;
+
+	fprintf(file, "{\n\t\"benchmarks\": [\n");
+	for(int i = 0; i < (int)results.size(); i++)
+	{
+		const Result& result = results[i];
+		double p50 = percentile(result.times, 0.5);
+		fprintf(file, "\t\t{\"name\": \"%s\", \"unit\": \"%s\", \"items\": %.0f, \"runs\": %d, \"mean_ms\": %.6f, \"min_ms\": %.6f, "
+			"\"p50_ms\": %.6f, \"p95_ms\": %.6f, \"p99_ms\": %.6f, \"throughput\": %.6g}%s\n",
+			result.name.c_str(), result.unit, result.items, (int)result.times.size(), mean(result.times), result.times[0],
+			p50, percentile(result.times, 0.95), percentile(result.times, 0.99), result.items * 1000 / p50, i + 1 < (int)results.size() ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+	return true;
+}
+
+// side of the grid of about n triangles
+static int gridSide(int n)
+{
+	return std::max(1, (int)ceil(sqrt(n / 2.0)));
+}
+
+// wavy grid of about n triangles in one group, the triangles share their vertices unless separate
+static GLMmodel* gridModel(int n, bool separate)
+{
+	int side = gridSide(n);
+	GLMmodel* model = (GLMmodel*)calloc(1, sizeof(GLMmodel));
+	model->numtriangles = 2 * side * side;
+	model->numvertices = separate ? 3 * model->numtriangles : (side + 1) * (side + 1);
+	model->vertices = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (model->numvertices + 1));
+	model->triangles = (GLMtriangle*)calloc(model->numtriangles, sizeof(GLMtriangle));
+
+	GLMgroup* group = (GLMgroup*)calloc(1, sizeof(GLMgroup));
+	group->name = strdup("grid");
+	group->numtriangles = model->numtriangles;
+	group->triangles = (GLuint*)malloc(sizeof(GLuint) * model->numtriangles);
+	model->groups = group;
+	model->numgroups = 1;
+
+	// the shared grid points, the separate ones are written with the triangles
+	for(int z = 0; z <= side && !separate; z++)
+	{
+		for(int x = 0; x <= side; x++)
+		{
+			GLfloat* p = &model->vertices[3 * (1 + z * (side + 1) + x)];
+			p[0] = (GLfloat)x;
+			p[1] = 0.5f * sinf(0.3f * x) * cosf(0.2f * z);
+			p[2] = (GLfloat)z;
+		}
+	}
+
+	// two triangles facing up in every cell
+	GLuint next = 1;
+	for(int z = 0; z < side; z++)
+	{
+		for(int x = 0; x < side; x++)
+		{
+			int corners[6][2] = {{x, z}, {x, z + 1}, {x + 1, z}, {x + 1, z}, {x, z + 1}, {x + 1, z + 1}};
+			int t = 2 * (z * side + x);
+			for(int k = 0; k < 6; k++)
+			{
+				int cx = corners[k][0], cz = corners[k][1];
+				GLuint vertex = 1 + cz * (side + 1) + cx;
+				if(separate)
+				{
+					vertex = next++;
+					model->vertices[3 * vertex + 0] = (GLfloat)cx;
+					model->vertices[3 * vertex + 1] = 0.5f * sinf(0.3f * cx) * cosf(0.2f * cz);
+					model->vertices[3 * vertex + 2] = (GLfloat)cz;
+				}
+				model->triangles[t + k / 3].vindices[k % 3] = vertex;
+			}
+			group->triangles[t] = t;
+			group->triangles[t + 1] = t + 1;
+		}
+	}
+	return model;
+}
+
+// the loaders over the data files
+static void benchmarkLoaders()
+{
+	const char* names[] = {"ground", "building", "person", "flashlight", "room", "barrel", "chest"};
+	const int nNames = sizeof(names) / sizeof(names[0]);
+	char filename[256];
+
+	for(int i = 0; i < nNames; i++)
+	{
+		// the triangles of the model are the items
+		std::string name = std::string("glmReadOBJ/") + names[i];
+		if(!selected(name)) continue;
+		sprintf(filename, "data/%s.obj", names[i]);
+		GLMmodel* model = glmReadOBJ(filename);
+		int triangles = model->numtriangles;
+		glmDelete(model);
+
+		measure(name, "triangles", triangles, noSetup, [&]()
+		{
+			glmDelete(glmReadOBJ(filename));
+		});
+	}
+
+	for(int i = 0; i < nNames; i++)
+	{
+		// the pixels of the texture are the items
+		std::string name = std::string("glmReadPPM/") + names[i];
+		if(!selected(name)) continue;
+		sprintf(filename, "data/%s.ppm", names[i]);
+		int width, height;
+		GLubyte* data = glmReadPPM(filename, &width, &height);
+		if(!data) continue;
+		free(data);
+
+		measure(name, "pixels", (double)width * height, noSetup, [&]()
+		{
+			free(glmReadPPM(filename, &width, &height));
+		});
+	}
+}
+
+// mesh processing over synthetic meshes of n triangles
+static void benchmarkMesh(int n)
+{
+	GLMmodel* model = gridModel(n, false);
+	int triangles = model->numtriangles;
+
+	measure(sized("glmFacetNormals", n), "triangles", triangles, noSetup, [&]()
+	{
+		glmFacetNormals(model);
+	});
+
+	if(!model->facetnorms) glmFacetNormals(model);
+	measure(sized("glmVertexNormals", n), "triangles", triangles, noSetup, [&]()
+	{
+		glmVertexNormals(model, 90);
+	});
+
+	// read back what glmWriteOBJ writes
+	std::string name = sized("glmReadOBJ/grid", n);
+	if(selected(name))
+	{
+		char filename[] = "benchmark.obj";
+		glmWriteOBJ(model, filename, GLM_NONE);
+		GLMmodel* loaded = NULL;
+		measure(name, "triangles", triangles, [&]()
+		{
+			if(loaded) glmDelete(loaded);
+			loaded = NULL;
+		},
+		[&]()
+		{
+			loaded = glmReadOBJ(filename);
+		});
+		if(loaded) glmDelete(loaded);
+		remove(filename);
+	}
+	glmDelete(model);
+
+	// welding the separate triangles of a grid back together
+	name = sized("glmWeld", n);
+	if(n <= weldLimit)
+	{
+		GLMmodel* soup = NULL;
+		measure(name, "triangles", 2 * gridSide(n) * gridSide(n), [&]()
+		{
+			if(soup) glmDelete(soup);
+			soup = gridModel(n, true);
+		},
+		[&]()
+		{
+			glmWeld(soup, 0.0001f);
+		});
+		if(soup) glmDelete(soup);
+	}
+	else if(selected(name))
+	{
+		printf("%-36s skipped, quadratic in the vertices\n", name.c_str());
+	}
+}
+
+// the matrix functions of mat.h
+static void benchmarkMath()
+{
+	std::vector<mat4> matrices;
+	for(int i = 0; i < 64; i++)
+	{
+		matrices.push_back(Translate(random(-1, 1), random(-1, 1), random(-1, 1)) * RotateY(random(0, 360)) * RotateX(random(0, 360)));
+	}
+
+	measure("mat4 multiply", "multiplies", mathOperations, noSetup, [&]()
+	{
+		float sum = 0;
+		for(int i = 0; i < mathOperations; i++)
+		{
+			mat4 m = matrices[i & 63] * matrices[(i >> 6) & 63];
+			sum += m[0][3];
+		}
+		sink = sum;
+	});
+
+	std::vector<Transform> transforms;
+	for(int i = 0; i < 64; i++)
+	{
+		transforms.push_back(Transform(matrices[i]));
+	}
+
+	measure("Transform compose", "multiplies", mathOperations, noSetup, [&]()
+	{
+		float sum = 0;
+		for(int i = 0; i < mathOperations; i++)
+		{
+			Transform t = transforms[i & 63] * transforms[(i >> 6) & 63];
+			sum += t[0][3];
+		}
+		sink = sum;
+	});
+
+	measure("mat4 inverse", "matrices", mathOperations, noSetup, [&]()
+	{
+		float sum = 0;
+		for(int i = 0; i < mathOperations; i++)
+		{
+			mat4 m = inverse(matrices[i & 63]);
+			sum += m[0][3];
+		}
+		sink = sum;
+	});
+
+	measure("Transform inverse", "matrices", mathOperations, noSetup, [&]()
+	{
+		float sum = 0;
+		for(int i = 0; i < mathOperations; i++)
+		{
+			Transform t = transforms[i & 63].inverse();
+			sum += t[0][3];
+		}
+		sink = sum;
+	});
+
+	measure("Transform normalMatrix", "matrices", mathOperations, noSetup, [&]()
+	{
+		float sum = 0;
+		for(int i = 0; i < mathOperations; i++)
+		{
+			mat3 n = transforms[i & 63].normalMatrix();
+			sum += n[0][0];
+		}
+		sink = sum;
+	});
+
+	measure("LookAt", "matrices", mathOperations, noSetup, [&]()
+	{
+		float sum = 0;
+		for(int i = 0; i < mathOperations; i++)
+		{
+			mat4 m = LookAt(vec4((float)(i & 255), 2, 5, 1), vec4(0, 1, 0, 1), vec4(0, 1, 0, 0));
+			sum += m[0][3];
+		}
+		sink = sum;
+	});
+
+	measure("Perspective", "matrices", mathOperations, noSetup, [&]()
+	{
+		float sum = 0;
+		for(int i = 0; i < mathOperations; i++)
+		{
+			mat4 m = Perspective(30.0f + (i & 63), 4.0f / 3, 0.1f, 100);
+			sum += m[0][0];
+		}
+		sink = sum;
+	});
+}
+
+// median of the benchmark recorded last with the name, 0 if it was not run
+static double median(const std::string& name)
+{
+	for(int i = (int)results.size() - 1; i >= 0; i--)
+	{
+		if(results[i].name == name) return percentile(results[i].times, 0.5);
+	}
+	return 0;
+}
+
+// the scalar and the SIMD version of a kernel of mat.h over the matrices and vectors
+template<class Kernel> static void benchmarkKernel(const char* name, const char* unit, bool simd, const GLfloat* matrices, GLfloat* outputs, Kernel kernel)
+{
+	measure(std::string(name) + (simd ? " simd" : " scalar"), unit, mathOperations, noSetup, [&]()
+	{
+		for(int i = 0; i < mathOperations; i++)
+		{
+			kernel(&matrices[16 * (i & 63)], &matrices[16 * ((i >> 6) & 63)], &outputs[16 * (i & 63)]);
+		}
+		sink = outputs[0];
+	});
+}
+
+// the SIMD kernel against the scalar one on every pair of the matrices, bit for bit or, with a
+// tolerance, within it relative to the largest value of the result, false if they differ
+template<class Kernel, class Reference> static bool checkKernel(const char* name, int size, float tolerance, const GLfloat* matrices, Kernel kernel, Reference reference)
+{
+	if(!selected(std::string(name) + " scalar") && !selected(std::string(name) + " simd")) return true;
+
+	int differing = 0;
+	float worst = 0;
+	for(int i = 0; i < 64 * 64; i++)
+	{
+		GLfloat simd[16], scalar[16];
+		kernel(&matrices[16 * (i & 63)], &matrices[16 * (i >> 6)], simd);
+		reference(&matrices[16 * (i & 63)], &matrices[16 * (i >> 6)], scalar);
+		float largest = 0;
+		for(int k = 0; k < size; k++) largest = std::max(largest, fabsf(scalar[k]));
+		for(int k = 0; k < size; k++)
+		{
+			float error = largest > 0 ? fabsf(simd[k] - scalar[k]) / largest : fabsf(simd[k] - scalar[k]);
+			worst = std::max(worst, error);
+			if(tolerance == 0 ? simd[k] != scalar[k] : !(error <= tolerance)) differing++;
+		}
+	}
+	if(differing > 0) printf("%-36s FAILED, %d of %d values differ from scalar, relative error up to %g\n", name, differing, 64 * 64 * size, worst);
+		else if(tolerance == 0) printf("%-36s same bits as scalar\n", name);
+		else printf("%-36s within %g of scalar, relative error up to %g\n", name, tolerance, worst);
+	return differing == 0;
+}
+
+// the SIMD kernels of mat.h against the scalar ones they replace, false if their results differ
+static bool benchmarkKernels()
+{
+	std::vector<GLfloat> matrices(16 * 64), outputs(16 * 64);
+	for(int i = 0; i < 64; i++)
+	{
+		mat4 m = Translate(random(-1, 1), random(-1, 1), random(-1, 1)) * RotateY(random(0, 360)) * Scale(random(0.5f, 2), 1, 1);
+		memcpy(&matrices[16 * i], (const GLfloat*)m, sizeof(GLfloat) * 16);
+	}
+
+	const char* names[] = {"mat4 kernel multiply", "mat4 kernel transform", "mat4 kernel transpose", "mat4 kernel inverse"};
+	benchmarkKernel(names[0], "multiplies", false, &matrices[0], &outputs[0], mat4MultiplyScalar);
+	benchmarkKernel(names[0], "multiplies", true, &matrices[0], &outputs[0], mat4Multiply);
+	benchmarkKernel(names[1], "vectors", false, &matrices[0], &outputs[0], mat4TransformScalar);
+	benchmarkKernel(names[1], "vectors", true, &matrices[0], &outputs[0], mat4Transform);
+	benchmarkKernel(names[2], "matrices", false, &matrices[0], &outputs[0], [](const GLfloat* m, const GLfloat*, GLfloat* r) { mat4TransposeScalar(m, r); });
+	benchmarkKernel(names[2], "matrices", true, &matrices[0], &outputs[0], [](const GLfloat* m, const GLfloat*, GLfloat* r) { mat4Transpose(m, r); });
+	benchmarkKernel(names[3], "matrices", false, &matrices[0], &outputs[0], [](const GLfloat* m, const GLfloat*, GLfloat* r) { mat4InverseScalar(m, r); });
+	benchmarkKernel(names[3], "matrices", true, &matrices[0], &outputs[0], [](const GLfloat* m, const GLfloat*, GLfloat* r) { mat4Inverse(m, r); });
+
+	for(int i = 0; i < 4; i++)
+	{
+		double scalar = median(std::string(names[i]) + " scalar"), simd = median(std::string(names[i]) + " simd");
+		if(scalar > 0 && simd > 0) printf("%-36s speedup %.2fx\n", names[i], scalar / simd);
+	}
+
+	// general matrices, kept invertible by a dominant diagonal; multiply, transform and transpose
+	// add in the order of the scalar code, the inverse takes another method and only agrees up to rounding
+	for(int i = 0; i < 16 * 64; i++) matrices[i] = random(-1, 1) + (i % 5 == 0 ? 4 : 0);
+	bool same = checkKernel(names[0], 16, 0, &matrices[0], mat4Multiply, mat4MultiplyScalar);
+	same = checkKernel(names[1], 4, 0, &matrices[0], mat4Transform, mat4TransformScalar) && same;
+	same = checkKernel(names[2], 16, 0, &matrices[0], [](const GLfloat* m, const GLfloat*, GLfloat* r) { mat4Transpose(m, r); },
+		[](const GLfloat* m, const GLfloat*, GLfloat* r) { mat4TransposeScalar(m, r); }) && same;
+	same = checkKernel(names[3], 16, 1e-5f, &matrices[0], [](const GLfloat* m, const GLfloat*, GLfloat* r) { mat4Inverse(m, r); },
+		[](const GLfloat* m, const GLfloat*, GLfloat* r) { mat4InverseScalar(m, r); }) && same;
+	return same;
+}
+
+// the batch transforms of mat.h over n items against one mat4 * vec4 at a time
+static void benchmarkBatch(int n)
+{
+	std::vector<GLfloat> data(12 * n);
+	for(int i = 0; i < 6 * n; i++) data[i] = random(-10, 10);
+	vec3SoA in = {&data[0], &data[n], &data[2 * n]};
+	vec3SoA extent = {&data[3 * n], &data[4 * n], &data[5 * n]};
+	vec3SoA out = {&data[6 * n], &data[7 * n], &data[8 * n]};
+	vec3SoA out2 = {&data[9 * n], &data[10 * n], &data[11 * n]};
+	for(int i = 0; i < 3 * n; i++) data[3 * n + i] = data[i] + fabsf(data[3 * n + i]); // box maxima above the minima
+	mat4 m = Translate(1, 2, 3) * RotateY(30) * RotateX(20) * Scale(2, 2, 2);
+	Transform transform(m);
+
+	measure(sized("points one at a time", n), "points", n, noSetup, [&]()
+	{
+		for(int i = 0; i < n; i++)
+		{
+			vec4 p = m * vec4(in.x[i], in.y[i], in.z[i], 1);
+			out.x[i] = p.x;
+			out.y[i] = p.y;
+			out.z[i] = p.z;
+		}
+	});
+	measure(sized("transformPoints", n), "points", n, noSetup, [&]()
+	{
+		transformPoints(m, in, out, n);
+	});
+	measure(sized("transformDirections", n), "directions", n, noSetup, [&]()
+	{
+		transformDirections(m, in, out, n);
+	});
+	measure(sized("boxes one at a time", n), "boxes", n, noSetup, [&]()
+	{
+		for(int i = 0; i < n; i++)
+		{
+			AABB box = transformBounds(vec3(in.x[i], in.y[i], in.z[i]), vec3(extent.x[i], extent.y[i], extent.z[i]), transform);
+			out.x[i] = box.min.x; out.y[i] = box.min.y; out.z[i] = box.min.z;
+			out2.x[i] = box.max.x; out2.y[i] = box.max.y; out2.z[i] = box.max.z;
+		}
+	});
+	measure(sized("transformBoxes", n), "boxes", n, noSetup, [&]()
+	{
+		transformBoxes(m, in, extent, out, out2, n);
+	});
+	measure(sized("pointBounds", n), "points", n, noSetup, [&]()
+	{
+		vec3 boundsMin(1e30f), boundsMax(-1e30f);
+		pointBounds(in, n, boundsMin, boundsMax);
+		sink = boundsMin.x + boundsMax.x;
+	});
+
+	double single = median(sized("points one at a time", n)), batch = median(sized("transformPoints", n));
+	if(single > 0 && batch > 0) printf("%-36s speedup %.2fx\n", sized("transformPoints", n).c_str(), single / batch);
+	single = median(sized("boxes one at a time", n)), batch = median(sized("transformBoxes", n));
+	if(single > 0 && batch > 0) printf("%-36s speedup %.2fx\n", sized("transformBoxes", n).c_str(), single / batch);
+}
+
+// chained vector arithmetic written with the vector operators and by hand over floats
+static void benchmarkExpressions(int n)
+{
+	// lighting products of two lights and n materials as setLighting computes them
+	std::vector<Material> materials(n);
+	for(int i = 0; i < n; i++)
+	{
+		Material& material = materials[i];
+		material.ambient = vec4(random(0, 1), random(0, 1), random(0, 1), 1);
+		material.diffuse = vec4(random(0, 1), random(0, 1), random(0, 1), 1);
+		material.specular = vec4(random(0, 1), random(0, 1), random(0, 1), 1);
+	}
+	Light lights[2];
+	for(int i = 0; i < 2; i++)
+	{
+		lights[i].ambient = vec4(0.5f, 0.5f, 0.5f, 1);
+		lights[i].diffuse = vec4(0.5f, 0.5f, 0.5f, 1);
+		lights[i].specular = vec4(0.5f, 0.5f, 0.5f, 1);
+	}
+	std::vector<vec4> products(6 * n);
+
+	measure(sized("lightProducts", n), "materials", n, noSetup, [&]()
+	{
+		for(int i = 0; i < n; i++)
+		{
+			lightProducts(lights[0], materials[i], 1, &products[6 * i]);
+			lightProducts(lights[1], materials[i], 0.8f, &products[6 * i + 3]);
+		}
+	});
+	measure(sized("lightProducts floats", n), "materials", n, noSetup, [&]()
+	{
+		for(int i = 0; i < n; i++)
+		{
+			for(int j = 0; j < 2; j++)
+			{
+				const vec4* light[3] = {&lights[j].ambient, &lights[j].diffuse, &lights[j].specular};
+				const vec4* material[3] = {&materials[i].ambient, &materials[i].diffuse, &materials[i].specular};
+				float intensity = j ? 0.8f : 1;
+				for(int k = 0; k < 3; k++)
+				{
+					GLfloat* product = products[6 * i + 3 * j + k];
+					for(int c = 0; c < 4; c++) product[c] = (*light[k])[c] * (*material[k])[c] * intensity;
+				}
+			}
+		}
+	});
+
+	// the normals of glm and a blend between two poses of a grid of n triangles
+	GLMmodel* model = gridModel(n, false);
+	int triangles = model->numtriangles, vertices = model->numvertices + 1;
+	const vec3* positions = (const vec3*)model->vertices;
+	std::vector<vec3> raised(vertices), blended(vertices);
+	for(int i = 0; i < vertices; i++) raised[i] = vec3(positions[i].x, positions[i].y + 1, positions[i].z);
+
+	measure(sized("facet normals glm", n), "triangles", triangles, noSetup, [&]()
+	{
+		glmFacetNormals(model);
+	});
+	measure(sized("facet normals floats", n), "triangles", triangles, noSetup, [&]()
+	{
+		// glmFacetNormals written over floats
+		free(model->facetnorms);
+		model->facetnorms = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (triangles + 1));
+		for(int i = 0; i < triangles; i++)
+		{
+			model->triangles[i].findex = i + 1;
+			const GLuint* v = model->triangles[i].vindices;
+			const GLfloat* p0 = &model->vertices[3 * v[0]];
+			const GLfloat* p1 = &model->vertices[3 * v[1]];
+			const GLfloat* p2 = &model->vertices[3 * v[2]];
+			GLfloat u[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+			GLfloat w[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+			GLfloat* c = &model->facetnorms[3 * (i + 1)];
+			c[0] = u[1] * w[2] - u[2] * w[1];
+			c[1] = u[2] * w[0] - u[0] * w[2];
+			c[2] = u[0] * w[1] - u[1] * w[0];
+			GLfloat l = sqrtf(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+			c[0] /= l;
+			c[1] /= l;
+			c[2] /= l;
+		}
+	});
+
+	// compared between the builds with and without the expression templates
+	if(!model->facetnorms) glmFacetNormals(model);
+	measure(sized("vertex normals glm", n), "triangles", triangles, noSetup, [&]()
+	{
+		glmVertexNormals(model, 90);
+	});
+
+	float t = 0.3f;
+	measure(sized("blend vec3", n), "vertices", vertices, noSetup, [&]()
+	{
+		for(int i = 0; i < vertices; i++)
+		{
+			blended[i] = positions[i] * (1 - t) + raised[i] * t;
+		}
+	});
+	measure(sized("blend floats", n), "vertices", vertices, noSetup, [&]()
+	{
+		for(int i = 0; i < vertices; i++)
+		{
+			blended[i].x = positions[i].x * (1 - t) + raised[i].x * t;
+			blended[i].y = positions[i].y * (1 - t) + raised[i].y * t;
+			blended[i].z = positions[i].z * (1 - t) + raised[i].z * t;
+		}
+	});
+	glmDelete(model);
+
+	const char* names[][2] = {{"lightProducts", "lightProducts floats"}, {"facet normals glm", "facet normals floats"}, {"blend vec3", "blend floats"}};
+	for(int i = 0; i < 3; i++)
+	{
+		double vectors = median(sized(names[i][0], n)), floats = median(sized(names[i][1], n));
+		if(vectors > 0 && floats > 0) printf("%-36s %.2fx the time of floats\n", sized(names[i][0], n).c_str(), vectors / floats);
+	}
+}
+
+// scene graph of n objects, every object having up to the branching number of children
+static void benchmarkScene(int n, int branching)
+{
+	char suffix[64];
+	sprintf(suffix, "/%d", n);
+	const char* names[] = {"scene flatten", "scene transforms all dirty", "scene transforms 1% dirty", "scene visibility", "scene submit"};
+	bool any = false;
+	for(int i = 0; i < 5; i++) any = any || selected(names[i] + std::string(suffix));
+	if(!any) return;
+
+	// never deleted, deleting the objects frees their buffers which needs a GL context
+	SceneGraph* scene = new SceneGraph;
+	std::vector<Object*> objects(1, scene->root);
+	srand(1);
+	for(int i = 0; i < n; i++)
+	{
+		Object* object = new Object;
+		object->setMatrix(Translate(random(-2, 2), 0, random(-2, 2)) * RotateY(random(0, 360)));
+		object->nVertices = 36;
+		object->buffer = i + 1;
+		object->texture = 1 + i % 7;
+		scene->addObject(objects[i / branching], object);
+		objects.push_back(object);
+	}
+
+	measure(names[0] + std::string(suffix), "objects", n + 1, [&]()
+	{
+		scene->orderChanged = true;
+	},
+	[&]()
+	{
+		scene->updateTransforms();
+	});
+	scene->updateTransforms();
+
+	measure(names[1] + std::string(suffix), "objects", n + 1, [&]()
+	{
+		scene->root->dirty = true;
+	},
+	[&]()
+	{
+		scene->updateTransforms();
+	});
+
+	// a hundredth of the objects moved, their subtrees get updated too
+	measure(names[2] + std::string(suffix), "objects", n + 1, [&]()
+	{
+		for(int i = 1; i < (int)objects.size(); i += 100) objects[i]->dirty = true;
+	},
+	[&]()
+	{
+		scene->updateTransforms();
+	});
+
+	measure(names[3] + std::string(suffix), "objects", n + 1, noSetup, [&]()
+	{
+		scene->updateVisibility();
+	});
+
+	// the per-object draws of main.cpp recorded by the null device
+	scene->updateVisibility();
+	NullRenderDevice device;
+	Light lights[2];
+	lights[0].ambient = lights[0].diffuse = lights[0].specular = lights[1].ambient = lights[1].diffuse = lights[1].specular = vec4(0.5f, 0.5f, 0.5f, 1);
+	lights[0].position = vec4(0, 1, 0, 0);
+	lights[1].position = vec4(0, 1, 0, 1);
+	mat4 viewMatrix = LookAt(vec4(0, 1, -5, 1), vec4(0, 0, 0, 1), vec4(0, 1, 0, 0));
+	ObjectLocations locations;
+	getObjectLocations(&device, 1, locations);
+	measure(names[4] + std::string(suffix), "objects", n + 1, [&]()
+	{
+		device.reset();
+	},
+	[&]()
+	{
+		for(int i = 0; i < (int)scene->objects.size(); i++)
+		{
+			Object* object = scene->objects[i];
+			if(!scene->worldVisible[i]) continue;
+			setObjectAttributes(&device, locations, object);
+			setObjectLighting(&device, locations, object->material, lights, 1, vec3(0, 0, 1));
+			drawObject(&device, locations, object, object->texture, viewMatrix * scene->worldTransforms[i]);
+		}
+	});
+	if(selected(names[4] + std::string(suffix)))
+	{
+		printf("%-36s %.1f commands and %.1f uniform floats per object\n", (names[4] + std::string(suffix)).c_str(),
+			(double)device.commands.size() / (n + 1), (double)device.data.size() / (n + 1));
+	}
+}
+
+// bounding volume hierarchy with n objects scattered over a square of the given size,
+// every build and every batch of moves or queries is a sample
+static void benchmarkTree(int n)
+{
+	const char* names[] = {"bvh build", "bvh move", "bvh frustum", "bvh sphere", "bvh ray"};
+	bool any = false;
+	for(int i = 0; i < 5; i++) any = any || selected(sized(names[i], n));
+	if(!any) return;
+
+	float size = 10 * sqrtf((float)n);
+	std::vector<AABB> boxes(n);
+	std::vector<int> proxies(n);
+	std::vector<Object*> results;
+
+	// build by insertion into an empty tree, the same boxes every run
+	AABBTree tree;
+	auto build = [&]()
+	{
+		srand(1);
+		for(int i = 0; i < n; i++)
+		{
+			vec3 p(random(-size, size), random(0, 2), random(-size, size));
+			boxes[i] = AABB(p - vec3(0.5f), p + vec3(0.5f));
+			proxies[i] = tree.insert(boxes[i], (Object*)NULL);
+		}
+	};
+	measure(sized("bvh build", n), "objects", n, [&]() { tree = AABBTree(); }, build);
+	if(tree.getLeafCount() == 0) build();
+
+	// move a few objects a little, some of them leave their enlarged boxes
+	const int nMoves = 100;
+	measure(sized("bvh move", n), "moves", nMoves, noSetup, [&]()
+	{
+		for(int i = 0; i < nMoves; i++)
+		{
+			int k = rand() % n;
+			vec3 d(random(-0.2f, 0.2f), 0, random(-0.2f, 0.2f));
+			boxes[k] = AABB(boxes[k].min + d, boxes[k].max + d);
+			tree.move(proxies[k], boxes[k]);
+		}
+	});
+
+	// frustum looking over the scene from its center
+	vec4 planes[6];
+	frustumPlanes(Perspective(60, 4.0f / 3, 0.1f, 100) * LookAt(vec4(0, 2, 0, 1), vec4(1, 2, 1, 1), vec4(0, 1, 0, 0)), planes);
+	const int nQueries = 10;
+	measure(sized("bvh frustum", n), "queries", nQueries, noSetup, [&]()
+	{
+		for(int i = 0; i < nQueries; i++)
+		{
+			results.clear();
+			tree.queryFrustum(planes, results);
+		}
+	});
+
+	// spheres of radius 5 at random places
+	measure(sized("bvh sphere", n), "queries", nQueries, noSetup, [&]()
+	{
+		for(int i = 0; i < nQueries; i++)
+		{
+			results.clear();
+			tree.querySphere(vec3(random(-size, size), 1, random(-size, size)), 5, results);
+		}
+	});
+
+	// rays at random directions from random places
+	measure(sized("bvh ray", n), "queries", nQueries, noSetup, [&]()
+	{
+		for(int i = 0; i < nQueries; i++)
+		{
+			float angle = random(0, 2 * (float)M_PI);
+			float distance;
+			tree.raycast(vec3(random(-size, size), 1, random(-size, size)), vec3(cosf(angle), 0.01f, sinf(angle)), 100, &distance);
+		}
+	});
+
+	results.clear();
+	tree.queryFrustum(planes, results);
+	printf("%8d objects: height %2d, frustum finds %d\n", n, tree.getHeight(), (int)results.size());
+}
+
+int main(int argc, char **argv)
+{
+	const char* jsonFile = NULL;
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "-json") && i + 1 < argc) jsonFile = argv[++i];
+		else if(!strcmp(argv[i], "-max") && i + 1 < argc)
+		{
+			// each limit is only lowered, the sweeps keep their own largest size
+			int size = atoi(argv[++i]);
+			maxTriangles = std::min(size, maxTriangles);
+			maxObjects = std::min(size, maxObjects);
+		}
+		else if(!strcmp(argv[i], "-filter") && i + 1 < argc) filter = argv[++i];
+		else
+		{
+			fprintf(stderr, "usage: %s [-json file] [-max size] [-filter text]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	printf("loaders\n");
+	benchmarkLoaders();
+
+	printf("mesh processing\n");
+	for(int n = 1000; n <= maxTriangles; n *= 10)
+	{
+		benchmarkMesh(n);
+	}
+
+	printf("matrices\n");
+	benchmarkMath();
+	bool kernelsMatch = benchmarkKernels();
+	for(int n = 1000; n <= maxObjects; n *= 1000)
+	{
+		benchmarkBatch(n);
+	}
+
+#ifdef ANGEL_EXPRESSION_TEMPLATES
+	printf("vector expressions, expression templates\n");
+#else
+	printf("vector expressions, operators\n");
+#endif
+	for(int n = 1000; n <= std::min(maxTriangles, 1000000); n *= 1000)
+	{
+		benchmarkExpressions(n);
+	}
+
+	printf("scene graph\n");
+	for(int n = 1000; n <= maxObjects; n *= 10)
+	{
+		benchmarkScene(n, 4);
+	}
+
+	printf("bounding volume hierarchy\n");
+	for(int n = 100; n <= maxObjects; n *= 10)
+	{
+		benchmarkTree(n);
+	}
+
+	if(jsonFile && !writeJson(jsonFile))
+	{
+		fprintf(stderr, "can't write %s\n", jsonFile);
+		return 1;
+	}
+	if(!kernelsMatch)
+	{
+		fprintf(stderr, "the SIMD kernels of mat.h differ from the scalar ones\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,434 @@
+#include "bvh.h"
+
+const int maxStackSize = 256; // traversal stack size kept in place, enough for balanced trees
+
+// traversal stack of the queries, moved to the heap when a degenerate tree
+// is deeper than the fixed part so that no subtree is skipped
+class TraversalStack
+{
+public:
+	TraversalStack() : items(fixed), count(0), capacity(maxStackSize)
+	{
+	}
+
+	bool empty() const { return count == 0; }
+	int pop() { return items[--count]; }
+
+	void push(int node)
+	{
+		if(count == capacity) grow();
+		items[count++] = node;
+	}
+
+private:
+	int fixed[maxStackSize];
+	std::vector<int> heap;
+	int* items;
+	int count, capacity;
+
+	void grow()
+	{
+		if(items == fixed) heap.assign(fixed, fixed + count);
+		capacity *= 2;
+		heap.resize(capacity);
+		items = &heap[0];
+	}
+};
+
+// world bounding box of the transformed box (Arvo's method)
+AABB transformBounds(const vec3& boundsMin, const vec3& boundsMax, const Transform& transform)
+{
+	AABB box;
+	for(int i = 0; i < 3; i++)
+	{
+		box.min[i] = box.max[i] = transform[i][3];
+		for(int j = 0; j < 3; j++)
+		{
+			float a = transform[i][j] * boundsMin[j];
+			float b = transform[i][j] * boundsMax[j];
+			box.min[i] += a < b ? a : b;
+			box.max[i] += a < b ? b : a;
+		}
+	}
+	return box;
+}
+
+// planes of the view frustum facing inwards as (normal, distance)
+void frustumPlanes(const mat4& viewProjMatrix, vec4 planes[6])
+{
+	const mat4& m = viewProjMatrix;
+	for(int i = 0; i < 3; i++)
+	{
+		planes[2*i + 0] = m[3] + m[i];
+		planes[2*i + 1] = m[3] - m[i];
+	}
+}
+
+AABBTree::AABBTree(float margin) : margin(margin), root(-1), freeList(-1), leafCount(0)
+{
+}
+
+// take a node from the free list or grow the pool
+int AABBTree::allocateNode()
+{
+	int node;
+	if(freeList >= 0)
+	{
+		node = freeList;
+		freeList = nodes[node].parent;
+	}
+	else
+	{
+		node = (int)nodes.size();
+		nodes.push_back(Node());
+	}
+
+	nodes[node].object = NULL;
+	nodes[node].parent = -1;
+	nodes[node].child1 = nodes[node].child2 = -1;
+	nodes[node].height = 0;
+	return node;
+}
+
+// return the node to the free list
+void AABBTree::freeNode(int node)
+{
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+// add an object with the given world box, returns its proxy
+int AABBTree::insert(const AABB& box, Object* object)
+{
+	int proxy = allocateNode();
+	nodes[proxy].box = AABB(box.min - vec3(margin), box.max + vec3(margin));
+	nodes[proxy].object = object;
+	insertLeaf(proxy);
+	leafCount++;
+	return proxy;
+}
+
+// remove the object
+void AABBTree::remove(int proxy)
+{
+	removeLeaf(proxy);
+	freeNode(proxy);
+	leafCount--;
+}
+
+// update the world box, returns true if the leaf was reinserted
+bool AABBTree::move(int proxy, const AABB& box)
+{
+	if(nodes[proxy].box.contains(box)) return false;
+
+	removeLeaf(proxy);
+	nodes[proxy].box = AABB(box.min - vec3(margin), box.max + vec3(margin));
+	insertLeaf(proxy);
+	return true;
+}
+
+// insert the leaf next to the sibling with the cheapest surface area cost
+void AABBTree::insertLeaf(int leaf)
+{
+	if(root < 0)
+	{
+		root = leaf;
+		nodes[root].parent = -1;
+		return;
+	}
+
+	// descend to the best sibling
+	AABB leafBox = nodes[leaf].box;
+	int index = root;
+	while(nodes[index].child1 >= 0)
+	{
+		int child1 = nodes[index].child1;
+		int child2 = nodes[index].child2;
+
+		float area = nodes[index].box.area();
+		float combinedArea = combine(nodes[index].box, leafBox).area();
+
+		// cost of a new parent for this node and the leaf, and the cost pushed down the tree
+		float cost = 2 * combinedArea;
+		float inheritanceCost = 2 * (combinedArea - area);
+
+		float cost1 = combine(leafBox, nodes[child1].box).area() + inheritanceCost;
+		if(nodes[child1].child1 >= 0) cost1 -= nodes[child1].box.area();
+		float cost2 = combine(leafBox, nodes[child2].box).area() + inheritanceCost;
+		if(nodes[child2].child1 >= 0) cost2 -= nodes[child2].box.area();
+
+		if(cost < cost1 && cost < cost2) break;
+		index = cost1 < cost2 ? child1 : child2;
+	}
+	int sibling = index;
+
+	// create a new parent for the sibling and the leaf
+	int oldParent = nodes[sibling].parent;
+	int newParent = allocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].box = combine(leafBox, nodes[sibling].box);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if(oldParent >= 0)
+	{
+		if(nodes[oldParent].child1 == sibling) nodes[oldParent].child1 = newParent;
+		else nodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		root = newParent;
+	}
+
+	// refit and balance the ancestors
+	refit(nodes[leaf].parent);
+}
+
+// remove the leaf and put its sibling in place of the parent
+void AABBTree::removeLeaf(int leaf)
+{
+	if(leaf == root)
+	{
+		root = -1;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	if(grandParent >= 0)
+	{
+		if(nodes[grandParent].child1 == parent) nodes[grandParent].child1 = sibling;
+		else nodes[grandParent].child2 = sibling;
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+		refit(grandParent);
+	}
+	else
+	{
+		root = sibling;
+		nodes[sibling].parent = -1;
+		freeNode(parent);
+	}
+}
+
+// recompute boxes and heights up to the root, balancing on the way
+void AABBTree::refit(int node)
+{
+	while(node >= 0)
+	{
+		node = balance(node);
+
+		int child1 = nodes[node].child1;
+		int child2 = nodes[node].child2;
+		int height1 = nodes[child1].height, height2 = nodes[child2].height;
+		nodes[node].height = 1 + (height1 > height2 ? height1 : height2);
+		nodes[node].box = combine(nodes[child1].box, nodes[child2].box);
+
+		node = nodes[node].parent;
+	}
+}
+
+// rotate the higher grandchild up if the node is imbalanced, returns the node now in its place
+int AABBTree::balance(int a)
+{
+	if(nodes[a].child1 < 0 || nodes[a].height < 2) return a;
+
+	int b = nodes[a].child1;
+	int c = nodes[a].child2;
+	int difference = nodes[c].height - nodes[b].height;
+	if(difference >= -1 && difference <= 1) return a;
+
+	// the higher child goes up, bigger is the one rotated up, other its remaining sibling
+	int up = difference > 1 ? c : b;
+	int stay = difference > 1 ? b : c;
+	int f = nodes[up].child1;
+	int g = nodes[up].child2;
+
+	// swap a and up
+	nodes[up].child1 = a;
+	nodes[up].parent = nodes[a].parent;
+	nodes[a].parent = up;
+
+	if(nodes[up].parent >= 0)
+	{
+		int p = nodes[up].parent;
+		if(nodes[p].child1 == a) nodes[p].child1 = up;
+		else nodes[p].child2 = up;
+	}
+	else
+	{
+		root = up;
+	}
+
+	// the higher grandchild stays with up, the other goes to a
+	int keep = nodes[f].height > nodes[g].height ? f : g;
+	int give = keep == f ? g : f;
+	nodes[up].child2 = keep;
+	if(difference > 1)
+	{
+		nodes[a].child2 = give;
+	}
+	else
+	{
+		nodes[a].child1 = give;
+	}
+	nodes[give].parent = a;
+
+	nodes[a].box = combine(nodes[stay].box, nodes[give].box);
+	int heightStay = nodes[stay].height, heightGive = nodes[give].height;
+	nodes[a].height = 1 + (heightStay > heightGive ? heightStay : heightGive);
+
+	nodes[up].box = combine(nodes[a].box, nodes[keep].box);
+	int heightKeep = nodes[keep].height;
+	nodes[up].height = 1 + (nodes[a].height > heightKeep ? nodes[a].height : heightKeep);
+
+	return up;
+}
+
+// objects whose boxes are at least partly inside the frustum
+void AABBTree::queryFrustum(const vec4 planes[6], std::vector<Object*>& results) const
+{
+	if(root < 0) return;
+
+	TraversalStack stack;
+	stack.push(root);
+	while(!stack.empty())
+	{
+		const Node& node = nodes[stack.pop()];
+
+		// the box is outside if its corner farthest along the plane normal is behind the plane
+		bool outside = false;
+		for(int i = 0; i < 6 && !outside; i++)
+		{
+			const vec4& p = planes[i];
+			float d = p.w + p.x * (p.x > 0 ? node.box.max.x : node.box.min.x)
+				+ p.y * (p.y > 0 ? node.box.max.y : node.box.min.y)
+				+ p.z * (p.z > 0 ? node.box.max.z : node.box.min.z);
+			outside = d < 0;
+		}
+		if(outside) continue;
+
+		if(node.child1 < 0)
+		{
+			results.push_back(node.object);
+		}
+		else
+		{
+			stack.push(node.child1);
+			stack.push(node.child2);
+		}
+	}
+}
+
+// objects whose boxes overlap the sphere
+void AABBTree::querySphere(const vec3& center, float radius, std::vector<Object*>& results) const
+{
+	if(root < 0) return;
+
+	TraversalStack stack;
+	stack.push(root);
+	while(!stack.empty())
+	{
+		const Node& node = nodes[stack.pop()];
+
+		// squared distance from the center to the box
+		float d2 = 0;
+		for(int i = 0; i < 3; i++)
+		{
+			float c = center[i];
+			if(c < node.box.min[i]) d2 += (node.box.min[i] - c) * (node.box.min[i] - c);
+			else if(c > node.box.max[i]) d2 += (c - node.box.max[i]) * (c - node.box.max[i]);
+		}
+		if(d2 > radius * radius) continue;
+
+		if(node.child1 < 0)
+		{
+			results.push_back(node.object);
+		}
+		else
+		{
+			stack.push(node.child1);
+			stack.push(node.child2);
+		}
+	}
+}
+
+// distance along the ray to the box, negative if missed (slab test)
+static float rayBox(const AABB& box, const vec3& origin, const vec3& inverse, float maxDistance)
+{
+	float tmin = 0, tmax = maxDistance;
+	for(int i = 0; i < 3; i++)
+	{
+		float t0 = (box.min[i] - origin[i]) * inverse[i];
+		float t1 = (box.max[i] - origin[i]) * inverse[i];
+		if(t0 > t1) { float t = t0; t0 = t1; t1 = t; }
+		tmin = t0 > tmin ? t0 : tmin;
+		tmax = t1 < tmax ? t1 : tmax;
+		if(tmin > tmax) return -1;
+	}
+	return tmin;
+}
+
+// objects whose boxes are hit by the ray within the distance
+void AABBTree::queryRay(const vec3& origin, const vec3& direction, float maxDistance, std::vector<Object*>& results) const
+{
+	if(root < 0) return;
+
+	vec3 inverse(1 / direction.x, 1 / direction.y, 1 / direction.z);
+	TraversalStack stack;
+	stack.push(root);
+	while(!stack.empty())
+	{
+		const Node& node = nodes[stack.pop()];
+		if(rayBox(node.box, origin, inverse, maxDistance) < 0) continue;
+
+		if(node.child1 < 0)
+		{
+			results.push_back(node.object);
+		}
+		else
+		{
+			stack.push(node.child1);
+			stack.push(node.child2);
+		}
+	}
+}
+
+// nearest object whose box is hit by the ray, NULL if none
+Object* AABBTree::raycast(const vec3& origin, const vec3& direction, float maxDistance, float* distance) const
+{
+	if(root < 0) return NULL;
+
+	vec3 inverse(1 / direction.x, 1 / direction.y, 1 / direction.z);
+	Object* nearest = NULL;
+	TraversalStack stack;
+	stack.push(root);
+	while(!stack.empty())
+	{
+		const Node& node = nodes[stack.pop()];
+
+		// subtrees farther than the nearest hit are skipped
+		float t = rayBox(node.box, origin, inverse, maxDistance);
+		if(t < 0) continue;
+
+		if(node.child1 < 0)
+		{
+			nearest = node.object;
+			maxDistance = t;
+		}
+		else
+		{
+			stack.push(node.child1);
+			stack.push(node.child2);
+		}
+	}
+
+	if(distance) *distance = maxDistance;
+	return nearest;
+}
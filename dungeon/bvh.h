@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- bvh.h ---
+//
+//   Dynamic bounding volume hierarchy kept alongside the scene graph.
+//   Leaves hold enlarged world bounding boxes of the objects, so a moving
+//   object is reinserted only when it leaves its enlarged box.  The tree
+//   is kept balanced by rotations, queries take logarithmic time.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include <vector>
+#include "Angel.h"
+#include "transform.h"
+
+class Object;
+
+// axis aligned bounding box
+struct AABB
+{
+	vec3 min, max;
+
+	AABB()
+	{
+	}
+
+	AABB(const vec3& min, const vec3& max) : min(min), max(max)
+	{
+	}
+
+	float area() const
+	{
+		vec3 d = max - min;
+		return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	bool contains(const AABB& box) const
+	{
+		return min.x <= box.min.x && min.y <= box.min.y && min.z <= box.min.z &&
+			max.x >= box.max.x && max.y >= box.max.y && max.z >= box.max.z;
+	}
+};
+
+// smallest box containing both boxes
+inline AABB combine(const AABB& a, const AABB& b)
+{
+	return AABB(vec3(a.min.x < b.min.x ? a.min.x : b.min.x, a.min.y < b.min.y ? a.min.y : b.min.y, a.min.z < b.min.z ? a.min.z : b.min.z),
+		vec3(a.max.x > b.max.x ? a.max.x : b.max.x, a.max.y > b.max.y ? a.max.y : b.max.y, a.max.z > b.max.z ? a.max.z : b.max.z));
+}
+
+AABB transformBounds(const vec3& boundsMin, const vec3& boundsMax, const Transform& transform);
+void frustumPlanes(const mat4& viewProjMatrix, vec4 planes[6]);
+
+// dynamic tree of bounding boxes
+class AABBTree
+{
+public:
+	float margin; // enlargement of the leaf boxes
+
+	AABBTree(float margin = 0.1f);
+
+	int insert(const AABB& box, Object* object);
+	void remove(int proxy);
+	bool move(int proxy, const AABB& box);
+
+	Object* getObject(int proxy) const { return nodes[proxy].object; }
+	const AABB& getBox(int proxy) const { return nodes[proxy].box; }
+	int getHeight() const { return root < 0 ? 0 : nodes[root].height; }
+	int getLeafCount() const { return leafCount; }
+
+	void queryFrustum(const vec4 planes[6], std::vector<Object*>& results) const;
+	void querySphere(const vec3& center, float radius, std::vector<Object*>& results) const;
+	void queryRay(const vec3& origin, const vec3& direction, float maxDistance, std::vector<Object*>& results) const;
+	Object* raycast(const vec3& origin, const vec3& direction, float maxDistance, float* distance) const;
+
+private:
+	// tree node, a leaf if it has no children
+	struct Node
+	{
+		AABB box;
+		Object* object;
+		int parent; // parent node or next free node
+		int child1, child2;
+		int height; // leaves have zero height, free nodes -1
+	};
+
+	std::vector<Node> nodes;
+	int root;
+	int freeList;
+	int leafCount;
+
+	int allocateNode();
+	void freeNode(int node);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	int balance(int node);
+	void refit(int node);
+};
+
+#endif // __BVH_H__
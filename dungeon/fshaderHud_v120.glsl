@@ -0,0 +1,11 @@
+#version 120
+
+varying vec2 fTexture; // get the interpolated value from the vertex shader
+varying vec4 fColor;   // get the interpolated value from the vertex shader
+
+uniform sampler2D atlas; // glyph coverage in the red channel
+
+void main()
+{
+	gl_FragColor = vec4(fColor.rgb, fColor.a * texture2D(atlas, fTexture).r);
+}
@@ -0,0 +1,84 @@
+#version 430
+
+in vec3 fPosition;   // get the interpolated value from the vertex shader
+in vec3 fNormal;     // get the interpolated value from the vertex shader
+in vec2 fTexture;    // get the interpolated value from the vertex shader
+flat in int fDrawID; // get the draw index from the vertex shader
+
+out vec4 fragColor;
+
+// per draw data, one entry per object
+struct DrawData
+{
+	mat4 modelMatrix;
+	vec4 ambient, diffuse, specular;
+	float shininess;
+	int layer;
+};
+layout(std430, row_major, binding = 0) readonly buffer Draws
+{
+	DrawData draws[];
+};
+
+uniform sampler2DArray textures; // texture array to sample from
+
+// per frame data, camera and lighting stuff for 2 lights
+layout(std140, row_major, binding = 0) uniform Frame
+{
+	mat4 view_matrix; // view matrix
+	mat4 proj_matrix; // projection matrix
+	vec4 LightAmbient[2], LightDiffuse[2], LightSpecular[2], LightPosition[2];
+	vec4 spotDirection;
+};
+
+void main() 
+{
+	DrawData draw = draws[fDrawID];
+	vec3 posInCam = fPosition; // fragment position in camera space
+	vec3 V = normalize(-posInCam); // direction to the eye in camera space
+	vec3 N = normalize(fNormal); // fragment normal in camera space
+	vec4 totalColor = vec4(0.0);
+
+	// for each light
+	for(int i = 0; i < 2; i++)
+	{
+		vec3 lightInCam = (view_matrix * LightPosition[i]).xyz; // light position in camera space
+		vec3 L = normalize(lightInCam-posInCam); // direction to the light
+		vec3 H = normalize(L+V); // half-vector
+
+		// ambient light contribution
+		vec4 ambient = LightAmbient[i] * draw.ambient;
+		
+		// diffuse light contribution
+		float Kd = max(dot(L,N), 0.0);
+		vec4 diffuse = Kd*LightDiffuse[i]*draw.diffuse;
+
+		// specular light contribution
+		vec4 specular = vec4(0.0, 0.0, 0.0, 1.0);
+		if(dot(L,N) > 0.0)
+		{
+			float Ks = pow(max(dot(N,H), 0.0), draw.shininess);
+			specular = Ks*LightSpecular[i]*draw.specular;
+		}
+
+		// combined contributions
+		vec4 color = ambient + diffuse + specular;
+
+		// if this is the flashlight
+		if(i == 1)
+		{
+			// spot direction in camera space
+			vec3 sd = normalize((view_matrix * vec4(spotDirection.xyz, 0.0)).xyz);
+
+			// flashlight brightness decreases with angle from spot direction
+			color *= clamp(30.0 * (dot(sd, -L) - 0.95), 0.0, 1.0);
+		}
+
+		totalColor += color;
+	}
+
+	totalColor.a = 1.0;
+
+	vec4 texColor = texture(textures, vec3(fTexture, float(draw.layer))); // get the texture color at location fTexture
+	fragColor = totalColor * texColor; // apply the color and texture to the fragment
+}
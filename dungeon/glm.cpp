@@ -20,6 +20,10 @@ Tested under Windows and Linux
  */
 
 #include "glm.h"
+#include "profiler.h"
+#include "perfcounters.h"
+#include "arena.h"
+#include "alloctrack.h"
 
 #define T(x) (model->triangles[(x)])
 
@@ -63,22 +67,6 @@ glmDot(GLfloat* u, GLfloat* v)
     return u[0]*v[0] + u[1]*v[1] + u[2]*v[2];
 }
 
-/* glmCross: compute the cross product of two vectors
- *
- * u - array of 3 GLfloats (GLfloat u[3])
- * v - array of 3 GLfloats (GLfloat v[3])
- * n - array of 3 GLfloats (GLfloat n[3]) to return the cross product in
- */
-static GLvoid
-glmCross(GLfloat* u, GLfloat* v, GLfloat* n)
-{
-    assert(u); assert(v); assert(n);
-    
-    n[0] = u[1]*v[2] - u[2]*v[1];
-    n[1] = u[2]*v[0] - u[0]*v[2];
-    n[2] = u[0]*v[1] - u[1]*v[0];
-}
-
 /* glmNormalize: normalize a vector
  *
  * v - array of 3 GLfloats (GLfloat v[3]) to be normalized
@@ -434,6 +422,8 @@ glmWriteMTL(GLMmodel* model, char* modelpath, char* mtllibname)
 static GLvoid
 glmFirstPass(GLMmodel* model, FILE* file) 
 {
+    PROFILE_ZONE("glmFirstPass");
+    PERF_PHASE("glmFirstPass", 0);
     GLuint numvertices;        /* number of vertices in model */
     GLuint numnormals;         /* number of normals in model */
     GLuint numtexcoords;       /* number of texcoords in model */
@@ -555,6 +545,7 @@ glmFirstPass(GLMmodel* model, FILE* file)
   model->numnormals   = numnormals;
   model->numtexcoords = numtexcoords;
   model->numtriangles = numtriangles;
+  PERF_TRIANGLES(numtriangles);
   
   /* allocate memory for the triangles in each group */
   group = model->groups;
@@ -574,6 +565,8 @@ glmFirstPass(GLMmodel* model, FILE* file)
 static GLvoid
 glmSecondPass(GLMmodel* model, FILE* file) 
 {
+    PROFILE_ZONE("glmSecondPass");
+    PERF_PHASE("glmSecondPass", model->numtriangles);
     GLuint numvertices;        /* number of vertices in model */
     GLuint numnormals;         /* number of normals in model */
     GLuint numtexcoords;       /* number of texcoords in model */
@@ -941,9 +934,11 @@ glmReverseWinding(GLMmodel* model)
 GLvoid
 glmFacetNormals(GLMmodel* model)
 {
+    PROFILE_ZONE("glmFacetNormals");
+    PERF_PHASE("glmFacetNormals", model->numtriangles);
     GLuint  i;
-    GLfloat u[3];
-    GLfloat v[3];
+    const vec3* vertices;
+    vec3* facetnorms;
     
     assert(model);
     assert(model->vertices);
@@ -957,24 +952,16 @@ glmFacetNormals(GLMmodel* model)
     model->facetnorms = (GLfloat*)malloc(sizeof(GLfloat) *
                        3 * (model->numfacetnorms + 1));
     
+    /* the vertices and normals as vectors, the edges and their cross
+       product go through the vector arithmetic */
+    vertices = (const vec3*)model->vertices;
+    facetnorms = (vec3*)model->facetnorms;
     for (i = 0; i < model->numtriangles; i++) {
         model->triangles[i].findex = i+1;
         
-        u[0] = model->vertices[3 * T(i).vindices[1] + 0] -
-            model->vertices[3 * T(i).vindices[0] + 0];
-        u[1] = model->vertices[3 * T(i).vindices[1] + 1] -
-            model->vertices[3 * T(i).vindices[0] + 1];
-        u[2] = model->vertices[3 * T(i).vindices[1] + 2] -
-            model->vertices[3 * T(i).vindices[0] + 2];
-        
-        v[0] = model->vertices[3 * T(i).vindices[2] + 0] -
-            model->vertices[3 * T(i).vindices[0] + 0];
-        v[1] = model->vertices[3 * T(i).vindices[2] + 1] -
-            model->vertices[3 * T(i).vindices[0] + 1];
-        v[2] = model->vertices[3 * T(i).vindices[2] + 2] -
-            model->vertices[3 * T(i).vindices[0] + 2];
-        
-        glmCross(u, v, &model->facetnorms[3 * (i+1)]);
+        const vec3& origin = vertices[T(i).vindices[0]];
+        facetnorms[i+1] = cross(vertices[T(i).vindices[1]] - origin,
+            vertices[T(i).vindices[2]] - origin);
         glmNormalize(&model->facetnorms[3 * (i+1)]);
     }
 }
@@ -998,14 +985,19 @@ glmFacetNormals(GLMmodel* model)
 GLvoid
 glmVertexNormals(GLMmodel* model, GLfloat angle)
 {
+    PROFILE_ZONE("glmVertexNormals");
+    PERF_PHASE("glmVertexNormals", model->numtriangles);
     GLMnode* node;
-    GLMnode* tail;
+    GLMnode* nodes;
     GLMnode** members;
     GLfloat* normals;
     GLuint numnormals;
-    GLfloat average[3];
+    const vec3* facetnorms;
+    vec3* vertexnorms;
+    vec3 average;
     GLfloat dot, cos_angle;
     GLuint i, avg;
+    GLboolean heap;
     
     assert(model);
     assert(model->facetnorms);
@@ -1022,30 +1014,41 @@ glmVertexNormals(GLMmodel* model, GLfloat angle)
     model->normals = (GLfloat*)malloc(sizeof(GLfloat)* 3* (model->numnormals+1));
     
     /* allocate a structure that will hold a linked list of triangle
-    indices for each vertex */
-    members = (GLMnode**)malloc(sizeof(GLMnode*) * (model->numvertices + 1));
+    indices for each vertex, and the nodes of the lists, in the scratch
+    arena of the thread or, if they do not fit, on the heap */
+    ArenaMark mark(threadArena());
+    members = threadArena().allocateArray<GLMnode*>(model->numvertices + 1);
+    nodes = threadArena().allocateArray<GLMnode>(3 * model->numtriangles);
+    heap = !members || !nodes;
+    if (heap) {
+        members = (GLMnode**)malloc(sizeof(GLMnode*) * (model->numvertices + 1));
+        nodes = (GLMnode*)malloc(sizeof(GLMnode) * 3 * model->numtriangles);
+    }
     for (i = 1; i <= model->numvertices; i++)
         members[i] = NULL;
     
     /* for every triangle, create a node for each vertex in it */
     for (i = 0; i < model->numtriangles; i++) {
-        node = (GLMnode*)malloc(sizeof(GLMnode));
+        node = &nodes[3 * i + 0];
         node->index = i;
         node->next  = members[T(i).vindices[0]];
         members[T(i).vindices[0]] = node;
         
-        node = (GLMnode*)malloc(sizeof(GLMnode));
+        node = &nodes[3 * i + 1];
         node->index = i;
         node->next  = members[T(i).vindices[1]];
         members[T(i).vindices[1]] = node;
         
-        node = (GLMnode*)malloc(sizeof(GLMnode));
+        node = &nodes[3 * i + 2];
         node->index = i;
         node->next  = members[T(i).vindices[2]];
         members[T(i).vindices[2]] = node;
     }
     
-    /* calculate the average normal for each vertex */
+    /* calculate the average normal for each vertex, with the facet and
+    vertex normals as vectors */
+    facetnorms = (const vec3*)model->facetnorms;
+    vertexnorms = (vec3*)model->normals;
     numnormals = 1;
     for (i = 1; i <= model->numvertices; i++) {
     /* calculate an average normal for this vertex by averaging the
@@ -1053,7 +1056,7 @@ glmVertexNormals(GLMmodel* model, GLfloat angle)
         node = members[i];
         if (!node)
             fprintf(stderr, "glmVertexNormals(): vertex w/o a triangle\n");
-        average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
+        average = vec3(0.0, 0.0, 0.0);
         avg = 0;
         while (node) {
         /* only average if the dot product of the angle between the two
@@ -1064,9 +1067,7 @@ glmVertexNormals(GLMmodel* model, GLfloat angle)
                 &model->facetnorms[3 * T(members[i]->index).findex]);
             if (dot > cos_angle) {
                 node->averaged = GL_TRUE;
-                average[0] += model->facetnorms[3 * T(node->index).findex + 0];
-                average[1] += model->facetnorms[3 * T(node->index).findex + 1];
-                average[2] += model->facetnorms[3 * T(node->index).findex + 2];
+                average += facetnorms[T(node->index).findex];
                 avg = 1;            /* we averaged at least one normal! */
             } else {
                 node->averaged = GL_FALSE;
@@ -1076,12 +1077,10 @@ glmVertexNormals(GLMmodel* model, GLfloat angle)
         
         if (avg) {
             /* normalize the averaged normal */
-            glmNormalize(average);
+            glmNormalize(&average.x);
             
             /* add the normal to the vertex normals list */
-            model->normals[3 * numnormals + 0] = average[0];
-            model->normals[3 * numnormals + 1] = average[1];
-            model->normals[3 * numnormals + 2] = average[2];
+            vertexnorms[numnormals] = average;
             avg = numnormals;
             numnormals++;
         }
@@ -1099,12 +1098,7 @@ glmVertexNormals(GLMmodel* model, GLfloat angle)
                     T(node->index).nindices[2] = avg;
             } else {
                 /* if this node wasn't averaged, use the facet normal */
-                model->normals[3 * numnormals + 0] = 
-                    model->facetnorms[3 * T(node->index).findex + 0];
-                model->normals[3 * numnormals + 1] = 
-                    model->facetnorms[3 * T(node->index).findex + 1];
-                model->normals[3 * numnormals + 2] = 
-                    model->facetnorms[3 * T(node->index).findex + 2];
+                vertexnorms[numnormals] = facetnorms[T(node->index).findex];
                 if (T(node->index).vindices[0] == i)
                     T(node->index).nindices[0] = numnormals;
                 else if (T(node->index).vindices[1] == i)
@@ -1119,16 +1113,11 @@ glmVertexNormals(GLMmodel* model, GLfloat angle)
     
     model->numnormals = numnormals - 1;
     
-    /* free the member information */
-    for (i = 1; i <= model->numvertices; i++) {
-        node = members[i];
-        while (node) {
-            tail = node;
-            node = node->next;
-            free(tail);
-        }
+    /* free the member information, the arena is released by the mark */
+    if (heap) {
+        free(nodes);
+        free(members);
     }
-    free(members);
     
     /* pack the normals array (we previously allocated the maximum
     number of normals that could possibly be created (numtriangles *
@@ -1303,6 +1292,7 @@ glmDelete(GLMmodel* model)
 GLMmodel* 
 glmReadOBJ(char* filename)
 {
+    PROFILE_ZONE("glmReadOBJ");
     GLMmodel* model;
     FILE* file;
     
@@ -1796,6 +1786,7 @@ glmReadPPM(char* filename, int width, int height)
 GLubyte* 
 glmReadPPM(char* filename, int* width, int* height)
 {
+    PROFILE_ZONE("glmReadPPM");
     FILE* fp;
     int i, w, h, d;
     unsigned char* image;
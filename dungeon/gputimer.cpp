@@ -0,0 +1,104 @@
+#include "gputimer.h"
+#include "profiler.h"
+#include "timer.h"
+
+GpuTimer::GpuTimer() : dropped(0), available(false), current(0), open(-1), offset(0), nResults(0)
+{
+	for(int i = 0; i < gpuTimerFrames; i++)
+	{
+		frames[i].nPhases = 0;
+		frames[i].pending = false;
+	}
+}
+
+GpuTimer::~GpuTimer()
+{
+}
+
+// create the queries, false if the context has no timer queries
+bool GpuTimer::create()
+{
+	available = GLEW_ARB_timer_query != GL_FALSE;
+	if(!available) return false;
+
+	for(int i = 0; i < gpuTimerFrames; i++)
+	{
+		glGenQueries(2 * maxGpuTimerPhases, frames[i].queries);
+	}
+
+	// relate the GPU clock to the CPU clock for the profiler
+	GLint64 gpuTime;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	offset = currentTime() - gpuTime * 1e-6;
+	return true;
+}
+
+// delete the queries
+void GpuTimer::destroy()
+{
+	if(!available) return;
+	for(int i = 0; i < gpuTimerFrames; i++)
+	{
+		glDeleteQueries(2 * maxGpuTimerPhases, frames[i].queries);
+		frames[i].pending = false;
+	}
+	available = false;
+}
+
+// start a frame in the oldest slot, reading its results if they are ready
+void GpuTimer::beginFrame()
+{
+	if(!available) return;
+
+	current = (current + 1) % gpuTimerFrames;
+	Frame& frame = frames[current];
+	if(frame.pending)
+	{
+		// queries complete in order, so the last one tells about all
+		GLuint ready = GL_FALSE;
+		glGetQueryObjectuiv(frame.queries[2 * frame.nPhases - 1], GL_QUERY_RESULT_AVAILABLE, &ready);
+		if(ready) read(frame);
+		else dropped++;
+	}
+	frame.nPhases = 0;
+	frame.pending = false;
+	open = -1; // a phase left open in the last frame is dropped, its start query is never read
+}
+
+// start timing a phase of the current frame
+void GpuTimer::begin(const char* name)
+{
+	Frame& frame = frames[current];
+	if(!available || open >= 0 || frame.nPhases == maxGpuTimerPhases) return;
+
+	open = frame.nPhases;
+	frame.names[open] = name;
+	glQueryCounter(frame.queries[2 * open], GL_TIMESTAMP);
+}
+
+// stop timing the phase begun last
+void GpuTimer::end()
+{
+	if(!available || open < 0) return;
+
+	Frame& frame = frames[current];
+	glQueryCounter(frame.queries[2 * open + 1], GL_TIMESTAMP);
+	frame.nPhases = open + 1;
+	frame.pending = true;
+	open = -1;
+}
+
+// take the results of a finished frame
+void GpuTimer::read(Frame& frame)
+{
+	for(int i = 0; i < frame.nPhases; i++)
+	{
+		GLuint64 start, end;
+		glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &end);
+		resultNames[i] = frame.names[i];
+		resultTimes[i] = (end - start) * 1e-6;
+		PROFILE_GPU(frame.names[i], start * 1e-6 + offset, end * 1e-6 + offset);
+	}
+	nResults = frame.nPhases;
+}
@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- gputimer.h ---
+//
+//   GPU timing of the render phases with timestamp queries.  The queries
+//   of a frame are read gpuTimerFrames frames later, only if the results
+//   are already there, so the CPU never waits for the GPU.  The phases
+//   also go to the GPU track of the profiler.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __GPUTIMER_H__
+#define __GPUTIMER_H__
+
+#include "Angel.h"
+
+const int gpuTimerFrames = 4;    // frames in flight before the results are read
+const int maxGpuTimerPhases = 8; // phases timed per frame
+
+// timestamp queries of the render phases
+class GpuTimer
+{
+public:
+	int dropped; // frames whose results were not ready in time
+
+	GpuTimer();
+	~GpuTimer();
+
+	bool create();
+	void destroy();
+	bool isAvailable() const { return available; }
+
+	void beginFrame();
+	void begin(const char* name);
+	void end();
+
+	int getPhaseCount() const { return nResults; }
+	const char* getPhaseName(int i) const { return resultNames[i]; }
+	double getPhaseTime(int i) const { return resultTimes[i]; }
+
+private:
+	// queries of one frame
+	struct Frame
+	{
+		GLuint queries[2 * maxGpuTimerPhases]; // start and end of each phase
+		const char* names[maxGpuTimerPhases];
+		int nPhases;  // phases begun and ended, only their queries are read
+		bool pending; // issued and not read yet
+	};
+
+	void read(Frame& frame);
+
+	bool available;
+	Frame frames[gpuTimerFrames];
+	int current;   // frame being recorded
+	int open;      // phase begun and not ended, -1 if none
+	double offset; // CPU time minus GPU time in milliseconds
+
+	// phases of the last frame read back
+	const char* resultNames[maxGpuTimerPhases];
+	double resultTimes[maxGpuTimerPhases]; // in milliseconds
+	int nResults;
+};
+
+#endif // __GPUTIMER_H__
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <vector>
+#include "headless.h"
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::HeadlessContext() : width(0), height(0), display(NULL), context(NULL), framebuffer(0), colorBuffer(0), depthBuffer(0)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	destroy();
+}
+
+// create the context and the framebuffer, false if offscreen rendering is not available
+bool HeadlessContext::create(int width, int height)
+{
+#ifdef __linux__
+	this->width = width;
+	this->height = height;
+
+	// display without a window system
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLDisplay eglDisplay = getPlatformDisplay ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL) : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	EGLint major, minor;
+	if(eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor))
+	{
+		fprintf(stderr, "headless: no EGL display\n");
+		return false;
+	}
+	display = eglDisplay;
+
+	// desktop OpenGL compatibility context for the GLSL 1.20 shaders
+	const EGLint attributes[] = {EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT, EGL_NONE};
+	eglBindAPI(EGL_OPENGL_API);
+	EGLContext eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+	if(eglContext == EGL_NO_CONTEXT) eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, NULL);
+	if(eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+	{
+		fprintf(stderr, "headless: no surfaceless OpenGL context (error 0x%x)\n", eglGetError());
+		destroy();
+		return false;
+	}
+	context = eglContext;
+
+	// load the OpenGL functions, the GLX part of glew fails without an X display
+	glewInit();
+	if(!glGenFramebuffers)
+	{
+		fprintf(stderr, "headless: no framebuffer objects\n");
+		destroy();
+		return false;
+	}
+
+	// color and depth buffers to render into
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		fprintf(stderr, "headless: incomplete framebuffer\n");
+		destroy();
+		return false;
+	}
+	glViewport(0, 0, width, height);
+
+	printf("headless: %s, OpenGL %s, %dx%d\n", glGetString(GL_RENDERER), glGetString(GL_VERSION), width, height);
+	return true;
+#else
+	fprintf(stderr, "headless: offscreen rendering is only available on Linux\n");
+	return false;
+#endif
+}
+
+// release the framebuffer and the context
+void HeadlessContext::destroy()
+{
+#ifdef __linux__
+	if(context)
+	{
+		if(framebuffer) glDeleteFramebuffers(1, &framebuffer);
+		if(colorBuffer) glDeleteRenderbuffers(1, &colorBuffer);
+		if(depthBuffer) glDeleteRenderbuffers(1, &depthBuffer);
+		eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+	}
+	if(display) eglTerminate((EGLDisplay)display);
+#endif
+	framebuffer = colorBuffer = depthBuffer = 0;
+	context = NULL;
+	display = NULL;
+}
+
+// save the rendered frame as a raw PPM file
+bool HeadlessContext::writeFrame(const char* filename)
+{
+	std::vector<GLubyte> pixels(width * height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	FILE* file = fopen(filename, "wb");
+	if(!file) return false;
+
+	// rows from top to bottom
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	for(int y = height - 1; y >= 0; y--)
+	{
+		fwrite(&pixels[y * width * 3], 1, width * 3, file);
+	}
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,35 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- headless.h ---
+//
+//   Offscreen rendering without a window: a surfaceless EGL context (Mesa
+//   llvmpipe on hosts without a GPU) draws into a framebuffer object of
+//   the chosen size.  Only available on Linux, link with -lEGL.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __HEADLESS_H__
+#define __HEADLESS_H__
+
+#include "Angel.h"
+
+// window-less OpenGL context rendering into a framebuffer object
+class HeadlessContext
+{
+public:
+	int width, height; // framebuffer size in pixels
+
+	HeadlessContext();
+	~HeadlessContext();
+
+	bool create(int width, int height);
+	void destroy();
+	bool writeFrame(const char* filename);
+
+private:
+	void* display; // EGL display
+	void* context; // EGL context
+	GLuint framebuffer, colorBuffer, depthBuffer;
+};
+
+#endif // __HEADLESS_H__
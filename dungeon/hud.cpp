@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <string.h>
+#include "hud.h"
+
+RenderMemory renderMemory;
+
+// 5x7 glyphs of the characters from ' ' to '_', one byte per column, top row in the lowest bit
+static const unsigned char glyphs[64][5] =
+{
+	{0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7F, 0x14, 0x7F, 0x14}, // space ! " #
+	{0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, // $ % & '
+	{0x00, 0x1C, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08}, // ( ) * +
+	{0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02}, // , - . /
+	{0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, // 0 1 2 3
+	{0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03}, // 4 5 6 7
+	{0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00}, // 8 9 : ;
+	{0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14}, {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, // < = > ?
+	{0x32, 0x49, 0x79, 0x41, 0x3E}, {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22}, // @ A B C
+	{0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x01, 0x01}, {0x3E, 0x41, 0x41, 0x51, 0x32}, // D E F G
+	{0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, // H I J K
+	{0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x04, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E}, // L M N O
+	{0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31}, // P Q R S
+	{0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F}, // T U V W
+	{0x63, 0x14, 0x08, 0x14, 0x63}, {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x00, 0x7F, 0x41, 0x41}, // X Y Z [
+	{0x02, 0x04, 0x08, 0x10, 0x20}, {0x41, 0x41, 0x7F, 0x00, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40}, // \ ] ^ _
+};
+
+// atlas of 16x5 cells of 6x8 pixels, the glyphs followed by a solid cell for the rectangles
+const int cellWidth = 6, cellHeight = 8;
+const int atlasColumns = 16, atlasRows = 5;
+const int atlasWidth = atlasColumns * cellWidth, atlasHeight = atlasRows * cellHeight;
+const int solidCell = 64;
+const float glyphScale = 2; // screen pixels per atlas pixel
+
+// colors as 0xAABBGGRR
+const unsigned hudBackground = 0xA0000000;
+const unsigned hudText = 0xFFFFFFFF;
+const unsigned hudFrameColor = 0xFF40D040;
+const unsigned hudGpuColor = 0xFF2090FF;
+const unsigned hudTargetColor = 0x80FFFFFF;
+
+Hud::Hud() : visible(false), program(0), vao(0), buffer(0), atlas(0), width(1), height(1), frame(0)
+{
+	for(int i = 0; i < hudHistory; i++)
+	{
+		frameTimes[i] = gpuTimes[i] = 0;
+	}
+}
+
+Hud::~Hud()
+{
+}
+
+// create the atlas, the buffer and the shader, false if the context has no vertex array objects
+bool Hud::create()
+{
+	if(!GLEW_ARB_vertex_array_object) return false;
+
+	// rasterize the glyphs into the atlas
+	GLubyte pixels[atlasWidth * atlasHeight] = {0};
+	for(int c = 0; c <= solidCell; c++)
+	{
+		int x0 = (c % atlasColumns) * cellWidth, y0 = (c / atlasColumns) * cellHeight;
+		for(int x = 0; x < cellWidth; x++)
+		{
+			for(int y = 0; y < cellHeight; y++)
+			{
+				bool set = c == solidCell || (x < 5 && y < 7 && (glyphs[c][x] >> y & 1));
+				if(set) pixels[(y0 + y) * atlasWidth + x0 + x] = 255;
+			}
+		}
+	}
+	glGenTextures(1, &atlas);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, atlasWidth, atlasHeight, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, pixels);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	program = InitShader("vshaderHud_v120.glsl", "fshaderHud_v120.glsl");
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "atlas"), 0);
+
+	// the vertex layout is kept in the vertex array object
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	GLuint vPosition_loc = glGetAttribLocation(program, "vPosition");
+	GLuint vTexture_loc = glGetAttribLocation(program, "vTexture");
+	GLuint vColor_loc = glGetAttribLocation(program, "vColor");
+	glEnableVertexAttribArray(vPosition_loc);
+	glVertexAttribPointer(vPosition_loc, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(0));
+	glEnableVertexAttribArray(vTexture_loc);
+	glVertexAttribPointer(vTexture_loc, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(2 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(vColor_loc);
+	glVertexAttribPointer(vColor_loc, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), BUFFER_OFFSET(4 * sizeof(GLfloat)));
+	glBindVertexArray(0);
+	return true;
+}
+
+// delete the GL objects
+void Hud::destroy()
+{
+	if(!vao) return;
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &buffer);
+	glDeleteTextures(1, &atlas);
+	glDeleteProgram(program);
+	vao = buffer = atlas = program = 0;
+}
+
+// size of the window in pixels
+void Hud::resize(int width, int height)
+{
+	this->width = width > 0 ? width : 1;
+	this->height = height > 0 ? height : 1;
+}
+
+// add the times of a frame to the graph
+void Hud::addFrame(double frameTime, double gpuTime)
+{
+	frameTimes[frame % hudHistory] = (float)frameTime;
+	gpuTimes[frame % hudHistory] = (float)gpuTime;
+	frame++;
+}
+
+// two triangles of a quad
+void Hud::addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, unsigned color)
+{
+	GLubyte r = (GLubyte)color, g = (GLubyte)(color >> 8), b = (GLubyte)(color >> 16), a = (GLubyte)(color >> 24);
+	Vertex corners[4] = {{x0, y0, u0, v0, {r, g, b, a}}, {x1, y0, u1, v0, {r, g, b, a}}, {x1, y1, u1, v1, {r, g, b, a}}, {x0, y1, u0, v1, {r, g, b, a}}};
+
+	// counter-clockwise on the screen, which is flipped vertically
+	static const int order[6] = {0, 3, 2, 0, 2, 1};
+	for(int i = 0; i < 6; i++)
+	{
+		vertices.push_back(corners[order[i]]);
+	}
+}
+
+// solid rectangle
+void Hud::addRect(float x0, float y0, float x1, float y1, unsigned color)
+{
+	float u = ((solidCell % atlasColumns) * cellWidth + cellWidth * 0.5f) / atlasWidth;
+	float v = ((solidCell / atlasColumns) * cellHeight + cellHeight * 0.5f) / atlasHeight;
+	addQuad(x0, y0, x1, y1, u, v, u, v, color);
+}
+
+// line of text, lower case shown as upper case
+void Hud::addText(float x, float y, const char* text, unsigned color)
+{
+	for(; *text; text++, x += cellWidth * glyphScale)
+	{
+		int c = *text >= 'a' && *text <= 'z' ? *text - 'a' + 'A' : *text;
+		if(c <= ' ' || c > '_') continue;
+		c -= ' ';
+
+		float u0 = (float)((c % atlasColumns) * cellWidth) / atlasWidth;
+		float v0 = (float)((c / atlasColumns) * cellHeight) / atlasHeight;
+		float u1 = u0 + (float)cellWidth / atlasWidth;
+		float v1 = v0 + (float)cellHeight / atlasHeight;
+		addQuad(x, y, x + cellWidth * glyphScale, y + cellHeight * glyphScale, u0, v0, u1, v1, color);
+	}
+}
+
+// draw the graph and the counters over the frame
+void Hud::draw(const RenderCounters& counters, const RenderMemory& memory)
+{
+	if(!visible || !vao) return;
+
+	// frame times of the history
+	int n = frame < hudHistory ? frame : hudHistory;
+	float frameTotal = 0, gpuTotal = 0, frameMax = 0;
+	for(int i = 0; i < n; i++)
+	{
+		frameTotal += frameTimes[i];
+		gpuTotal += gpuTimes[i];
+		if(frameTimes[i] > frameMax) frameMax = frameTimes[i];
+	}
+	float frameAverage = n ? frameTotal / n : 0;
+	float gpuAverage = n ? gpuTotal / n : 0;
+
+	// text lines
+	char lines[8][64];
+	int nLines = 0;
+	sprintf(lines[nLines++], "frame %6.2f ms  max %6.2f ms", frameAverage, frameMax);
+	sprintf(lines[nLines++], "gpu   %6.2f ms", gpuAverage);
+	sprintf(lines[nLines++], "draw calls  %d", counters.drawCalls);
+	sprintf(lines[nLines++], "triangles   %d (%d culled)", counters.triangles, counters.culledTriangles);
+	sprintf(lines[nLines++], "uniforms    %d", counters.uniformChanges);
+	sprintf(lines[nLines++], "state       %d", counters.stateChanges);
+	sprintf(lines[nLines++], "textures    %.1f MB", memory.textureBytes / 1048576.0);
+	sprintf(lines[nLines++], "buffers     %.1f MB", memory.bufferBytes / 1048576.0);
+
+	// layout from the top left corner
+	const float margin = 8, lineHeight = cellHeight * glyphScale + 2;
+	const float graphHeight = 64, barWidth = 2, graphScale = graphHeight / 33.3f; // 30 Hz at the top
+	float panelWidth = hudHistory * barWidth;
+	for(int i = 0; i < nLines; i++)
+	{
+		float lineWidth = strlen(lines[i]) * cellWidth * glyphScale;
+		if(lineWidth > panelWidth) panelWidth = lineWidth;
+	}
+	panelWidth += 2 * margin;
+	float graphTop = margin + nLines * lineHeight + margin;
+	float panelHeight = graphTop + graphHeight + margin;
+
+	vertices.clear();
+	addRect(0, 0, panelWidth, panelHeight, hudBackground);
+	for(int i = 0; i < nLines; i++)
+	{
+		addText(margin, margin + i * lineHeight, lines[i], hudText);
+	}
+
+	// bars of the frame and GPU times, the oldest frame on the left
+	float bottom = graphTop + graphHeight;
+	for(int i = 0; i < n; i++)
+	{
+		int index = (frame - n + i) % hudHistory;
+		float x = margin + (hudHistory - n + i) * barWidth;
+		float frameHeight = frameTimes[index] * graphScale;
+		float gpuHeight = gpuTimes[index] * graphScale;
+		if(frameHeight > graphHeight) frameHeight = graphHeight;
+		if(gpuHeight > graphHeight) gpuHeight = graphHeight;
+		addRect(x, bottom - frameHeight, x + barWidth, bottom, hudFrameColor);
+		addRect(x, bottom - gpuHeight, x + barWidth, bottom, hudGpuColor);
+	}
+	addRect(margin, bottom - 16.7f * graphScale, margin + hudHistory * barWidth, bottom - 16.7f * graphScale + 1, hudTargetColor); // 60 Hz
+
+	// everything in one draw over the frame
+	glUseProgram(program);
+	glUniform2f(glGetUniformLocation(program, "screen_size"), (GLfloat)width, (GLfloat)height);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STREAM_DRAW);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+}
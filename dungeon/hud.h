@@ -0,0 +1,76 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- hud.h ---
+//
+//   On-screen performance overlay.  The frame time graph and the counters
+//   of the frame are written as quads textured from a glyph atlas into one
+//   vertex buffer and drawn with a single draw call.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __HUD_H__
+#define __HUD_H__
+
+#include <vector>
+#include "Angel.h"
+
+// what was submitted in a frame, filled by the drawing code
+struct RenderCounters
+{
+	int drawCalls;
+	int triangles;       // triangles submitted
+	int culledTriangles; // triangles of the objects culled
+	int uniformChanges;  // uniform values set
+	int stateChanges;    // buffer, texture, program and attribute bindings
+};
+
+// memory allocated on the GPU
+struct RenderMemory
+{
+	long long textureBytes;
+	long long bufferBytes;
+};
+
+extern RenderCounters renderCounters;
+extern RenderMemory renderMemory;
+
+const int hudHistory = 128; // frames in the graph
+
+// performance overlay
+class Hud
+{
+public:
+	bool visible;
+
+	Hud();
+	~Hud();
+
+	bool create();
+	void destroy();
+	void resize(int width, int height);
+
+	void addFrame(double frameTime, double gpuTime);
+	void draw(const RenderCounters& counters, const RenderMemory& memory);
+
+private:
+	// vertex of the overlay quads
+	struct Vertex
+	{
+		GLfloat x, y; // in pixels from the top left corner
+		GLfloat u, v; // atlas coordinates
+		GLubyte color[4];
+	};
+
+	void addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, unsigned color);
+	void addRect(float x0, float y0, float x1, float y1, unsigned color);
+	void addText(float x, float y, const char* text, unsigned color);
+
+	GLuint program, vao, buffer, atlas;
+	int width, height;
+	std::vector<Vertex> vertices; // quads of the frame
+	float frameTimes[hudHistory]; // CPU time spent on every frame in milliseconds
+	float gpuTimes[hudHistory];   // in milliseconds
+	int frame;                    // frames added so far
+};
+
+#endif // __HUD_H__
@@ -0,0 +1,249 @@
+#include <string.h>
+#include <new>
+#include "indirect.h"
+#include "hud.h"
+
+IndirectRenderer::IndirectRenderer() : nDraws(0), commands(NULL), drawData(NULL), nCollected(0), maxDraws(0), program(0), vao(0), vertexBuffer(0), indexBuffer(0), frameBuffer(0), drawBuffer(0), commandBuffer(0),
+	ring(NULL), uniformAlignment(256), storageAlignment(256), textureArray(0)
+{
+}
+
+IndirectRenderer::~IndirectRenderer()
+{
+	for(int i = 0; i < (int)stagingLayers.size(); i++)
+	{
+		free(stagingLayers[i]);
+	}
+}
+
+// append the triangle list to the shared buffers, returns the mesh ID
+int IndirectRenderer::addMesh(const vec3* vertices, const vec3* normals, const vec2* texcoords, int nVertices)
+{
+	Mesh mesh;
+	mesh.firstIndex = (GLuint)stagingIndices.size();
+	mesh.count = nVertices;
+	mesh.baseVertex = (GLint)(stagingVertices.size() / 8);
+
+	for(int i = 0; i < nVertices; i++)
+	{
+		GLfloat vertex[8] = {vertices[i].x, vertices[i].y, vertices[i].z, normals[i].x, normals[i].y, normals[i].z, texcoords[i].x, texcoords[i].y};
+		stagingVertices.insert(stagingVertices.end(), vertex, vertex + 8);
+		stagingIndices.push_back(i);
+	}
+
+	meshes.push_back(mesh);
+	return (int)meshes.size() - 1;
+}
+
+// resample the RGB texture to the layer size and keep it for the texture array
+void IndirectRenderer::addTexture(int layer, const GLubyte* data, int width, int height)
+{
+	if(layer >= (int)stagingLayers.size()) stagingLayers.resize(layer + 1, NULL);
+	free(stagingLayers[layer]);
+
+	const int size = indirectTextureSize;
+	GLubyte* pixels = (GLubyte*)malloc(size * size * 3);
+	for(int y = 0; y < size; y++)
+	{
+		// bilinear filtering of the source texture
+		float sy = (y + 0.5f) * height / size - 0.5f;
+		int y0 = sy < 0 ? 0 : (int)sy;
+		int y1 = y0 + 1 < height ? y0 + 1 : height - 1;
+		float fy = sy - y0 < 0 ? 0 : sy - y0;
+		for(int x = 0; x < size; x++)
+		{
+			float sx = (x + 0.5f) * width / size - 0.5f;
+			int x0 = sx < 0 ? 0 : (int)sx;
+			int x1 = x0 + 1 < width ? x0 + 1 : width - 1;
+			float fx = sx - x0 < 0 ? 0 : sx - x0;
+			for(int c = 0; c < 3; c++)
+			{
+				float a = data[3*(y0*width + x0) + c] * (1 - fx) + data[3*(y0*width + x1) + c] * fx;
+				float b = data[3*(y1*width + x0) + c] * (1 - fx) + data[3*(y1*width + x1) + c] * fx;
+				pixels[3*(y*size + x) + c] = (GLubyte)(a * (1 - fy) + b * fy + 0.5f);
+			}
+		}
+	}
+	stagingLayers[layer] = pixels;
+}
+
+// create the buffers and the shader, false if the context has no multi-draw indirect
+bool IndirectRenderer::create(RingBuffer* ring)
+{
+	bool supported = GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_draw_parameters && GLEW_ARB_shader_storage_buffer_object && GLEW_EXT_texture_array;
+	if(supported)
+	{
+		program = InitShader("vshaderIndirect_v430.glsl", "fshaderIndirect_v430.glsl");
+
+		// shared vertex and index buffers
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+		glGenBuffers(1, &vertexBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, stagingVertices.size() * sizeof(GLfloat), &stagingVertices[0], GL_STATIC_DRAW);
+		glGenBuffers(1, &indexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, stagingIndices.size() * sizeof(GLuint), &stagingIndices[0], GL_STATIC_DRAW);
+		renderMemory.bufferBytes += stagingVertices.size() * sizeof(GLfloat) + stagingIndices.size() * sizeof(GLuint);
+
+		// interleaved position, normal and texture coordinates
+		GLsizei stride = 8 * sizeof(GLfloat);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(0));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(3 * sizeof(GLfloat)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(6 * sizeof(GLfloat)));
+		glBindVertexArray(0);
+
+		// per frame data, per draw data and draw commands, filled every frame
+		// in the ring or, without one, in these buffers
+		this->ring = ring && ring->isAvailable() ? ring : NULL;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+		glGenBuffers(1, &frameBuffer);
+		glGenBuffers(1, &drawBuffer);
+		glGenBuffers(1, &commandBuffer);
+
+		// all textures in one array
+		const int size = indirectTextureSize;
+		glGenTextures(1, &textureArray);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, size, size, (GLsizei)stagingLayers.size(), 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+		for(int i = 0; i < (int)stagingLayers.size(); i++)
+		{
+			if(stagingLayers[i]) glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, size, size, 1, GL_RGB, GL_UNSIGNED_BYTE, stagingLayers[i]);
+		}
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		renderMemory.textureBytes += (long long)size * size * 3 * stagingLayers.size() * 4 / 3;
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+
+	// data in system memory is no longer needed
+	std::vector<GLfloat>().swap(stagingVertices);
+	std::vector<GLuint>().swap(stagingIndices);
+	for(int i = 0; i < (int)stagingLayers.size(); i++)
+	{
+		free(stagingLayers[i]);
+	}
+	stagingLayers.clear();
+
+	return supported;
+}
+
+// ring bytes used by a frame of nDraws draws, with the alignment of every range
+GLsizeiptr IndirectRenderer::frameBytes(int nDraws) const
+{
+	return sizeof(FrameData) + uniformAlignment + nDraws * sizeof(DrawData) + storageAlignment + nDraws * sizeof(DrawCommand) + sizeof(GLuint);
+}
+
+// start collecting at most maxDraws draws of a frame
+void IndirectRenderer::begin(Arena& arena, int maxDraws)
+{
+	commands = arena.allocateArray<DrawCommand>(maxDraws);
+	drawData = arena.allocateArray<DrawData>(maxDraws);
+	if(!commands || !drawData)
+	{
+		heapCommands.resize(maxDraws);
+		heapDrawData.resize(maxDraws);
+		commands = &heapCommands[0];
+		drawData = &heapDrawData[0];
+	}
+	this->maxDraws = maxDraws;
+	nCollected = 0;
+}
+
+// add a draw of the mesh
+void IndirectRenderer::add(int mesh, int texture, const Transform& worldTransform, const Material& material)
+{
+	if(nCollected == maxDraws) return;
+
+	DrawCommand command;
+	command.count = meshes[mesh].count;
+	command.instanceCount = 1;
+	command.firstIndex = meshes[mesh].firstIndex;
+	command.baseVertex = meshes[mesh].baseVertex;
+	command.baseInstance = (GLuint)nCollected;
+	commands[nCollected] = command;
+
+	DrawData data;
+	data.modelMatrix = worldTransform.toMat4();
+	data.ambient = material.ambient;
+	data.diffuse = material.diffuse;
+	data.specular = material.specular;
+	data.shininess = material.shininess;
+	data.layer = texture;
+	new(&drawData[nCollected]) DrawData(data);
+	nCollected++;
+}
+
+// copy the data to the ring or, if it does not fit, to the fallback buffer
+GLuint IndirectRenderer::upload(GLenum target, GLuint fallback, const void* data, GLsizeiptr size, GLsizeiptr alignment, GLintptr* offset)
+{
+	void* memory = ring ? ring->allocate(size, alignment, offset) : NULL;
+	if(memory)
+	{
+		memcpy(memory, data, size);
+		return ring->buffer;
+	}
+
+	glBindBuffer(target, fallback);
+	glBufferData(target, size, data, GL_STREAM_DRAW);
+	renderCounters.stateChanges++;
+	*offset = 0;
+	return fallback;
+}
+
+// submit all collected draws at once
+void IndirectRenderer::draw(const mat4& viewMatrix, const mat4& projMatrix, const Light* lights, const vec3& spotDirection, float flash)
+{
+	nDraws = nCollected;
+	if(nDraws == 0) return;
+
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "textures"), 1);
+	renderCounters.stateChanges++;
+	renderCounters.uniformChanges++;
+
+	// camera and lights
+	FrameData frame;
+	frame.viewMatrix = viewMatrix;
+	frame.projMatrix = projMatrix;
+	for(int i = 0; i < 2; i++)
+	{
+		float scale = i == 1 ? flash : 1.0f;
+		frame.lightAmbient[i] = lights[i].ambient * scale;
+		frame.lightDiffuse[i] = lights[i].diffuse * scale;
+		frame.lightSpecular[i] = lights[i].specular * scale;
+		frame.lightPosition[i] = lights[i].position;
+	}
+	frame.spotDirection = vec4(spotDirection, 0);
+
+	// move the per frame data, the per draw data and the commands to the GPU
+	GLintptr offset;
+	GLsizeiptr size = sizeof(FrameData);
+	GLuint buffer = upload(GL_UNIFORM_BUFFER, frameBuffer, &frame, size, uniformAlignment, &offset);
+	glBindBufferRange(GL_UNIFORM_BUFFER, 0, buffer, offset, size);
+	size = nDraws * sizeof(DrawData);
+	buffer = upload(GL_SHADER_STORAGE_BUFFER, drawBuffer, drawData, size, storageAlignment, &offset);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, buffer, offset, size);
+	buffer = upload(GL_DRAW_INDIRECT_BUFFER, commandBuffer, commands, nDraws * sizeof(DrawCommand), sizeof(GLuint), &offset);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+	renderCounters.stateChanges += 3;
+
+	// draw everything
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+	glBindVertexArray(vao);
+	renderCounters.stateChanges += 3;
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, BUFFER_OFFSET(offset), nDraws, 0);
+	renderCounters.drawCalls++;
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+	renderCounters.stateChanges += 3;
+}
@@ -0,0 +1,101 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- indirect.h ---
+//
+//   Submission of the whole visible scene with a single multi-draw
+//   indirect call.  All meshes live in one shared vertex/index buffer,
+//   all textures in one texture array and the per-object transforms and
+//   materials in a shader storage buffer indexed by gl_DrawIDARB.  The
+//   per-frame data goes through the frame ring buffer when there is one.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __INDIRECT_H__
+#define __INDIRECT_H__
+
+#include <vector>
+#include "Angel.h"
+#include "scene.h"
+#include "ringbuffer.h"
+#include "arena.h"
+
+const int indirectTextureSize = 1024; // size of the texture array layers
+
+// single draw submission of many objects
+class IndirectRenderer
+{
+public:
+	int nDraws; // draws submitted in the last frame
+
+	IndirectRenderer();
+	~IndirectRenderer();
+
+	int addMesh(const vec3* vertices, const vec3* normals, const vec2* texcoords, int nVertices);
+	void addTexture(int layer, const GLubyte* data, int width, int height);
+	bool create(RingBuffer* ring = NULL);
+	bool isAvailable() const { return program != 0; }
+	GLsizeiptr frameBytes(int nDraws) const;
+
+	void begin(Arena& arena, int maxDraws);
+	void add(int mesh, int texture, const Transform& worldTransform, const Material& material);
+	void draw(const mat4& viewMatrix, const mat4& projMatrix, const Light* lights, const vec3& spotDirection, float flash);
+
+private:
+	// location of a mesh in the shared buffers
+	struct Mesh
+	{
+		GLuint firstIndex, count;
+		GLint baseVertex;
+	};
+
+	// layout given by glMultiDrawElementsIndirect
+	struct DrawCommand
+	{
+		GLuint count, instanceCount, firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// per frame data in the std140 layout of the shader
+	struct FrameData
+	{
+		mat4 viewMatrix, projMatrix;
+		vec4 lightAmbient[2], lightDiffuse[2], lightSpecular[2], lightPosition[2];
+		vec4 spotDirection;
+	};
+
+	// per draw data in the std430 layout of the shader
+	struct DrawData
+	{
+		mat4 modelMatrix;
+		vec4 ambient, diffuse, specular;
+		float shininess;
+		int layer;
+		float padding[2];
+	};
+
+	std::vector<Mesh> meshes;
+
+	// draws of the frame in the frame arena, or on the heap if they do not fit
+	DrawCommand* commands;
+	DrawData* drawData;
+	int nCollected, maxDraws;
+	std::vector<DrawCommand> heapCommands;
+	std::vector<DrawData> heapDrawData;
+
+	// data kept in system memory until the buffers are created
+	std::vector<GLfloat> stagingVertices; // interleaved position, normal and texture coordinates
+	std::vector<GLuint> stagingIndices;
+	std::vector<GLubyte*> stagingLayers;
+
+	GLuint upload(GLenum target, GLuint fallback, const void* data, GLsizeiptr size, GLsizeiptr alignment, GLintptr* offset);
+
+	GLuint program;
+	GLuint vao, vertexBuffer, indexBuffer, frameBuffer, drawBuffer, commandBuffer;
+	RingBuffer* ring;           // per-frame data, NULL to upload with glBufferData
+	GLint uniformAlignment;     // offset alignment of uniform buffer ranges
+	GLint storageAlignment;     // offset alignment of shader storage buffer ranges
+	GLuint textureArray;
+};
+
+#endif // __INDIRECT_H__
@@ -0,0 +1,140 @@
+#include <string.h>
+#include "inputlog.h"
+
+static const char inputMagic[4] = {'D', 'N', 'G', 'I'};
+static const unsigned inputVersion = 1;
+static const int inputEventSize = 11;
+
+// little endian helpers
+static void putInt(unsigned char* p, unsigned value, int bytes)
+{
+	for(int i = 0; i < bytes; i++) p[i] = (unsigned char)(value >> (8 * i));
+}
+
+static unsigned getInt(const unsigned char* p, int bytes)
+{
+	unsigned value = 0;
+	for(int i = 0; i < bytes; i++) value |= (unsigned)p[i] << (8 * i);
+	return value;
+}
+
+InputLog::InputLog() : file(NULL), recorded(0), position(0), endTick(0), replaying(false), dispatching(false)
+{
+}
+
+InputLog::~InputLog()
+{
+	if(file) fclose(file);
+}
+
+// start writing the input to the file
+bool InputLog::startRecording(const char* filename)
+{
+	file = fopen(filename, "wb");
+	if(!file)
+	{
+		fprintf(stderr, "input log: cannot write %s\n", filename);
+		return false;
+	}
+
+	unsigned char header[8];
+	memcpy(header, inputMagic, 4);
+	putInt(header + 4, inputVersion, 4);
+	fwrite(header, 1, sizeof(header), file);
+	recorded = 0;
+	return true;
+}
+
+// load the file to feed its events back
+bool InputLog::startReplay(const char* filename)
+{
+	FILE* input = fopen(filename, "rb");
+	if(!input)
+	{
+		fprintf(stderr, "input log: cannot read %s\n", filename);
+		return false;
+	}
+
+	unsigned char header[8];
+	if(fread(header, 1, sizeof(header), input) != sizeof(header) || memcmp(header, inputMagic, 4) || getInt(header + 4, 4) != inputVersion)
+	{
+		fprintf(stderr, "input log: %s is not an input log of this version\n", filename);
+		fclose(input);
+		return false;
+	}
+
+	events.clear();
+	endTick = 0;
+	unsigned char data[inputEventSize];
+	while(fread(data, 1, inputEventSize, input) == inputEventSize)
+	{
+		InputEvent event;
+		event.tick = getInt(data, 4);
+		event.type = data[4];
+		event.key = data[5];
+		event.state = data[6];
+		event.x = (short)getInt(data + 7, 2);
+		event.y = (short)getInt(data + 9, 2);
+		endTick = event.tick;
+		if(event.type == inputEnd) break;
+		events.push_back(event);
+	}
+	fclose(input);
+
+	position = 0;
+	replaying = true;
+	return true;
+}
+
+// finish the recording or the replay
+void InputLog::stop(unsigned tick)
+{
+	if(file)
+	{
+		accept(tick, inputEnd, 0, 0, 0, 0);
+		fclose(file);
+		file = NULL;
+		printf("input log: %d events recorded over %u ticks\n", recorded - 1, tick);
+	}
+	replaying = false;
+}
+
+// whether the replay has reached the end of the recording
+bool InputLog::isFinished(unsigned tick) const
+{
+	return replaying && position >= (int)events.size() && tick >= endTick;
+}
+
+// record a live event, false if it has to be ignored because the input is replayed
+bool InputLog::accept(unsigned tick, int type, int key, int state, int x, int y)
+{
+	if(replaying) return dispatching;
+
+	if(file)
+	{
+		unsigned char data[inputEventSize];
+		putInt(data, tick, 4);
+		data[4] = (unsigned char)type;
+		data[5] = (unsigned char)key;
+		data[6] = (unsigned char)state;
+		putInt(data + 7, (unsigned)x, 2);
+		putInt(data + 9, (unsigned)y, 2);
+		fwrite(data, 1, inputEventSize, file);
+		fflush(file); // nothing lost if the program is killed
+		recorded++;
+	}
+	return true;
+}
+
+// hand the events of the tick to the input handlers
+void InputLog::replay(unsigned tick, void (*dispatch)(const InputEvent& event))
+{
+	if(!replaying) return;
+
+	dispatching = true;
+	while(position < (int)events.size() && events[position].tick <= tick)
+	{
+		dispatch(events[position++]);
+	}
+	dispatching = false;
+}
@@ -0,0 +1,72 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- inputlog.h ---
+//
+//   Recording and replay of the user input.  Every keyboard and mouse
+//   event is stored with the simulation tick it arrived at in a compact
+//   binary log; a replay feeds the events back at the same ticks, so the
+//   simulation goes through exactly the same states.
+//
+//   File: "DNGI", version (4 bytes), then 11 bytes per event: tick (4),
+//   type, key or button, state (1 each), x, y (2 each), little endian.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __INPUTLOG_H__
+#define __INPUTLOG_H__
+
+#include <stdio.h>
+#include <vector>
+
+// kinds of the logged events
+enum InputType
+{
+	inputKeyboard,
+	inputSpecial,
+	inputSpecialUp,
+	inputMouse,
+	inputMotion,
+	inputEnd // end of the recording
+};
+
+// one input event
+struct InputEvent
+{
+	unsigned tick; // simulation steps done when the event arrived
+	int type;      // InputType
+	int key;       // key code or mouse button
+	int state;     // mouse button state
+	int x, y;      // mouse position
+};
+
+// input recorder and player
+class InputLog
+{
+public:
+	InputLog();
+	~InputLog();
+
+	bool startRecording(const char* filename);
+	bool startReplay(const char* filename);
+	void stop(unsigned tick);
+
+	bool isRecording() const { return file != NULL; }
+	bool isReplaying() const { return replaying; }
+	bool isFinished(unsigned tick) const;
+	unsigned getEndTick() const { return endTick; }
+	int getEventCount() const { return (int)events.size(); }
+
+	bool accept(unsigned tick, int type, int key, int state, int x, int y);
+	void replay(unsigned tick, void (*dispatch)(const InputEvent& event));
+
+private:
+	FILE* file;                      // log being recorded
+	int recorded;                    // events recorded so far
+	std::vector<InputEvent> events;  // events being replayed
+	int position;                    // next event to replay
+	unsigned endTick;                // tick the recording ended at
+	bool replaying;                  // the input comes from the log
+	bool dispatching;                // a logged event is being handled
+};
+
+#endif // __INPUTLOG_H__
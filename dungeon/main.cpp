@@ -1,87 +1,33 @@
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 #include "Angel.h"  // includes gl.h, glut.h and other stuff...
 #include "glm.h"
-
-// material parameters
-struct Material
-{
-	vec4 diffuse, ambient, specular;
-	float shininess;
-};
-
-// light parameters
-struct Light
-{
-	vec4 position;
-	vec4 diffuse, ambient, specular;
-};
-
-// object data
-class Object
-{
-public:
-	bool visible;      // object visibility
-	vec3* vertices;    // vertex positions
-	vec3* normals;     // vertex normals
-	vec2* texcoords;   // vertex texture coordinates
-	int nVertices;     // actual number of vertices
-	Material material; // object material
-	GLuint buffer;     // buffer ID
-	mat4 matrix;       // local object transformation
-	GLuint texture;    // texture IDs
-	Object *next;      // next object in scene graph hierarchy
-	Object *children;  // child objects in scene graph hierarchy
-
-	Object() : visible(true), vertices(NULL), normals(NULL), texcoords(NULL), nVertices(0), buffer(0), texture(0), next(NULL), children(NULL)
-	{
-	}
-
-	void addChild(Object* child)
-	{
-		child->next = children;
-		children = child;
-	}
-};
-
-// scene graph hierarchy
-class SceneGraph
-{
-public:
-	Object *root;
-
-	SceneGraph()
-	{
-		root = new Object;
-	}
-
-	~SceneGraph()
-	{
-		deleteObjects(root);
-	}
-
-	void deleteObjects(Object* object)
-	{
-		// traverse the scene graph 
-		while(object)
-		{
-			// delete object's children recursively
-			deleteObjects(object->children);
-
-			glDeleteBuffers(1, &object->buffer);
-
-			// delete the object and move to the next child
-			Object *next = object->next;
-			delete object;
-			object = next;
-		}
-	}
-};
+#include "scene.h"
+#include "portal.h"
+#include "occlusion.h"
+#include "bvh.h"
+#include "indirect.h"
+#include "softrender.h"
+#include "renderdevice.h"
+#include "ringbuffer.h"
+#include "headless.h"
+#include "swapinterval.h"
+#include "inputlog.h"
+#include "profiler.h"
+#include "gputimer.h"
+#include "perfcounters.h"
+#include "hud.h"
+#include "arena.h"
+#include "timer.h"
+#include "alloctrack.h"
 
 // objects
 SceneGraph sceneGraph;
 vec4 spotPosition;
 vec3 chestPosition(-4, 0, 4);
 GLuint program;  // shader ID
+ObjectLocations objectLocations; // attributes and uniforms of the per-object drawing in the program
 
 // pointers to some objects for individual control
 Object* ground = NULL;
@@ -89,6 +35,48 @@ Object* person = NULL;
 Object* flashlight = NULL;
 Object* room = NULL;
 Object* chest = NULL;
+Object* barrel = NULL;
+
+// cells of the dungeon
+CellGraph cells;
+Cell* outdoorCell = NULL;
+Cell* roomCell = NULL;
+std::vector<PortalRect> clipRects; // screen rectangle of every object in traversal order, the one of its cell narrowed by the parents
+std::vector<int> portalObjects;    // objects seen through a portal, drawn one by one after the single draw
+int windowWidth = 0, windowHeight = 0; // window size in pixels
+
+// bounding volume hierarchy of the scene graph objects
+AABBTree sceneTree;
+std::vector<Object*> queryResults; // objects found by the last query
+int frameNumber = 0;
+
+// multi-draw indirect submission of the whole scene
+IndirectRenderer indirect;
+
+// software rasterizer of the headless runs, NULL when drawing with OpenGL
+SoftRenderer* soft = NULL;
+
+// device of the scene drawing, the null device records the commands without drawing
+GLRenderDevice glDevice;
+NullRenderDevice nullDevice;
+RenderDevice* device = &glDevice;
+
+// persistently mapped ring for the per-frame data, three frames of 4 MB
+RingBuffer frameRing;
+const int maxSubmitObjects = 100000; // objects of the largest submission benchmark run, the ring is resized for it
+
+// GPU time of the render phases, read back a few frames late
+GpuTimer gpuTimer;
+
+// performance overlay
+Hud hud;
+
+// transient data of the frame, and scratch memory of the loaders before the first frame
+Arena frameArena;
+
+// occlusion culling stuff
+OcclusionCuller* occlusion = NULL;
+double reportTime = 0; // last time the statistics were printed
 
 // texture stuff
 const int nTextures = 7; // number of textures for objects
@@ -100,12 +88,58 @@ float yawAngle = 45, pitchAngle = 0;
 vec3 viewPoint(0, 1.2f, -15), viewDirection;
 mat4 viewMatrix, projMatrix;
 
+// simulation stuff
+FixedTimestep timestep(120);  // game logic steps at 120 Hz
+float targetFps = 60;         // frame rate limit, 0 to wait for the vsync in the swap instead
+double nextFrameTime = 0;     // when the next frame is due
+const float moveSpeed = 3;    // travel speed in units per second
+const float turnSpeed = 90;   // rotation speed in degrees per second
+bool moveForward = false, moveBackward = false, turnLeft = false, turnRight = false; // held arrow keys
+unsigned simulationTick = 0;  // simulation steps done so far
+vec3 previousViewPoint;       // viewpoint of the previous step for interpolation
+float previousYawAngle;       // yaw angle of the previous step for interpolation
+const float introDuration = 8; // length of the camera flight at start in seconds
+constexpr Transform flashlightTransform = Transform(Translate(-0.27f, 0.76f, 0) * RotateY(-90)); // flashlight in the hand of the person, folded at compile time
+
+// on-demand rendering stuff
+bool onDemandRendering = true; // draw only when the picture changes
+bool frameDirty = true;        // the picture changed since the last frame
+bool idling = false;           // waiting for events without the idle callback
+int framesDrawn = 0, wakeups = 0;  // since the last report
+double idleStart = 0, idleTime = 0; // start of the idle stretch, idle time since the last report
+int idlePeriod = 0;            // idle stretches begun, the report timer of an earlier one stops
+
 // toggles
-bool interiorScene = false;
 bool firstPersonView = false;
 bool flashlightEnabled = true;
 bool chestPicked = false;
 bool explorationMode = false;
+bool occlusionEnabled = true;
+bool indirectEnabled = false;
+
+// input recording and replay
+InputLog inputLog;
+
+// headless stuff
+bool headless = false; // rendering offscreen without a window
+
+// camera path of the headless runs, the arrow keys held for a while
+struct PathSegment
+{
+	float duration; // in seconds
+	bool forward, backward, left, right;
+};
+const PathSegment cameraPath[] = {
+	{8.5f,  false, false, false, false}, // watch the intro
+	{0.5f,  false, false, false, true},  // face the building
+	{4.3f,  true,  false, false, false}, // walk in through the door
+	{1.0f,  false, false, false, true},  // turn right
+	{1.33f, true,  false, false, false}, // walk past the barrel
+	{1.0f,  false, false, true,  false}, // turn left to the chest
+	{2.1f,  true,  false, false, false}, // walk to the chest and pick it up
+	{4.0f,  false, false, true,  false}, // look around the room
+};
+const int nPathSegments = sizeof(cameraPath) / sizeof(cameraPath[0]);
 
 // exploration stuff
 int mouseX = 0, mouseY = 0; // mouse position
@@ -114,15 +148,31 @@ mat4 explorationMatrix;
 // forward declarations of functions
 void init();
 void display();
+void idle();
+void reportRendering(double now);
+void reportIdle(int period);
+void step();
+void update(float dt);
+void dispatchInput(const InputEvent& event);
+void invalidate();
 void resize(int width, int height);
 void keyboard(unsigned char key, int x, int y);
 void special(int key, int x, int y);
+void specialUp(int key, int x, int y);
 void mouse(int button, int state, int x, int y);
 void motion(int x, int y);
 void close();
+void benchmarkSubmission();
+int runHeadless(int argc, char **argv);
 
 int main(int argc, char **argv)
 {
+	// render offscreen along the camera path and quit if asked
+	if(argc > 1 && !strcmp(argv[1], "-headless"))
+	{
+		return runHeadless(argc, argv);
+	}
+
     glutInit(&argc, argv);	// initialize glut
     glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);  // set display mode to use a double RGBA color framebuffer and a depth buffer
     glutInitWindowSize(800, 600); // set window size
@@ -136,10 +186,37 @@ int main(int argc, char **argv)
 
     init();
 
+	// measure the submission and quit if asked
+	if(argc > 1 && !strcmp(argv[1], "-benchmark-submit"))
+	{
+		benchmarkSubmission();
+		return 0;
+	}
+
+	// record or replay the input and set the frame rate if asked
+	for(int i = 1; i + 1 < argc; i++)
+	{
+		if(!strcmp(argv[i], "-record")) inputLog.startRecording(argv[i + 1]);
+		if(!strcmp(argv[i], "-replay")) inputLog.startReplay(argv[i + 1]);
+		if(!strcmp(argv[i], "-fps")) targetFps = (float)atof(argv[i + 1]);
+	}
+
+	// pace by the timer with the vsync off, or by the vsync alone
+	if(targetFps > 0) setSwapInterval(0);
+	else if(setSwapInterval(1)) printf("frame pacing: vsync\n");
+	else
+	{
+		targetFps = 60;
+		printf("frame pacing: no vsync control, %g frames per second\n", targetFps);
+	}
+
 	// set up the callback functions
     glutDisplayFunc(display);   // what to do when it's time to draw
     glutKeyboardFunc(keyboard); // what to do if a keyboard event is detected
 	glutSpecialFunc(special);   // what to do if a special key event is detected
+	glutSpecialUpFunc(specialUp); // what to do if a special key is released
+	glutIgnoreKeyRepeat(1);     // keys are held, not repeated
+	glutIdleFunc(idle);         // what to do between the events
 	glutMouseFunc(mouse);       // what to do if a mouse click event is detected
 	glutMotionFunc(motion);     // what to do if a mouse drag event is detected
 	glutWMCloseFunc(close);     // what to do at the end
@@ -148,14 +225,35 @@ int main(int argc, char **argv)
     return 0;
 }
 
-// setting of the buffer data
-void setBuffers(Object* object, GLMmodel* model)
+// setting of the buffer data, true if the vertex arrays did not fit the arena and are on the heap
+bool setBuffers(Object* object, GLMmodel* model)
 {
-	// allocate memory for buffers
+	// allocate memory for buffers in the arena
 	object->nVertices = 3 * model->numtriangles;
-	object->vertices = (vec3*)malloc(sizeof(*object->vertices) * object->nVertices);
-	object->normals = (vec3*)malloc(sizeof(*object->normals) * object->nVertices);
-	object->texcoords = (vec2*)malloc(sizeof(*object->texcoords) * object->nVertices);
+	object->vertices = frameArena.allocateArray<vec3>(object->nVertices);
+	object->normals = frameArena.allocateArray<vec3>(object->nVertices);
+	object->texcoords = frameArena.allocateArray<vec2>(object->nVertices);
+	bool heap = !object->vertices || !object->normals || !object->texcoords;
+	if(heap)
+	{
+		object->vertices = (vec3*)malloc(sizeof(*object->vertices) * object->nVertices);
+		object->normals = (vec3*)malloc(sizeof(*object->normals) * object->nVertices);
+		object->texcoords = (vec2*)malloc(sizeof(*object->texcoords) * object->nVertices);
+	}
+
+	// the positions also as separate arrays for the bounds, on the heap if the arena is full
+	ArenaMark mark(frameArena);
+	vec3SoA positions;
+	positions.x = frameArena.allocateArray<GLfloat>(object->nVertices);
+	positions.y = frameArena.allocateArray<GLfloat>(object->nVertices);
+	positions.z = frameArena.allocateArray<GLfloat>(object->nVertices);
+	bool positionsHeap = !positions.x || !positions.y || !positions.z;
+	if(positionsHeap)
+	{
+		positions.x = (GLfloat*)malloc(sizeof(GLfloat) * object->nVertices);
+		positions.y = (GLfloat*)malloc(sizeof(GLfloat) * object->nVertices);
+		positions.z = (GLfloat*)malloc(sizeof(GLfloat) * object->nVertices);
+	}
 
 	// copy vertices to buffers
 	for(int i = 0; i < (int)model->numtriangles; i++) 
@@ -170,6 +268,9 @@ void setBuffers(Object* object, GLMmodel* model)
 			y = model->vertices[3*T.vindices[j] + 1];
 			z = model->vertices[3*T.vindices[j] + 2];
 			object->vertices[3*i+j] = vec3(x, y, z);
+			positions.x[3*i+j] = x;
+			positions.y[3*i+j] = y;
+			positions.z[3*i+j] = z;
 
 			// vertex normal
 			x = model->normals[3*T.nindices[j] + 0];
@@ -184,8 +285,19 @@ void setBuffers(Object* object, GLMmodel* model)
 		}
 	}
 
+	// bounding box of the positions
+	object->boundsMin = vec3(1e30f);
+	object->boundsMax = vec3(-1e30f);
+	pointBounds(positions, object->nVertices, object->boundsMin, object->boundsMax);
+	if(positionsHeap)
+	{
+		free(positions.x);
+		free(positions.y);
+		free(positions.z);
+	}
+
 	// create the buffer
-	glGenBuffers(1, &object->buffer);
+	object->buffer = device->createBuffer();
 
 	// sizes of vertex/normal/texcoord buffers
 	int vsize = sizeof(*object->vertices) * object->nVertices;
@@ -193,98 +305,80 @@ void setBuffers(Object* object, GLMmodel* model)
 	int tsize = sizeof(*object->texcoords) * object->nVertices;
 
 	// move the vertex data to the buffer
-	glBindBuffer(GL_ARRAY_BUFFER, object->buffer);
-	glBufferData(GL_ARRAY_BUFFER, vsize + nsize + tsize, NULL, GL_STATIC_DRAW);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, vsize, object->vertices);
-	glBufferSubData(GL_ARRAY_BUFFER, vsize, nsize, object->normals);
-	glBufferSubData(GL_ARRAY_BUFFER, vsize + nsize, tsize, object->texcoords);
+	device->bindBuffer(GL_ARRAY_BUFFER, object->buffer);
+	device->bufferData(GL_ARRAY_BUFFER, vsize + nsize + tsize, NULL, GL_STATIC_DRAW);
+	device->bufferSubData(GL_ARRAY_BUFFER, 0, vsize, object->vertices);
+	device->bufferSubData(GL_ARRAY_BUFFER, vsize, nsize, object->normals);
+	device->bufferSubData(GL_ARRAY_BUFFER, vsize + nsize, tsize, object->texcoords);
+	renderMemory.bufferBytes += vsize + nsize + tsize;
+	return heap;
 }
 
 // setting of the vertex attributes
 void setAttributes(Object* object)
 {
-	glBindBuffer(GL_ARRAY_BUFFER, object->buffer);
-
-	// sizes of vertex/normal buffers
-	int vsize = sizeof(*object->vertices) * object->nVertices;
-	int nsize = sizeof(*object->normals) * object->nVertices;
-
-	// link the position attribute data
-	GLuint vPosition_loc = glGetAttribLocation(program, "vPosition");
-	glEnableVertexAttribArray(vPosition_loc);
-	glVertexAttribPointer(vPosition_loc, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
-
-	// link the normal attribute data
-	GLuint vNormal_loc = glGetAttribLocation(program, "vNormal");
-	glEnableVertexAttribArray(vNormal_loc);
-	glVertexAttribPointer(vNormal_loc, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(vsize));
-
-	// link the texture coordinate attribute data
-	GLuint vTexture_loc = glGetAttribLocation(program, "vTexture");
-	glEnableVertexAttribArray(vTexture_loc);
-	glVertexAttribPointer(vTexture_loc, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(vsize + nsize));
+	setObjectAttributes(device, objectLocations, object);
 }
 
-// setting of the object lighting
-void setLighting(Object* object)
+// setting of the lights
+void setLights(Light& light0, Light& light1)
 {
 	// set up the general light
-	Light light0;
 	light0.ambient = vec4(0.5f, 0.5f, 0.5f, 1);  // ambient color
 	light0.diffuse = vec4(0.5f, 0.5f, 0.5f, 1);  // diffuse color
 	light0.specular = vec4(0.5f, 0.5f, 0.5f, 1); // specular color
 	light0.position = vec4(0, 1, 0, 0);          // light position in world coordinates
 
 	// set up the spot light
-	Light light1;
 	light1.ambient = vec4(0.5f, 0.5f, 0.5f, 1);  // ambient color
 	light1.diffuse = vec4(0.5f, 0.5f, 0.5f, 1);  // diffuse color
 	light1.specular = vec4(0.5f, 0.5f, 0.5f, 1); // specular color
 	light1.position = vec4(spotPosition.x, spotPosition.y, spotPosition.z, 1); // spot position in world coordinates
+}
+
+// setting of the object lighting
+void setLighting(Object* object)
+{
+	PROFILE_ZONE("setLighting");
+	Light lights[2];
+	setLights(lights[0], lights[1]);
 
-	// shininess
-	GLuint shininess_loc = glGetUniformLocation(program, "shininess");
-	glUniform1f(shininess_loc, object->material.shininess);
-
-	// lighting variables for the light0
-	GLuint AP_loc = glGetUniformLocation(program, "AmbientProd[0]");
-	GLuint DP_loc = glGetUniformLocation(program, "DiffuseProd[0]");
-	GLuint SP_loc = glGetUniformLocation(program, "SpecularProd[0]");
-	GLuint LP_loc = glGetUniformLocation(program, "LightPosition[0]");
-	glUniform4fv(AP_loc, 1, light0.ambient * object->material.ambient);
-	glUniform4fv(DP_loc, 1, light0.diffuse * object->material.diffuse);
-	glUniform4fv(SP_loc, 1, light0.specular * object->material.specular);
-	glUniform4fv(LP_loc, 1, light0.position);
-
-	// lighting variables for the light1
-	AP_loc = glGetUniformLocation(program, "AmbientProd[1]");
-	DP_loc = glGetUniformLocation(program, "DiffuseProd[1]");
-	SP_loc = glGetUniformLocation(program, "SpecularProd[1]");
-	LP_loc = glGetUniformLocation(program, "LightPosition[1]");
-	GLuint SD_loc = glGetUniformLocation(program, "spotDirection");
 	float flash = flashlightEnabled && !explorationMode ? 1.0f : 0.0f;
-	glUniform4fv(AP_loc, 1, light1.ambient * object->material.ambient * flash);
-	glUniform4fv(DP_loc, 1, light1.diffuse * object->material.diffuse * flash);
-	glUniform4fv(SP_loc, 1, light1.specular * object->material.specular * flash);
-	glUniform4fv(LP_loc, 1, light1.position);
-	glUniform3fv(SD_loc, 1, viewDirection);
+	setObjectLighting(device, objectLocations, object->material, lights, flash, viewDirection);
 }
 
-// object loading
-void loadObject(Object* object, char* filename)
+// object loading, the mesh itself hides other objects if it is an occluder
+void loadObject(Object* object, char* filename, bool occluder = false)
 {
+	PROFILE_ZONE("loadObject");
+	ALLOC_SCOPE("loader");
+	ALLOC_ASSET(filename);
+
 	// load the model and compute the normals
 	GLMmodel* model = glmReadOBJ(filename);
 	glmFacetNormals(model);
 	glmVertexNormals(model, object == person ? 90.0f : 0.0f); // smooth normals for the person only
 
-	// create the vertex buffers
-	setBuffers(object, model);
+	// create the vertex buffers and copy the mesh to the shared buffers
+	ArenaMark mark(frameArena);
+	bool heap = setBuffers(object, model);
+	object->mesh = indirect.addMesh(object->vertices, object->normals, object->texcoords, object->nVertices);
+	if(soft) soft->addMesh(object->vertices, object->normals, object->texcoords, object->nVertices); // at the same mesh ID
+
+	// keep the triangles for the occlusion culling
+	if(occluder)
+	{
+		object->occluder = new OccluderMesh;
+		object->occluder->addTriangles(object->vertices, object->nVertices);
+	}
 
 	// data in system memory is no longer needed
-	free(object->vertices);
-	free(object->normals);
-	free(object->texcoords);
+	if(heap)
+	{
+		free(object->vertices);
+		free(object->normals);
+		free(object->texcoords);
+	}
 	glmDelete(model);
 
 	// set the object material
@@ -294,249 +388,717 @@ void loadObject(Object* object, char* filename)
 	object->material.shininess = 100;
 }
 
+// insert the object into the bounding volume hierarchy or move it there
+void placeBounds(Object* object, const AABB& box)
+{
+	if(object->proxy < 0) object->proxy = sceneTree.insert(box, object);
+		else sceneTree.move(object->proxy, box);
+}
+
+// bounding volume hierarchy update of the objects moved in the last transform update
+void updateBounds()
+{
+	int count = (int)sceneGraph.updated.size();
+	if(count == 0) return;
+
+	// the local bounds and the world transforms as separate arrays, one object at a time if the arena is full
+	ArenaMark mark(frameArena);
+	int* moved = frameArena.allocateArray<int>(count);
+	GLfloat* arrays = frameArena.allocateArray<GLfloat>(18 * count);
+	if(!moved || !arrays)
+	{
+		for(int i = 0; i < count; i++)
+		{
+			int index = sceneGraph.updated[i];
+			Object* object = sceneGraph.objects[index];
+			if(object->nVertices > 0) placeBounds(object, transformBounds(object->boundsMin, object->boundsMax, sceneGraph.worldTransforms[index]));
+		}
+		return;
+	}
+	vec3SoA boundsMin = { arrays, arrays + count, arrays + 2 * count };
+	vec3SoA boundsMax = { arrays + 3 * count, arrays + 4 * count, arrays + 5 * count };
+	GLfloat* rows[12];
+	for(int k = 0; k < 12; k++) rows[k] = arrays + (6 + k) * count;
+
+	// objects without geometry are not in the hierarchy
+	int n = 0;
+	for(int i = 0; i < count; i++)
+	{
+		int index = sceneGraph.updated[i];
+		Object* object = sceneGraph.objects[index];
+		if(object->nVertices == 0) continue;
+
+		const Transform& transform = sceneGraph.worldTransforms[index];
+		boundsMin.x[n] = object->boundsMin.x; boundsMin.y[n] = object->boundsMin.y; boundsMin.z[n] = object->boundsMin.z;
+		boundsMax.x[n] = object->boundsMax.x; boundsMax.y[n] = object->boundsMax.y; boundsMax.z[n] = object->boundsMax.z;
+		for(int k = 0; k < 12; k++) rows[k][n] = transform[k / 4][k % 4];
+		moved[n++] = index;
+	}
+
+	// the world bounds of all of them at once, in place of the local ones
+	transformBoxes(rows, boundsMin, boundsMax, boundsMin, boundsMax, n);
+	for(int i = 0; i < n; i++)
+	{
+		AABB box;
+		box.min = vec3(boundsMin.x[i], boundsMin.y[i], boundsMin.z[i]);
+		box.max = vec3(boundsMax.x[i], boundsMax.y[i], boundsMax.z[i]);
+		placeBounds(sceneGraph.objects[moved[i]], box);
+	}
+}
+
 // program initialization
 void init()
 {
+	PROFILE_ZONE("init");
+	ALLOC_SCOPE("init");
+	frameArena.create(frameArenaSize);
+
 	// create the ground object and add it to the scene graph
 	ground = new Object;
 	loadObject(ground, "data/ground.obj");
 	ground->texture = 0;
-	sceneGraph.root->addChild(ground);
+	sceneGraph.addObject(sceneGraph.root, ground);
 
 	// create the building object and add it to the scene graph
 	Object* building = new Object;
 	loadObject(building, "data/building.obj");
 	building->texture = 1;
-	ground->addChild(building);
+	building->occluder = new OccluderMesh;
+	building->occluder->addBox(vec3(-3.8f, 0, -4.7f), vec3(3.8f, 3.5f, 4.7f)); // solid lower part of the walls
+	sceneGraph.addObject(ground, building);
 
 	// create the person object and add it to the scene graph
 	person = new Object;
 	loadObject(person, "data/person.obj");
 	person->texture = 2;
-	sceneGraph.root->addChild(person);
+	sceneGraph.addObject(sceneGraph.root, person);
 
 	// create the flashlight object and add it to the scene graph
 	flashlight = new Object;
 	loadObject(flashlight, "data/flashlight.obj");
 	flashlight->texture = 3;
-	flashlight->matrix = Translate(-0.27f, 0.76f, 0) * RotateY(-90);
-	person->addChild(flashlight);
+	flashlight->setTransform(flashlightTransform);
+	sceneGraph.addObject(person, flashlight);
 
 	// create the room object and add it to the scene graph
 	room = new Object;
-	loadObject(room, "data/room.obj");
+	loadObject(room, "data/room.obj", true);
 	room->texture = 4;
-	sceneGraph.root->addChild(room);
+	sceneGraph.addObject(sceneGraph.root, room);
 
 	// create the barrel object and add it to the scene graph
-	Object* barrel = new Object;
+	barrel = new Object;
 	loadObject(barrel, "data/barrel.obj");
 	barrel->texture = 5;
-	room->addChild(barrel);
+	sceneGraph.addObject(room, barrel);
 
 	// create the chest object and add it to the scene graph
 	chest = new Object;
 	loadObject(chest, "data/chest.obj");
 	chest->texture = 6;
-	chest->matrix = Translate(chestPosition);
-	chest->visible = false;
-	sceneGraph.root->addChild(chest);
+	chest->setMatrix(Translate(chestPosition));
+	sceneGraph.addObject(sceneGraph.root, chest);
+
+	// the outdoor cell with the ground and the building
+	outdoorCell = cells.addCell("outdoor", vec3(-32, -1, -32), vec3(32, 20, 32));
+	outdoorCell->addObject(ground);
+
+	// the room cell with the barrel and the chest
+	roomCell = cells.addCell("room", vec3(-8, -1, -8), vec3(8, 10, 8));
+	roomCell->addObject(room);
+	roomCell->addObject(chest);
+
+	// the room is larger than the building, so the portals crossed around it are closed for the visibility
+	cells.addBoxPortals(outdoorCell, roomCell, vec3(-5, -1, -5), vec3(5, 10, 5), true, false); // go in near the building
+	cells.addBoxPortals(roomCell, outdoorCell, vec3(-7, -1, -7), vec3(7, 10, 7), false, false); // go out near the wall
+
+	// the room is seen from outside through the building door only, clipped to it
+	vec3 door[4] = {vec3(0.5f, 1.0f, -3.3f), vec3(-0.5f, 1.0f, -3.3f), vec3(-0.5f, 3.5f, -3.3f), vec3(0.5f, 3.5f, -3.3f)};
+	cells.addPortal(outdoorCell, roomCell, door, 4, true);
+	cells.moveCamera(viewPoint, viewPoint);
+
+	// the simulation starts at rest
+	previousViewPoint = viewPoint;
+	previousYawAngle = yawAngle;
+	reportTime = currentTime();
+
+	// create the occlusion culler
+	occlusion = new OcclusionCuller;
+
+	// put all objects into the bounding volume hierarchy
+	sceneGraph.updateTransforms();
+	updateBounds();
 
 	// load the textures
 	for(int i = 0; i < nTextures; i++)
 	{
+		ALLOC_SCOPE("textures");
+		ALLOC_ASSET(filenames[i]);
+
 		// create the texture ID
-		glGenTextures(1, &textures[i]);
-		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		textures[i] = device->createTexture();
+		device->bindTexture(GL_TEXTURE_2D, textures[i]);
 
 		// set the texture parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
-		glHint(GL_GENERATE_MIPMAP_HINT, GL_NICEST);
+		device->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		device->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		device->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		device->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		device->texParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+		device->hint(GL_GENERATE_MIPMAP_HINT, GL_NICEST);
 
 		// load the texture
 		int width, height;
 		GLubyte *data = glmReadPPM((char*)filenames[i], &width, &height);
-		glTexImage2D(GL_TEXTURE_2D, 0, 3, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data); // move the data onto the GPU
+		device->texImage2D(GL_TEXTURE_2D, 3, width, height, GL_RGB, GL_UNSIGNED_BYTE, data); // move the data onto the GPU
+		indirect.addTexture(i, data, width, height); // and into the texture array
+		if(soft) soft->addTexture(i, data, width, height);
+		renderMemory.textureBytes += width * height * 3 * 4 / 3; // with the mipmaps
 		free(data);  // don't need this data now that its on the GPU
 	}
 
 	// enable the texturing
-	glActiveTexture(GL_TEXTURE0);
-	glEnable(GL_TEXTURE_2D);
-	glUniform1i(glGetUniformLocation(program, "texture"), 0); // use texture unit #0 for the shader variable "texture"
+	device->activeTexture(GL_TEXTURE0);
+	device->enable(GL_TEXTURE_2D);
+	device->uniform1i(device->getUniformLocation(program, "texture"), 0); // use texture unit #0 for the shader variable "texture"
 
 	// load the shader
-	program = InitShader("vshaderLighting_v120.glsl", "fshaderLighting_v120.glsl");
-	glUseProgram(program);
-
-	glEnable(GL_DEPTH_TEST); // enable the Z-buffer depth test
-	glEnable(GL_CULL_FACE);  // enable culling of back-facing surfaces
+	program = device->createProgram("vshaderLighting_v120.glsl", "fshaderLighting_v120.glsl");
+	getObjectLocations(device, program, objectLocations);
+
+	// use the multi-draw indirect path if the context supports it
+	if(frameRing.create(4 << 20)) renderMemory.bufferBytes += 3 * (4 << 20);
+	indirectEnabled = indirect.create(&frameRing);
+	gpuTimer.create();
+	hud.create();
+	device->invalidate(); // the indirect path and the overlay set up their objects directly
+	device->useProgram(program);
+
+	device->enable(GL_DEPTH_TEST); // enable the Z-buffer depth test
+	device->enable(GL_CULL_FACE);  // enable culling of back-facing surfaces
 }
 
 // scene graph drawing
-void drawObjects(Object* object, mat4 matrix, bool visible)
+// screen rectangle of every object, the one its cell was seen through narrowed by the parents
+void updateClipRects()
 {
-	// traverse the scene graph
-	while(object)
+	clipRects.assign(sceneGraph.objects.size(), PortalRect());
+	for(int i = 0; i < (int)cells.visibleCells.size(); i++)
 	{
-		// update the flashlight position for lighting
-		if(object == flashlight)
+		Cell* cell = cells.visibleCells[i];
+		for(int j = 0; j < (int)cell->objects.size(); j++)
 		{
-			spotPosition = matrix * object->matrix * vec4(0.3f, 0, 0, 1);
+			clipRects[cell->objects[j]->index] = cell->rect;
 		}
+	}
+	for(int i = 0; i < (int)sceneGraph.objects.size(); i++)
+	{
+		int parent = sceneGraph.parents[i];
+		if(parent >= 0) clipRects[i].narrow(clipRects[parent]);
+	}
+}
+
+// scissor the next draws to the rectangle rounded outwards to pixels, no test for the whole screen
+void setScissor(const PortalRect& rect, PortalRect& current)
+{
+	if(rect.xmin == current.xmin && rect.ymin == current.ymin && rect.xmax == current.xmax && rect.ymax == current.ymax) return;
+
+	if(rect.full()) device->disable(GL_SCISSOR_TEST);
+	else
+	{
+		GLint x0 = (GLint)floorf((rect.xmin + 1) * 0.5f * windowWidth);
+		GLint y0 = (GLint)floorf((rect.ymin + 1) * 0.5f * windowHeight);
+		GLint x1 = (GLint)ceilf((rect.xmax + 1) * 0.5f * windowWidth);
+		GLint y1 = (GLint)ceilf((rect.ymax + 1) * 0.5f * windowHeight);
+		if(current.full()) device->enable(GL_SCISSOR_TEST);
+		device->scissor(x0, y0, x1 - x0, y1 - y0);
+	}
+	current = rect;
+}
 
-		// only if parent and current objects are visible
-		if(visible && object->visible)
+// per-object drawing of the object at the traversal position
+void drawSceneObject(int i, PortalRect& scissorRect)
+{
+	Object* object = sceneGraph.objects[i];
+	setScissor(clipRects[i], scissorRect);
+	setAttributes(object);
+	setLighting(object);
+	bool textured = object->texture >= 0 && object->texture < nTextures;
+	drawObject(device, objectLocations, object, textured ? textures[object->texture] : 0, viewMatrix * sceneGraph.worldTransforms[i]);
+}
+
+void drawObjects()
+{
+	PROFILE_ZONE("drawObjects");
+	PERF_PHASE("drawObjects", 0);
+	if(indirectEnabled) indirect.begin(frameArena, (int)sceneGraph.objects.size());
+	portalObjects.clear();
+	PortalRect scissorRect; // rectangle of the scissor test, the whole screen while off
+
+	// objects in traversal order with their world transforms
+	for(int i = 0; i < (int)sceneGraph.objects.size(); i++)
+	{
+		Object* object = sceneGraph.objects[i];
+		const Transform& worldTransform = sceneGraph.worldTransforms[i];
+
+		// only if parent and current objects are visible and the object is not hidden by occluders
+		if(sceneGraph.worldVisible[i] && (object->proxy < 0 || object->frustumFrame == frameNumber) && (!occlusionEnabled || object->occluder || occlusion->isVisible(object->boundsMin, object->boundsMax, worldTransform)))
 		{
-			// draw the object
-			setAttributes(object);
-			setLighting(object);
-			GLuint modelViewMatrix_loc = glGetUniformLocation(program, "modelview_matrix");
-			glUniformMatrix4fv(modelViewMatrix_loc, 1, GL_TRUE, viewMatrix * matrix * object->matrix);
-			if(object->texture >= 0 && object->texture < nTextures)
+			PERF_TRIANGLES(object->nVertices / 3);
+			renderCounters.triangles += object->nVertices / 3;
+
+			// collect the object for the software rasterizer
+			if(soft)
 			{
-				glBindTexture(GL_TEXTURE_2D, textures[object->texture]);
+				const PortalRect& rect = clipRects[i];
+				if(object->mesh >= 0) soft->add(object->mesh, object->texture, viewMatrix * worldTransform, object->material, vec4(rect.xmin, rect.ymin, rect.xmax, rect.ymax));
+				continue;
 			}
-			glDrawArrays(GL_TRIANGLES, 0, object->nVertices);
-		}
 
-		// draw object's children recursively
-		drawObjects(object->children, matrix * object->matrix, visible && object->visible);
+			// collect the object for the single draw, those seen through a portal need the scissor test
+			if(indirectEnabled)
+			{
+				if(!clipRects[i].full()) portalObjects.push_back(i);
+				else if(object->mesh >= 0) indirect.add(object->mesh, object->texture, worldTransform, object->material);
+				continue;
+			}
 
-		// move to the next object in scene graph hierarchy
-		object = object->next;
+			// draw the object
+			drawSceneObject(i, scissorRect);
+		}
+		else if(sceneGraph.worldVisible[i]) renderCounters.culledTriangles += object->nVertices / 3;
 	}
-}
-
-// window drawing
-void display(void)
-{
-	float time = glutGet(GLUT_ELAPSED_TIME) * 0.001f; // current time in seconds
 
-	// scene selection
-	if(interiorScene)
+	// draw the collected objects at once
+	if(indirectEnabled)
 	{
-		// if near the wall
-		if(fabs(viewPoint.x) > 7 || fabs(viewPoint.z) > 7)
+		Light lights[2];
+		setLights(lights[0], lights[1]);
+		PROFILE_ZONE("indirect draw");
+		indirect.draw(viewMatrix, projMatrix, lights, viewDirection, flashlightEnabled && !explorationMode ? 1.0f : 0.0f);
+		device->invalidateBindings();
+		device->useProgram(program);
+
+		for(int i = 0; i < (int)portalObjects.size(); i++)
 		{
-			// go out
-			interiorScene = false;
-			if(!chestPicked) chest->visible = false;
+			drawSceneObject(portalObjects[i], scissorRect);
 		}
 	}
-	else
+	setScissor(PortalRect(), scissorRect);
+}
+
+// occluders rasterization
+void rasterizeOccluders()
+{
+	for(int i = 0; i < (int)sceneGraph.objects.size(); i++)
 	{
-		// if near the wall
-		if(fabs(viewPoint.x) < 5 && fabs(viewPoint.z) < 5)
+		Object* object = sceneGraph.objects[i];
+
+		// only if parent and current objects are visible, an object seen through a portal hides nothing outside of it
+		if(sceneGraph.worldVisible[i] && object->occluder && clipRects[i].full())
 		{
-			// go in
-			interiorScene = true;
-			if(!chestPicked) chest->visible = true;
+			occlusion->addOccluder(object->occluder, sceneGraph.worldTransforms[i]);
 		}
 	}
+}
 
-	// object visibility according to current scene
-	ground->visible = !interiorScene;
-	room->visible = interiorScene;
+// window drawing
+void display(void)
+{
+	PROFILE_ZONE("display");
+	ALLOC_SCOPE("frame");
+	ALLOC_FRAME();
+	frameArena.reset();
+	double frameStart = currentTime();
+	renderCounters = RenderCounters();
+
+	// render state interpolated between the last two simulation steps
+	float alpha = (float)timestep.alpha;
+	float time = (float)(timestep.time - timestep.step * (1 - alpha)) * 0.001f; // current time in seconds
+	if(time < 0) time = 0;
+	vec3 point = previousViewPoint * (1 - alpha) + viewPoint * alpha;
+	float yaw = previousYawAngle * (1 - alpha) + yawAngle * alpha;
+
+	// next region of the ring for the per-frame data
+	frameRing.beginFrame();
+	gpuTimer.beginFrame();
+
+	// object visibility according to the viewpoint
 	person->visible = !firstPersonView;
 
 	// update the person matrix and view direction
-	person->matrix = Translate(viewPoint + vec3(0, -1.2f, 0)) * RotateY(yawAngle);
-	viewDirection = vec3(sinf(yawAngle * DegreesToRadians), 0, cosf(yawAngle * DegreesToRadians));
-
-	// pick the chest if near
-	if(!chestPicked && interiorScene)
-	{
-		float dx = chestPosition.x - viewPoint.x;
-		float dz = chestPosition.z - viewPoint.z;
-		if(dx*dx + dz*dz < 1) chestPicked = true;
-	}
+	person->setMatrix(Translate(point + vec3(0, -1.2f, 0)) * RotateY(yaw));
+	viewDirection = vec3(sinf(yaw * DegreesToRadians), 0, cosf(yaw * DegreesToRadians));
 
 	// show the picked chest rotated above the person
 	if(chestPicked)
 	{
-		chest->matrix = Translate(viewPoint + viewDirection * 0.0f + vec3(0, 0.8f, 0)) * RotateY(time * 50.0f);
+		chest->setMatrix(Translate(point + viewDirection * 0.0f + vec3(0, 0.8f, 0)) * RotateY(time * 50.0f));
 	}
 
-	float introDuration = 8;
+	// update the world matrices of the moved objects and their bounds
+	sceneGraph.updateTransforms();
+	updateBounds();
+
+	// update the flashlight position for lighting
+	spotPosition = sceneGraph.worldTransforms[flashlight->index] * vec4(0.3f, 0, 0, 1);
+
 	bool introSequence = time < introDuration;
 
 	// camera mode selection
+	vec3 eye;
 	if(introSequence)
 	{
 		// camera flying down at start
 		vec3 pos0(-10, 15, 15);                    // start camera position
-		vec3 pos1 = viewPoint - viewDirection * 2; // end camera position
+		vec3 pos1 = point - viewDirection * 2;     // end camera position
 		float t = time / introDuration;           // flying progress in the range 0..1
 		t = (3 - 2 * t) * t * t;                   // smoothing
 		vec3 pos = pos0 * (1 - t) + pos1 * t;      // interpolation from pos0 to pos1
-		viewMatrix = LookAt(pos, viewPoint, vec3(0, 1, 0));
+		viewMatrix = LookAt(pos, point, vec3(0, 1, 0));
+		eye = pos;
 	}
 	else if(firstPersonView)
 	{
 		// first person point of view
-		viewMatrix = RotateX(pitchAngle) * LookAt(viewPoint, viewPoint + viewDirection, vec3(0, 1, 0));
+		viewMatrix = RotateX(pitchAngle) * LookAt(point, point + viewDirection, vec3(0, 1, 0));
+		eye = point;
 	}
 	else
 	{
 		// third person point of view
-		viewMatrix = RotateX(pitchAngle) * LookAt(viewPoint - viewDirection * 2, viewPoint, vec3(0, 1, 0));
+		viewMatrix = RotateX(pitchAngle) * LookAt(point - viewDirection * 2, point, vec3(0, 1, 0));
+		eye = point - viewDirection * 2;
+	}
+
+	// show the cells visible from the camera cell through the portals
+	{
+		PROFILE_ZONE("portals");
+		cells.update(eye, projMatrix * viewMatrix);
+	}
+
+	// combine the object visibility along the hierarchy
+	sceneGraph.updateVisibility();
+	updateClipRects();
+
+	// find the objects inside the view frustum
+	{
+		PROFILE_ZONE("frustum");
+		vec4 planes[6];
+		frustumPlanes(projMatrix * viewMatrix, planes);
+		frameNumber++;
+		queryResults.clear();
+		sceneTree.queryFrustum(planes, queryResults);
+		for(int i = 0; i < (int)queryResults.size(); i++)
+		{
+			queryResults[i]->frustumFrame = frameNumber;
+		}
 	}
 
 	// set uniform values in shader
-	GLuint projMatrix_loc = glGetUniformLocation(program, "proj_matrix");
-	GLuint viewMatrix_loc = glGetUniformLocation(program, "view_matrix"); // send this in separately to go from just world-->cam
-	glUniformMatrix4fv(projMatrix_loc, 1, GL_TRUE, projMatrix);
-	glUniformMatrix4fv(viewMatrix_loc, 1, GL_TRUE, viewMatrix);
+	GLuint projMatrix_loc = device->getUniformLocation(program, "proj_matrix");
+	GLuint viewMatrix_loc = device->getUniformLocation(program, "view_matrix"); // send this in separately to go from just world-->cam
+	device->uniformMatrix4fv(projMatrix_loc, 1, GL_TRUE, projMatrix);
+	device->uniformMatrix4fv(viewMatrix_loc, 1, GL_TRUE, viewMatrix);
 
 	// clear the window
-	if(explorationMode) glClearColor(0.50f, 0.45f, 0.40f, 1.0f); // background color
-		else glClearColor(0.3f, 0.2f, 0.2f, 1.0f); // background color
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // clear out the color of the framebuffer and the depth info from the depth buffer
+	if(explorationMode) device->clearColor(0.50f, 0.45f, 0.40f, 1.0f); // background color
+		else device->clearColor(0.3f, 0.2f, 0.2f, 1.0f); // background color
+	gpuTimer.begin("clear");
+    device->clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // clear out the color of the framebuffer and the depth info from the depth buffer
+	gpuTimer.end();
+
+	// start the frame of the software rasterizer with the same background
+	if(soft)
+	{
+		Light lights[2];
+		setLights(lights[0], lights[1]);
+		vec4 background = explorationMode ? vec4(0.50f, 0.45f, 0.40f, 1.0f) : vec4(0.3f, 0.2f, 0.2f, 1.0f);
+		soft->begin(viewMatrix, projMatrix, lights, viewDirection, flashlightEnabled && !explorationMode ? 1.0f : 0.0f, background);
+	}
 
-	if(explorationMode && chest)
+	if(explorationMode && chest && soft)
+	{
+		// the chest for the software rasterizer
+		soft->add(chest->mesh, chest->texture, Translate(0, 0, -1.5f) * explorationMatrix * Translate(0, -0.2f, 0), chest->material);
+	}
+	else if(explorationMode && chest)
 	{
 		// draw the chest
+		gpuTimer.begin("exploration chest");
 		setAttributes(chest);
 		setLighting(chest);
-		GLuint modelViewMatrix_loc = glGetUniformLocation(program, "modelview_matrix");
-		glUniformMatrix4fv(modelViewMatrix_loc, 1, GL_TRUE, Translate(0, 0, -1.5f) * explorationMatrix * Translate(0, -0.2f, 0));
-		if(chest->texture >= 0 && chest->texture < nTextures)
-		{
-			glBindTexture(GL_TEXTURE_2D, textures[chest->texture]);
-		}
-		glDrawArrays(GL_TRIANGLES, 0, chest->nVertices);
+		bool textured = chest->texture >= 0 && chest->texture < nTextures;
+		drawObject(device, objectLocations, chest, textured ? textures[chest->texture] : 0, Translate(0, 0, -1.5f) * explorationMatrix * Translate(0, -0.2f, 0));
+		gpuTimer.end();
+		renderCounters.triangles += chest->nVertices / 3;
 	}
 	else
 	{
+		// rasterize the occluders to test the other objects against them
+		if(occlusionEnabled)
+		{
+			PROFILE_ZONE("occlusion");
+			occlusion->beginFrame(projMatrix * viewMatrix);
+			rasterizeOccluders();
+			occlusion->endOccluders();
+		}
+
 		// draw the scene graph
-		drawObjects(sceneGraph.root, mat4(), true);
+		gpuTimer.begin("opaque scene");
+		drawObjects();
+		gpuTimer.end();
 	}
 
+	// rasterize the collected draws on the CPU
+	if(soft) soft->end();
+
+	// the overlay over the frame, with the CPU time of this frame, the idle time
+	// between the frames left out, and the GPU time read back from an earlier frame
+	double gpuTime = 0;
+	for(int i = 0; i < gpuTimer.getPhaseCount(); i++) gpuTime += gpuTimer.getPhaseTime(i);
+	hud.addFrame(currentTime() - frameStart, gpuTime);
+	if(hud.visible)
+	{
+		PROFILE_ZONE("hud");
+		hud.draw(renderCounters, renderMemory);
+		device->invalidateBindings(); // the overlay leaves the clear color alone
+		device->invalidateEnables();
+		device->useProgram(program);
+	}
+
+	// report the statistics once per second
+	framesDrawn++;
+	double now = currentTime();
+	if(now - reportTime > 1000)
+	{
+		reportRendering(now);
+		if(cells.cameraCell)
+		{
+			Cell* last = cells.visibleCells.back();
+			printf("portals: camera in %s, %d portals tested, %d cells reached, %s seen through %.2f x %.2f of the screen\n",
+				cells.cameraCell->name, cells.portalsTested, (int)cells.visibleCells.size(), last->name,
+				(last->rect.xmax - last->rect.xmin) * 0.5f, (last->rect.ymax - last->rect.ymin) * 0.5f);
+		}
+		if(occlusionEnabled && !explorationMode)
+		{
+			const OcclusionStats& stats = occlusion->stats;
+			printf("occlusion: %d triangles rasterized in %.3f ms, %d of %d objects culled in %.3f ms\n",
+				stats.occluderTriangles, stats.rasterTime, stats.culled, stats.tested, stats.testTime);
+		}
+		if(indirectEnabled && frameRing.isAvailable())
+		{
+			const RingStats& stats = frameRing.stats;
+			printf("ring buffer: %d bytes in %d allocations, %d overflows, %d fence waits in %.3f ms\n",
+				stats.bytesWritten, stats.allocations, stats.overflows, stats.fenceWaits, stats.waitTime);
+		}
+		if(glDevice.stats.calls > 0)
+		{
+			const StateCacheStats& stats = glDevice.stats;
+			printf("state cache: %d of %d calls filtered, %d buffers, %d attributes, %d textures, %d programs, %d enables, %d clear colors%s\n",
+				stats.filtered, stats.calls, stats.buffers, stats.attributes, stats.textures, stats.programs, stats.enables, stats.clears,
+				glDevice.caching ? "" : " (not caching)");
+			if(glDevice.validating) printf("state cache: %d mismatches\n", stats.mismatches);
+			glDevice.resetStats();
+		}
+		if(gpuTimer.isAvailable())
+		{
+			printf("gpu:");
+			for(int i = 0; i < gpuTimer.getPhaseCount(); i++)
+			{
+				printf(" %s %.3f ms,", gpuTimer.getPhaseName(i), gpuTimer.getPhaseTime(i));
+			}
+			printf(" %d frames not ready\n", gpuTimer.dropped);
+			gpuTimer.dropped = 0;
+		}
+	}
+
+	// keep the ring region of this frame until the GPU has read it
+	frameRing.endFrame();
+
 	// update the window
-	glFlush();
-	glutSwapBuffers();
-	glutPostRedisplay();
+	{
+		PROFILE_ZONE("swap");
+		glFlush();
+		if(!headless) glutSwapBuffers();
+	}
+}
+
+// frame pacing, the simulation runs between the frames
+void idle()
+{
+	// wait for the next frame without burning the CPU
+	if(targetFps > 0)
+	{
+		double frameTime = 1000 / targetFps;
+		sleepUntil(nextFrameTime);
+		double now = currentTime();
+		nextFrameTime += frameTime;
+		if(nextFrameTime < now) nextFrameTime = now + frameTime; // skip the missed frames
+	}
+
+	// run the game logic up to the present
+	int steps = timestep.advance(currentTime());
+	for(int i = 0; i < steps; i++)
+	{
+		step();
+	}
+
+	// hand the input back to the user at the end of a replay
+	if(inputLog.isFinished(simulationTick))
+	{
+		printf("replay finished at tick %u\n", simulationTick);
+		inputLog.stop(simulationTick);
+	}
+
+	// something moves on its own
+	bool moving = viewPoint.x != previousViewPoint.x || viewPoint.z != previousViewPoint.z || yawAngle != previousYawAngle;
+	bool introSequence = timestep.time < introDuration * 1000;
+	bool chestRotating = chestPicked && chest->visible;
+	if(moving || introSequence || chestRotating || inputLog.isReplaying()) frameDirty = true;
+
+	// draw the result if something changed
+	if(frameDirty || !onDemandRendering)
+	{
+		frameDirty = false;
+		glutPostRedisplay();
+	}
+	else
+	{
+		// nothing changes, wait for the events without the idle callback
+		idling = true;
+		idleStart = currentTime();
+		glutIdleFunc(NULL);
+
+		// nothing is drawn to print the report, a timer does it while idling
+		glutTimerFunc((unsigned)std::max(0.0, reportTime + 1000 - idleStart) + 1, reportIdle, ++idlePeriod);
+	}
+}
+
+// print the frames, wakeups and idle share since the last report and start the next one,
+// the idle stretch still going on counts up to now
+void reportRendering(double now)
+{
+	double idle = idleTime;
+	if(idling) idle += now - std::max(idleStart, reportTime);
+	printf("rendering: %d frames, %d wakeups, idle %.0f%% of %.1f s\n",
+		framesDrawn, wakeups, 100 * idle / (now - reportTime), (now - reportTime) * 0.001);
+	framesDrawn = wakeups = 0;
+	idleTime = 0;
+	reportTime = now;
+}
+
+// the report once per second while idling, until the idle stretch it was set for ends
+void reportIdle(int period)
+{
+	if(!idling || period != idlePeriod) return;
+	double now = currentTime();
+	if(now - reportTime > 1000) reportRendering(now);
+	glutTimerFunc((unsigned)std::max(0.0, reportTime + 1000 - now) + 1, reportIdle, period);
+}
+
+// mark the picture changed and wake up from idling
+void invalidate()
+{
+	frameDirty = true;
+	if(idling)
+	{
+		idling = false;
+		wakeups++;
+		double now = currentTime();
+		idleTime += now - std::max(idleStart, reportTime);
+		printf("rendering: woke up after %.1f s idle\n", (now - idleStart) * 0.001);
+		glutIdleFunc(idle);
+
+		// the idle gap is not simulated, the first steps would make everything jump
+		timestep.resync(now);
+	}
+}
+
+// one simulation step with the input replayed for it
+void step()
+{
+	inputLog.replay(simulationTick, dispatchInput);
+	update((float)timestep.step * 0.001f);
+	simulationTick++;
+}
+
+// game logic of one simulation step
+void update(float dt)
+{
+	PROFILE_ZONE("update");
+
+	// keep the state of the previous step for interpolation
+	previousViewPoint = viewPoint;
+	previousYawAngle = yawAngle;
+
+	if(!explorationMode)
+	{
+		// rotate left/right
+		if(turnLeft) yawAngle += turnSpeed * dt;
+		if(turnRight) yawAngle -= turnSpeed * dt;
+
+		// travel forward/backward
+		vec3 direction(sinf(yawAngle * DegreesToRadians), 0, cosf(yawAngle * DegreesToRadians));
+		if(moveForward) viewPoint += direction * moveSpeed * dt;
+		if(moveBackward) viewPoint -= direction * moveSpeed * dt;
+	}
+
+	// restore the viewpoint if too close to the barrel, the hierarchy finds the
+	// candidates near the viewpoint and the distance to the barrel axis decides
+	queryResults.clear();
+	sceneTree.querySphere(vec3(viewPoint.x, 0.5f, viewPoint.z), 1.0f, queryResults);
+	for(int i = 0; i < (int)queryResults.size(); i++)
+	{
+		if(queryResults[i] == barrel && viewPoint.x * viewPoint.x + viewPoint.z * viewPoint.z < 1) viewPoint = previousViewPoint;
+	}
+
+	// go to another cell if a portal was crossed
+	cells.moveCamera(previousViewPoint, viewPoint);
+
+	// pick the chest if near
+	if(!chestPicked && cells.cameraCell == roomCell)
+	{
+		queryResults.clear();
+		sceneTree.querySphere(vec3(viewPoint.x, 0, viewPoint.z), 1.0f, queryResults);
+		for(int i = 0; i < (int)queryResults.size(); i++)
+		{
+			float dx = chestPosition.x - viewPoint.x;
+			float dz = chestPosition.z - viewPoint.z;
+			if(queryResults[i] == chest && dx * dx + dz * dz < 1)
+			{
+				// the chest goes with the person from now on
+				chestPicked = true;
+				roomCell->removeObject(chest);
+			}
+		}
+	}
 }
 
 // window resizing
 void resize(int w, int h)
 {
-	glViewport(0, 0, (GLsizei)w, (GLsizei)h);
+	windowWidth = w;
+	windowHeight = h;
+	device->viewport(0, 0, (GLsizei)w, (GLsizei)h);
 	projMatrix = Perspective(60.0, GLfloat(w)/h, 0.1f, 100.0f);  // do perspective projection
+	hud.resize(w, h);
+	if(soft) soft->resize(w, h);
+	invalidate();
 }
 
 // key handling
 void keyboard(unsigned char key, int x, int y)
 {
+	// record the input, ignore the user during a replay
+	if(!inputLog.accept(simulationTick, inputKeyboard, key, 0, x, y)) return;
+
 	switch(key)
 	{
 	case 'q': case 'Q':
-		// quit the program
+		// quit the program, the quit that ended a recording is not replayed
+		if(inputLog.isReplaying()) break;
+		close();
 		exit(EXIT_SUCCESS);
 		break;
 	case 033:
@@ -559,59 +1121,98 @@ void keyboard(unsigned char key, int x, int y)
 		// toggle the flashlight
 		if(!explorationMode) flashlightEnabled = !flashlightEnabled;
 		break;
+	case 'O': case 'o':
+		// toggle the occlusion culling
+		occlusionEnabled = !occlusionEnabled;
+		break;
+	case 'M': case 'm':
+		// toggle the multi-draw indirect submission if supported
+		indirectEnabled = !indirectEnabled && indirect.isAvailable();
+		break;
+	case 'R': case 'r':
+		// toggle the on-demand rendering
+		onDemandRendering = !onDemandRendering;
+		break;
+	case 'H': case 'h':
+		// toggle the performance overlay
+		hud.visible = !hud.visible;
+		break;
 	case 'I': case 'i':
 		if(!explorationMode && chestPicked) chest->visible = !chest->visible;
 		break;
 	}
 
 	// refresh the window
-	glutPostRedisplay();
+	invalidate();
 }
 
-// special key handling
+// special key handling, the simulation steps move while the key is held
 void special(int key, int x, int y)
 {
-	// store the viewpoint
-	vec3 viewPoint0 = viewPoint;
+	// record the input, ignore the user during a replay
+	if(!inputLog.accept(simulationTick, inputSpecial, key, 0, x, y)) return;
 
 	switch(key)
 	{
 	case GLUT_KEY_UP:
 		// travel forward/backward
-		if(!explorationMode) viewPoint += viewDirection * 0.1f;
+		moveForward = true;
 		break;
 	case GLUT_KEY_DOWN:
 		// travel forward/backward
-		if(!explorationMode) viewPoint -= viewDirection * 0.1f;
+		moveBackward = true;
 		break;
 	case GLUT_KEY_LEFT:
 		// rotate left/right
-		if(!explorationMode) yawAngle += 3;
+		turnLeft = true;
 		break;
 	case GLUT_KEY_RIGHT:
 		// rotate left/right
-		if(!explorationMode) yawAngle -= 3;
+		turnRight = true;
 		break;
 	}
 
-	// restore the viewpoint if too close to the barrel
-	if(viewPoint.x*viewPoint.x + viewPoint.z*viewPoint.z < 1)
+	// refresh the window
+	invalidate();
+}
+
+// special key release handling
+void specialUp(int key, int x, int y)
+{
+	// record the input, ignore the user during a replay
+	if(!inputLog.accept(simulationTick, inputSpecialUp, key, 0, x, y)) return;
+
+	switch(key)
 	{
-		viewPoint = viewPoint0;
+	case GLUT_KEY_UP:
+		moveForward = false;
+		break;
+	case GLUT_KEY_DOWN:
+		moveBackward = false;
+		break;
+	case GLUT_KEY_LEFT:
+		turnLeft = false;
+		break;
+	case GLUT_KEY_RIGHT:
+		turnRight = false;
+		break;
 	}
 
 	// refresh the window
-	glutPostRedisplay();
+	invalidate();
 }
 
 // mouse click handling
 void mouse(int button, int state, int x, int y)
 {
+	// record the input, ignore the user during a replay
+	if(!inputLog.accept(simulationTick, inputMouse, button, state, x, y)) return;
+
 	// if left mouse button is clicked
 	if(button == GLUT_LEFT_BUTTON && state == GLUT_DOWN)
 	{
 		// if inside the building or alredy picked the chest
-		if(!explorationMode && (interiorScene || chestPicked))
+		if(!explorationMode && (cells.cameraCell == roomCell || chestPicked))
 		{
 			// start the exploration
 			explorationMode = true;
@@ -630,12 +1231,15 @@ void mouse(int button, int state, int x, int y)
 	}
 
 	// refresh the window
-	glutPostRedisplay();
+	invalidate();
 }
 
 // mouse drag handling
 void motion(int x, int y)
 {
+	// record the input, ignore the user during a replay
+	if(!inputLog.accept(simulationTick, inputMotion, 0, 0, x, y)) return;
+
 	if(explorationMode)
 	{
 		// mouse displacement at dragging
@@ -652,10 +1256,299 @@ void motion(int x, int y)
 	mouseY = y;
 
 	// refresh the window
-	glutPostRedisplay();
+	invalidate();
+}
+
+// CPU submission time of the per-object draws and the multi-draw indirect draw
+void benchmarkSubmission()
+{
+	Light lights[2];
+	setLights(lights[0], lights[1]);
+	sceneGraph.updateTransforms();
+
+	// objects with geometry to draw over and over
+	std::vector<Object*> objects;
+	for(int i = 0; i < (int)sceneGraph.objects.size(); i++)
+	{
+		if(sceneGraph.objects[i]->nVertices > 0) objects.push_back(sceneGraph.objects[i]);
+	}
+
+	// the ring regions must hold the largest run, or it would time the glBufferData fallback
+	if(frameRing.isAvailable() && indirect.isAvailable())
+	{
+		frameRing.destroy();
+		frameRing.create(indirect.frameBytes(maxSubmitObjects));
+	}
+
+	for(int n = 100; n <= maxSubmitObjects; n *= 10)
+	{
+		// one draw call per object
+		device->useProgram(program);
+		glFinish();
+		double start = currentTime();
+		for(int i = 0; i < n; i++)
+		{
+			Object* object = objects[i % objects.size()];
+			setAttributes(object);
+			setLighting(object);
+			drawObject(device, objectLocations, object, textures[object->texture], viewMatrix * sceneGraph.worldTransforms[object->index]);
+		}
+		double objectTime = currentTime() - start;
+		glFinish();
+
+		// all objects in one draw call
+		double indirectTime = 0;
+		if(indirect.isAvailable())
+		{
+			start = currentTime();
+			frameRing.beginFrame();
+			frameArena.reset();
+			indirect.begin(frameArena, n);
+			for(int i = 0; i < n; i++)
+			{
+				Object* object = objects[i % objects.size()];
+				indirect.add(object->mesh, object->texture, sceneGraph.worldTransforms[object->index], object->material);
+			}
+			indirect.draw(viewMatrix, projMatrix, lights, viewDirection, 1);
+			device->invalidateBindings();
+			frameRing.endFrame();
+			indirectTime = currentTime() - start;
+			glFinish();
+		}
+
+		printf("%6d objects: per-object submit %9.3f ms, multi-draw indirect submit %9.3f ms%s%s\n",
+			n, objectTime, indirectTime, indirect.isAvailable() ? "" : " (not supported)",
+			frameRing.stats.overflows > 0 ? " (ring overflow, glBufferData)" : "");
+	}
+}
+
+// feed a replayed event to its handler
+void dispatchInput(const InputEvent& event)
+{
+	switch(event.type)
+	{
+	case inputKeyboard:
+		keyboard((unsigned char)event.key, event.x, event.y);
+		break;
+	case inputSpecial:
+		special(event.key, event.x, event.y);
+		break;
+	case inputSpecialUp:
+		specialUp(event.key, event.x, event.y);
+		break;
+	case inputMouse:
+		mouse(event.key, event.state, event.x, event.y);
+		break;
+	case inputMotion:
+		motion(event.x, event.y);
+		break;
+	}
+}
+
+// hold the arrow keys of the camera path segment at the given time in seconds
+void setPathKeys(float time)
+{
+	moveForward = moveBackward = turnLeft = turnRight = false;
+	for(int i = 0; i < nPathSegments; i++)
+	{
+		if(time < cameraPath[i].duration)
+		{
+			moveForward = cameraPath[i].forward;
+			moveBackward = cameraPath[i].backward;
+			turnLeft = cameraPath[i].left;
+			turnRight = cameraPath[i].right;
+			return;
+		}
+		time -= cameraPath[i].duration;
+	}
+}
+
+// offscreen run along the camera path or a recorded input printing the frame timings,
+// -soft draws the scene with the software rasterizer on the given number of threads,
+// -null records the commands of the scene drawing per object without drawing it, with
+// -expect it fails unless the last frame has the given draws, uniforms and binds,
+// -nocache sends every state call to OpenGL and -validate compares the state cache with OpenGL
+//   dungeon -headless [-size width height] [-frames n] [-dump prefix] [-replay log] [-hud] [-soft [-threads n]] [-null [-expect draws uniforms binds]] [-nocache] [-validate]
+int runHeadless(int argc, char **argv)
+{
+	int width = 800, height = 600, nFrames = 0, nThreads = 0;
+	bool software = false, recording = false;
+	const char* dumpPrefix = NULL; // frames are discarded without it
+	int expected[3] = {-1, -1, -1}; // draws, uniforms and binds of the last frame with the null device, unchecked if -1
+	int recorded[3] = {0, 0, 0};
+	const char* countNames[3] = {"draws", "uniforms", "binds"};
+	for(int i = 2; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "-size") && i + 2 < argc)
+		{
+			width = atoi(argv[++i]);
+			height = atoi(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-frames") && i + 1 < argc) nFrames = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-dump") && i + 1 < argc) dumpPrefix = argv[++i];
+		else if(!strcmp(argv[i], "-hud")) hud.visible = true;
+		else if(!strcmp(argv[i], "-soft")) software = true;
+		else if(!strcmp(argv[i], "-threads") && i + 1 < argc) nThreads = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-null")) recording = true;
+		else if(!strcmp(argv[i], "-expect") && i + 3 < argc)
+		{
+			for(int j = 0; j < 3; j++) expected[j] = atoi(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "-nocache")) glDevice.caching = false;
+		else if(!strcmp(argv[i], "-validate")) glDevice.validating = true;
+		else if(!strcmp(argv[i], "-replay") && i + 1 < argc && !inputLog.startReplay(argv[++i])) return EXIT_FAILURE;
+	}
+
+	if(expected[0] >= 0 && !recording)
+	{
+		fprintf(stderr, "headless: -expect needs -null\n");
+		return EXIT_FAILURE;
+	}
+
+	// the context still loads the shaders and the buffers with the software rasterizer
+	HeadlessContext context;
+	if(!context.create(width, height)) return EXIT_FAILURE;
+	headless = true;
+	if(software)
+	{
+		soft = new SoftRenderer(nThreads);
+		printf("software rasterizer: %d threads\n", soft->getThreadCount());
+	}
+	if(recording) device = &nullDevice;
+	init();
+	resize(width, height);
+	if(recording)
+	{
+		// the single draw would bypass the device
+		indirectEnabled = false;
+		nullDevice.report();
+		nullDevice.reset();
+	}
+
+	// the whole path or recording at 60 frames per second by default
+	const double frameTime = 1000.0 / 60;
+	if(nFrames <= 0 && inputLog.isReplaying())
+	{
+		nFrames = (int)ceil(inputLog.getEndTick() * timestep.step / frameTime) + 1;
+		printf("replaying %d events over %u ticks\n", inputLog.getEventCount(), inputLog.getEndTick());
+	}
+	if(nFrames <= 0)
+	{
+		float duration = 0;
+		for(int i = 0; i < nPathSegments; i++) duration += cameraPath[i].duration;
+		nFrames = (int)(duration * 1000 / frameTime);
+	}
+
+	// GPU timestamps at the start and the end of the frames
+	GLuint queries[2] = {0, 0};
+	bool timerQueries = GLEW_ARB_timer_query != GL_FALSE;
+	if(timerQueries) glGenQueries(2, queries);
+
+	std::vector<double> cpuTimes, gpuTimes;
+	for(int frame = 0; frame < nFrames; frame++)
+	{
+		// simulated time, the same steps in every run
+		double time = frame * frameTime;
+		if(!inputLog.isReplaying()) setPathKeys((float)time * 0.001f);
+
+		double start = currentTime();
+		int steps = timestep.advance(time);
+		for(int i = 0; i < steps; i++)
+		{
+			step();
+		}
+		if(timerQueries) glQueryCounter(queries[0], GL_TIMESTAMP);
+		display();
+		if(timerQueries) glQueryCounter(queries[1], GL_TIMESTAMP);
+		double cpuTime = currentTime() - start;
+
+		// wait for the frame to finish
+		GLuint64 gpuTime = 0;
+		if(timerQueries)
+		{
+			GLuint64 gpuStart, gpuEnd;
+			glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &gpuStart);
+			glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &gpuEnd);
+			gpuTime = gpuEnd - gpuStart;
+		}
+		else glFinish();
+		cpuTimes.push_back(cpuTime);
+		gpuTimes.push_back(gpuTime * 1e-6);
+		if(soft)
+		{
+			const SoftStats& stats = soft->stats;
+			printf("frame %4d: cpu %8.3f ms, soft geometry %8.3f ms, raster %8.3f ms, %d of %d triangles, %d binned, %d steals\n",
+				frame, cpuTime, stats.geometryTime, stats.rasterTime, stats.setup, stats.triangles, stats.binned, stats.steals);
+		}
+		else if(recording)
+		{
+			const int* counts = nullDevice.counts;
+			recorded[0] = counts[commandDraw];
+			recorded[1] = counts[commandUniform];
+			recorded[2] = counts[commandBindBuffer] + counts[commandBindTexture] + counts[commandUseProgram];
+			printf("frame %4d: cpu %8.3f ms, %d commands, %d draws, %d uniforms, %d binds, %lld triangles\n",
+				frame, cpuTime, (int)nullDevice.commands.size(), recorded[0], recorded[1], recorded[2], nullDevice.triangles);
+			if(frame + 1 < nFrames) nullDevice.reset();
+		}
+		else printf("frame %4d: cpu %8.3f ms, gpu %8.3f ms\n", frame, cpuTime, gpuTime * 1e-6);
+
+		if(dumpPrefix)
+		{
+			char filename[256];
+			sprintf(filename, "%s%04d.ppm", dumpPrefix, frame);
+			bool written = soft ? soft->writeFrame(filename) : context.writeFrame(filename);
+			if(!written) fprintf(stderr, "headless: cannot write %s\n", filename);
+		}
+	}
+
+	// summary of the run
+	double cpuTotal = 0, gpuTotal = 0, cpuMax = 0, gpuMax = 0;
+	for(int i = 0; i < nFrames; i++)
+	{
+		cpuTotal += cpuTimes[i];
+		gpuTotal += gpuTimes[i];
+		if(cpuTimes[i] > cpuMax) cpuMax = cpuTimes[i];
+		if(gpuTimes[i] > gpuMax) gpuMax = gpuTimes[i];
+	}
+	if(nFrames > 0)
+	{
+		printf("%d frames: cpu %.3f ms average, %.3f ms max; gpu %.3f ms average, %.3f ms max%s\n",
+			nFrames, cpuTotal / nFrames, cpuMax, gpuTotal / nFrames, gpuMax, timerQueries ? "" : " (no timer queries)");
+	}
+
+	if(recording) nullDevice.report(); // the commands of the last frame
+
+	// the counts of the last frame against the expected ones
+	bool unexpected = false;
+	for(int i = 0; i < 3; i++)
+	{
+		if(expected[i] >= 0 && recorded[i] != expected[i])
+		{
+			printf("expected %d %s, recorded %d\n", expected[i], countNames[i], recorded[i]);
+			unexpected = true;
+		}
+	}
+	if(expected[0] >= 0 && !unexpected) printf("expected counts recorded\n");
+	if(timerQueries) glDeleteQueries(2, queries);
+	close();
+	delete soft;
+	soft = NULL;
+	device = &glDevice;
+	context.destroy();
+	return unexpected ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 // finalization
 void close()
 {
+	delete occlusion;
+	occlusion = NULL;
+	frameRing.destroy();
+	gpuTimer.destroy();
+	hud.destroy();
+	inputLog.stop(simulationTick);
+	PROFILE_EXPORT("profile.json");
+	PERF_REPORT();
+	ALLOC_REPORT();
+	frameArena.report("frame arena");
 }
@@ -7,6 +7,7 @@
 #ifndef __ANGEL_MAT_H__
 #define __ANGEL_MAT_H__
 
+#include <type_traits>
 #include "vec.h"
 
 namespace Angel {
@@ -25,40 +26,33 @@ class mat2 {
     //  --- Constructors and Destructors ---
     //
 
-    mat2( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
-	{ _m[0].x = d;  _m[1].y = d;   }
+    constexpr mat2( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
+	: _m{ vec2( d, 0.0 ), vec2( 0.0, d ) } {}
 
-    mat2( const vec2& a, const vec2& b )
-	{ _m[0] = a;  _m[1] = b;  }
+    constexpr mat2( const vec2& a, const vec2& b )
+	: _m{ a, b } {}
 
-    mat2( GLfloat m00, GLfloat m10, GLfloat m01, GLfloat m11 )
-	{ _m[0] = vec2( m00, m01 ); _m[1] = vec2( m10, m11 ); }
-
-    mat2( const mat2& m ) {
-	if ( *this != m ) {
-	    _m[0] = m._m[0];
-	    _m[1] = m._m[1];
-	} 
-    }
+    constexpr mat2( GLfloat m00, GLfloat m10, GLfloat m01, GLfloat m11 )
+	: _m{ vec2( m00, m01 ), vec2( m10, m11 ) } {}
 
     //
     //  --- Indexing Operator ---
     //
 
-    vec2& operator [] ( int i ) { return _m[i]; }
-    const vec2& operator [] ( int i ) const { return _m[i]; }
+    constexpr vec2& operator [] ( int i ) { return _m[i]; }
+    constexpr const vec2& operator [] ( int i ) const { return _m[i]; }
 
     //
     //  --- (non-modifying) Arithmatic Operators ---
     //
 
-    mat2 operator + ( const mat2& m ) const
+    constexpr mat2 operator + ( const mat2& m ) const
 	{ return mat2( _m[0]+m[0], _m[1]+m[1] ); }
 
-    mat2 operator - ( const mat2& m ) const
+    constexpr mat2 operator - ( const mat2& m ) const
 	{ return mat2( _m[0]-m[0], _m[1]-m[1] ); }
 
-    mat2 operator * ( const GLfloat s ) const 
+    constexpr mat2 operator * ( const GLfloat s ) const
 	{ return mat2( s*_m[0], s*_m[1] ); }
 
     mat2 operator / ( const GLfloat s ) const {
@@ -75,7 +69,7 @@ class mat2 {
 	return *this * r;
     }
 
-    friend mat2 operator * ( const GLfloat s, const mat2& m )
+    friend constexpr mat2 operator * ( const GLfloat s, const mat2& m )
 	{ return m * s; }
 	
     mat2 operator * ( const mat2& m ) const {
@@ -199,48 +193,35 @@ class mat3 {
     //  --- Constructors and Destructors ---
     //
 
-    mat3( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
-	{ _m[0].x = d;  _m[1].y = d;  _m[2].z = d;   }
+    constexpr mat3( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
+	: _m{ vec3( d, 0.0, 0.0 ), vec3( 0.0, d, 0.0 ), vec3( 0.0, 0.0, d ) } {}
 
-    mat3( const vec3& a, const vec3& b, const vec3& c )
-	{ _m[0] = a;  _m[1] = b;  _m[2] = c;  }
+    constexpr mat3( const vec3& a, const vec3& b, const vec3& c )
+	: _m{ a, b, c } {}
 
-    mat3( GLfloat m00, GLfloat m10, GLfloat m20,
+    constexpr mat3( GLfloat m00, GLfloat m10, GLfloat m20,
 	  GLfloat m01, GLfloat m11, GLfloat m21,
-	  GLfloat m02, GLfloat m12, GLfloat m22 ) 
-	{
-	    _m[0] = vec3( m00, m01, m02 );
-	    _m[1] = vec3( m10, m11, m12 );
-	    _m[2] = vec3( m20, m21, m22 );
-	}
-
-    mat3( const mat3& m )
-	{
-	    if ( *this != m ) {
-		_m[0] = m._m[0];
-		_m[1] = m._m[1];
-		_m[2] = m._m[2];
-	    } 
-	}
+	  GLfloat m02, GLfloat m12, GLfloat m22 )
+	: _m{ vec3( m00, m01, m02 ), vec3( m10, m11, m12 ), vec3( m20, m21, m22 ) } {}
 
     //
     //  --- Indexing Operator ---
     //
 
-    vec3& operator [] ( int i ) { return _m[i]; }
-    const vec3& operator [] ( int i ) const { return _m[i]; }
+    constexpr vec3& operator [] ( int i ) { return _m[i]; }
+    constexpr const vec3& operator [] ( int i ) const { return _m[i]; }
 
     //
     //  --- (non-modifying) Arithmatic Operators ---
     //
 
-    mat3 operator + ( const mat3& m ) const
+    constexpr mat3 operator + ( const mat3& m ) const
 	{ return mat3( _m[0]+m[0], _m[1]+m[1], _m[2]+m[2] ); }
 
-    mat3 operator - ( const mat3& m ) const
+    constexpr mat3 operator - ( const mat3& m ) const
 	{ return mat3( _m[0]-m[0], _m[1]-m[1], _m[2]-m[2] ); }
 
-    mat3 operator * ( const GLfloat s ) const 
+    constexpr mat3 operator * ( const GLfloat s ) const
 	{ return mat3( s*_m[0], s*_m[1], s*_m[2] ); }
 
     mat3 operator / ( const GLfloat s ) const {
@@ -257,7 +238,7 @@ class mat3 {
 	return *this * r;
     }
 
-    friend mat3 operator * ( const GLfloat s, const mat3& m )
+    friend constexpr mat3 operator * ( const GLfloat s, const mat3& m )
 	{ return m * s; }
 	
     mat3 operator * ( const mat3& m ) const {
@@ -374,6 +355,316 @@ mat3 transpose( const mat3& A ) {
 		 A[2][0], A[2][1], A[2][2] );
 }
 
+//----------------------------------------------------------------------------
+//
+//  mat4 kernels - row-major 4x4 matrices as 16 floats
+//
+//    The Scalar versions are the reference.  The SIMD multiply, transform
+//    and transpose add the products in the same order, so they give the
+//    same results.  The SSE inverse works on 2x2 blocks instead of the
+//    cofactors and only agrees up to rounding.  The output may be one of
+//    the inputs.
+//
+
+inline
+void mat4MultiplyScalar( const GLfloat* a, const GLfloat* b, GLfloat* c )
+{
+    GLfloat r[16];
+    for ( int i = 0; i < 4; ++i ) {
+	for ( int j = 0; j < 4; ++j ) {
+	    r[4*i+j] = a[4*i+0]*b[j] + a[4*i+1]*b[4+j] +
+		a[4*i+2]*b[8+j] + a[4*i+3]*b[12+j];
+	}
+    }
+    for ( int i = 0; i < 16; ++i ) { c[i] = r[i]; }
+}
+
+inline
+void mat4TransformScalar( const GLfloat* m, const GLfloat* v, GLfloat* r )
+{
+    GLfloat x = v[0], y = v[1], z = v[2], w = v[3];
+    for ( int i = 0; i < 4; ++i ) {
+	r[i] = m[4*i+0]*x + m[4*i+1]*y + m[4*i+2]*z + m[4*i+3]*w;
+    }
+}
+
+inline
+void mat4TransposeScalar( const GLfloat* m, GLfloat* r )
+{
+    GLfloat t[16];
+    for ( int i = 0; i < 4; ++i ) {
+	for ( int j = 0; j < 4; ++j ) { t[4*j+i] = m[4*i+j]; }
+    }
+    for ( int i = 0; i < 16; ++i ) { r[i] = t[i]; }
+}
+
+//  Inverse by the 2x2 sub-determinants of the top and bottom rows
+inline
+void mat4InverseScalar( const GLfloat* a, GLfloat* b )
+{
+    GLfloat s0 = a[0]*a[5] - a[4]*a[1];
+    GLfloat s1 = a[0]*a[6] - a[4]*a[2];
+    GLfloat s2 = a[0]*a[7] - a[4]*a[3];
+    GLfloat s3 = a[1]*a[6] - a[5]*a[2];
+    GLfloat s4 = a[1]*a[7] - a[5]*a[3];
+    GLfloat s5 = a[2]*a[7] - a[6]*a[3];
+
+    GLfloat c5 = a[10]*a[15] - a[14]*a[11];
+    GLfloat c4 = a[9]*a[15] - a[13]*a[11];
+    GLfloat c3 = a[9]*a[14] - a[13]*a[10];
+    GLfloat c2 = a[8]*a[15] - a[12]*a[11];
+    GLfloat c1 = a[8]*a[14] - a[12]*a[10];
+    GLfloat c0 = a[8]*a[13] - a[12]*a[9];
+
+    GLfloat r = GLfloat(1.0) / ( s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0 );
+
+    GLfloat t[16] = {
+	( a[5]*c5 - a[6]*c4 + a[7]*c3) * r,
+	(-a[1]*c5 + a[2]*c4 - a[3]*c3) * r,
+	( a[13]*s5 - a[14]*s4 + a[15]*s3) * r,
+	(-a[9]*s5 + a[10]*s4 - a[11]*s3) * r,
+
+	(-a[4]*c5 + a[6]*c2 - a[7]*c1) * r,
+	( a[0]*c5 - a[2]*c2 + a[3]*c1) * r,
+	(-a[12]*s5 + a[14]*s2 - a[15]*s1) * r,
+	( a[8]*s5 - a[10]*s2 + a[11]*s1) * r,
+
+	( a[4]*c4 - a[5]*c2 + a[7]*c0) * r,
+	(-a[0]*c4 + a[1]*c2 - a[3]*c0) * r,
+	( a[12]*s4 - a[13]*s2 + a[15]*s0) * r,
+	(-a[8]*s4 + a[9]*s2 - a[11]*s0) * r,
+
+	(-a[4]*c3 + a[5]*c1 - a[6]*c0) * r,
+	( a[0]*c3 - a[1]*c1 + a[2]*c0) * r,
+	(-a[12]*s3 + a[13]*s1 - a[14]*s0) * r,
+	( a[8]*s3 - a[9]*s1 + a[10]*s0) * r
+    };
+    for ( int i = 0; i < 16; ++i ) { b[i] = t[i]; }
+}
+
+#if defined(ANGEL_SSE)
+
+#define ANGEL_SHUFFLE( a, b, x, y, z, w ) \
+    _mm_shuffle_ps( a, b, (x) | ((y) << 2) | ((z) << 4) | ((w) << 6) )
+#define ANGEL_SWIZZLE( a, x, y, z, w )  ANGEL_SHUFFLE( a, a, x, y, z, w )
+
+#if defined(ANGEL_AVX)
+
+//  Two rows at a time, every row of b broadcast to both halves
+inline
+void mat4Multiply( const GLfloat* a, const GLfloat* b, GLfloat* c )
+{
+    __m256 a01 = _mm256_loadu_ps( a );
+    __m256 a23 = _mm256_loadu_ps( a + 8 );
+    __m256 b0 = _mm256_broadcast_ps( (const __m128*)( b ) );
+    __m256 b1 = _mm256_broadcast_ps( (const __m128*)( b + 4 ) );
+    __m256 b2 = _mm256_broadcast_ps( (const __m128*)( b + 8 ) );
+    __m256 b3 = _mm256_broadcast_ps( (const __m128*)( b + 12 ) );
+
+    __m256 r01 = _mm256_mul_ps( _mm256_shuffle_ps( a01, a01, 0x00 ), b0 );
+    r01 = _mm256_add_ps( r01, _mm256_mul_ps( _mm256_shuffle_ps( a01, a01, 0x55 ), b1 ) );
+    r01 = _mm256_add_ps( r01, _mm256_mul_ps( _mm256_shuffle_ps( a01, a01, 0xaa ), b2 ) );
+    r01 = _mm256_add_ps( r01, _mm256_mul_ps( _mm256_shuffle_ps( a01, a01, 0xff ), b3 ) );
+
+    __m256 r23 = _mm256_mul_ps( _mm256_shuffle_ps( a23, a23, 0x00 ), b0 );
+    r23 = _mm256_add_ps( r23, _mm256_mul_ps( _mm256_shuffle_ps( a23, a23, 0x55 ), b1 ) );
+    r23 = _mm256_add_ps( r23, _mm256_mul_ps( _mm256_shuffle_ps( a23, a23, 0xaa ), b2 ) );
+    r23 = _mm256_add_ps( r23, _mm256_mul_ps( _mm256_shuffle_ps( a23, a23, 0xff ), b3 ) );
+
+    _mm256_storeu_ps( c, r01 );
+    _mm256_storeu_ps( c + 8, r23 );
+}
+
+#else
+
+//  Every row of c is the rows of b weighted by the row of a
+inline
+void mat4Multiply( const GLfloat* a, const GLfloat* b, GLfloat* c )
+{
+    __m128 b0 = _mm_loadu_ps( b );
+    __m128 b1 = _mm_loadu_ps( b + 4 );
+    __m128 b2 = _mm_loadu_ps( b + 8 );
+    __m128 b3 = _mm_loadu_ps( b + 12 );
+
+    for ( int i = 0; i < 4; ++i ) {
+	__m128 row = _mm_loadu_ps( a + 4*i );
+	__m128 r = _mm_mul_ps( ANGEL_SWIZZLE( row, 0, 0, 0, 0 ), b0 );
+	r = _mm_add_ps( r, _mm_mul_ps( ANGEL_SWIZZLE( row, 1, 1, 1, 1 ), b1 ) );
+	r = _mm_add_ps( r, _mm_mul_ps( ANGEL_SWIZZLE( row, 2, 2, 2, 2 ), b2 ) );
+	r = _mm_add_ps( r, _mm_mul_ps( ANGEL_SWIZZLE( row, 3, 3, 3, 3 ), b3 ) );
+	_mm_storeu_ps( c + 4*i, r );
+    }
+}
+
+#endif // ANGEL_AVX
+
+//  The columns of m weighted by the components of v
+inline
+void mat4Transform( const GLfloat* m, const GLfloat* v, GLfloat* r )
+{
+    __m128 c0 = _mm_loadu_ps( m );
+    __m128 c1 = _mm_loadu_ps( m + 4 );
+    __m128 c2 = _mm_loadu_ps( m + 8 );
+    __m128 c3 = _mm_loadu_ps( m + 12 );
+    _MM_TRANSPOSE4_PS( c0, c1, c2, c3 );
+
+    __m128 u = _mm_loadu_ps( v );
+    __m128 s = _mm_mul_ps( c0, ANGEL_SWIZZLE( u, 0, 0, 0, 0 ) );
+    s = _mm_add_ps( s, _mm_mul_ps( c1, ANGEL_SWIZZLE( u, 1, 1, 1, 1 ) ) );
+    s = _mm_add_ps( s, _mm_mul_ps( c2, ANGEL_SWIZZLE( u, 2, 2, 2, 2 ) ) );
+    s = _mm_add_ps( s, _mm_mul_ps( c3, ANGEL_SWIZZLE( u, 3, 3, 3, 3 ) ) );
+    _mm_storeu_ps( r, s );
+}
+
+inline
+void mat4Transpose( const GLfloat* m, GLfloat* r )
+{
+    __m128 r0 = _mm_loadu_ps( m );
+    __m128 r1 = _mm_loadu_ps( m + 4 );
+    __m128 r2 = _mm_loadu_ps( m + 8 );
+    __m128 r3 = _mm_loadu_ps( m + 12 );
+    _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+    _mm_storeu_ps( r, r0 );
+    _mm_storeu_ps( r + 4, r1 );
+    _mm_storeu_ps( r + 8, r2 );
+    _mm_storeu_ps( r + 12, r3 );
+}
+
+//  2x2 blocks as (m00, m01, m10, m11): a * b, adj(a) * b and a * adj(b)
+inline __m128 mat2Multiply( __m128 a, __m128 b )
+{
+    return _mm_add_ps( _mm_mul_ps( a, ANGEL_SWIZZLE( b, 0, 3, 0, 3 ) ),
+		       _mm_mul_ps( ANGEL_SWIZZLE( a, 1, 0, 3, 2 ), ANGEL_SWIZZLE( b, 2, 1, 2, 1 ) ) );
+}
+
+inline __m128 mat2AdjointMultiply( __m128 a, __m128 b )
+{
+    return _mm_sub_ps( _mm_mul_ps( ANGEL_SWIZZLE( a, 3, 3, 0, 0 ), b ),
+		       _mm_mul_ps( ANGEL_SWIZZLE( a, 1, 1, 2, 2 ), ANGEL_SWIZZLE( b, 2, 3, 0, 1 ) ) );
+}
+
+inline __m128 mat2MultiplyAdjoint( __m128 a, __m128 b )
+{
+    return _mm_sub_ps( _mm_mul_ps( a, ANGEL_SWIZZLE( b, 3, 0, 3, 0 ) ),
+		       _mm_mul_ps( ANGEL_SWIZZLE( a, 1, 0, 3, 2 ), ANGEL_SWIZZLE( b, 2, 1, 2, 1 ) ) );
+}
+
+//  Inverse by the 2x2 blocks A B / C D of the matrix
+inline
+void mat4Inverse( const GLfloat* m, GLfloat* r )
+{
+    __m128 r0 = _mm_loadu_ps( m );
+    __m128 r1 = _mm_loadu_ps( m + 4 );
+    __m128 r2 = _mm_loadu_ps( m + 8 );
+    __m128 r3 = _mm_loadu_ps( m + 12 );
+
+    __m128 A = _mm_movelh_ps( r0, r1 );
+    __m128 B = _mm_movehl_ps( r1, r0 );
+    __m128 C = _mm_movelh_ps( r2, r3 );
+    __m128 D = _mm_movehl_ps( r3, r2 );
+
+    // determinants of the blocks as (|A|, |B|, |C|, |D|)
+    __m128 det = _mm_sub_ps(
+	_mm_mul_ps( ANGEL_SHUFFLE( r0, r2, 0, 2, 0, 2 ), ANGEL_SHUFFLE( r1, r3, 1, 3, 1, 3 ) ),
+	_mm_mul_ps( ANGEL_SHUFFLE( r0, r2, 1, 3, 1, 3 ), ANGEL_SHUFFLE( r1, r3, 0, 2, 0, 2 ) ) );
+    __m128 detA = ANGEL_SWIZZLE( det, 0, 0, 0, 0 );
+    __m128 detB = ANGEL_SWIZZLE( det, 1, 1, 1, 1 );
+    __m128 detC = ANGEL_SWIZZLE( det, 2, 2, 2, 2 );
+    __m128 detD = ANGEL_SWIZZLE( det, 3, 3, 3, 3 );
+
+    // the adjoints of the blocks of the inverse X Y / Z W
+    __m128 DC = mat2AdjointMultiply( D, C );
+    __m128 AB = mat2AdjointMultiply( A, B );
+    __m128 X = _mm_sub_ps( _mm_mul_ps( detD, A ), mat2Multiply( B, DC ) );
+    __m128 W = _mm_sub_ps( _mm_mul_ps( detA, D ), mat2Multiply( C, AB ) );
+    __m128 Y = _mm_sub_ps( _mm_mul_ps( detB, C ), mat2MultiplyAdjoint( D, AB ) );
+    __m128 Z = _mm_sub_ps( _mm_mul_ps( detC, B ), mat2MultiplyAdjoint( A, DC ) );
+
+    // |M| = |A| |D| + |B| |C| - tr(adj(A) B adj(D) C)
+    __m128 trace = _mm_mul_ps( AB, ANGEL_SWIZZLE( DC, 0, 2, 1, 3 ) );
+    trace = _mm_add_ps( trace, ANGEL_SWIZZLE( trace, 2, 3, 0, 1 ) );
+    trace = _mm_add_ps( trace, ANGEL_SWIZZLE( trace, 1, 0, 3, 2 ) );
+    __m128 detM = _mm_sub_ps( _mm_add_ps( _mm_mul_ps( detA, detD ), _mm_mul_ps( detB, detC ) ), trace );
+
+    // the adjoint signs with the division by the determinant
+    __m128 scale = _mm_div_ps( _mm_setr_ps( 1.0f, -1.0f, -1.0f, 1.0f ), detM );
+    X = _mm_mul_ps( X, scale );
+    Y = _mm_mul_ps( Y, scale );
+    Z = _mm_mul_ps( Z, scale );
+    W = _mm_mul_ps( W, scale );
+
+    _mm_storeu_ps( r, ANGEL_SHUFFLE( X, Y, 3, 1, 3, 1 ) );
+    _mm_storeu_ps( r + 4, ANGEL_SHUFFLE( X, Y, 2, 0, 2, 0 ) );
+    _mm_storeu_ps( r + 8, ANGEL_SHUFFLE( Z, W, 3, 1, 3, 1 ) );
+    _mm_storeu_ps( r + 12, ANGEL_SHUFFLE( Z, W, 2, 0, 2, 0 ) );
+}
+
+#elif defined(ANGEL_NEON)
+
+inline
+void mat4Multiply( const GLfloat* a, const GLfloat* b, GLfloat* c )
+{
+    float32x4_t b0 = vld1q_f32( b );
+    float32x4_t b1 = vld1q_f32( b + 4 );
+    float32x4_t b2 = vld1q_f32( b + 8 );
+    float32x4_t b3 = vld1q_f32( b + 12 );
+
+    for ( int i = 0; i < 4; ++i ) {
+	float32x4_t row = vld1q_f32( a + 4*i );
+	float32x4_t r = vmulq_n_f32( b0, vgetq_lane_f32( row, 0 ) );
+	r = vaddq_f32( r, vmulq_n_f32( b1, vgetq_lane_f32( row, 1 ) ) );
+	r = vaddq_f32( r, vmulq_n_f32( b2, vgetq_lane_f32( row, 2 ) ) );
+	r = vaddq_f32( r, vmulq_n_f32( b3, vgetq_lane_f32( row, 3 ) ) );
+	vst1q_f32( c + 4*i, r );
+    }
+}
+
+//  vld4q loads the matrix as its columns
+inline
+void mat4Transform( const GLfloat* m, const GLfloat* v, GLfloat* r )
+{
+    float32x4x4_t c = vld4q_f32( m );
+    float32x4_t s = vmulq_n_f32( c.val[0], v[0] );
+    s = vaddq_f32( s, vmulq_n_f32( c.val[1], v[1] ) );
+    s = vaddq_f32( s, vmulq_n_f32( c.val[2], v[2] ) );
+    s = vaddq_f32( s, vmulq_n_f32( c.val[3], v[3] ) );
+    vst1q_f32( r, s );
+}
+
+inline
+void mat4Transpose( const GLfloat* m, GLfloat* r )
+{
+    float32x4x4_t c = vld4q_f32( m );
+    vst1q_f32( r, c.val[0] );
+    vst1q_f32( r + 4, c.val[1] );
+    vst1q_f32( r + 8, c.val[2] );
+    vst1q_f32( r + 12, c.val[3] );
+}
+
+inline
+void mat4Inverse( const GLfloat* m, GLfloat* r )
+    { mat4InverseScalar( m, r ); }
+
+#else
+
+inline
+void mat4Multiply( const GLfloat* a, const GLfloat* b, GLfloat* c )
+    { mat4MultiplyScalar( a, b, c ); }
+
+inline
+void mat4Transform( const GLfloat* m, const GLfloat* v, GLfloat* r )
+    { mat4TransformScalar( m, v, r ); }
+
+inline
+void mat4Transpose( const GLfloat* m, GLfloat* r )
+    { mat4TransposeScalar( m, r ); }
+
+inline
+void mat4Inverse( const GLfloat* m, GLfloat* r )
+    { mat4InverseScalar( m, r ); }
+
+#endif // ANGEL_SSE
+
 //----------------------------------------------------------------------------
 //
 //  mat4.h - 4D square matrix
@@ -388,51 +679,38 @@ class mat4 {
     //  --- Constructors and Destructors ---
     //
 
-    mat4( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
-	{ _m[0].x = d;  _m[1].y = d;  _m[2].z = d;  _m[3].w = d; }
+    constexpr mat4( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
+	: _m{ vec4( d, 0.0, 0.0, 0.0 ), vec4( 0.0, d, 0.0, 0.0 ),
+	      vec4( 0.0, 0.0, d, 0.0 ), vec4( 0.0, 0.0, 0.0, d ) } {}
 
-    mat4( const vec4& a, const vec4& b, const vec4& c, const vec4& d )
-	{ _m[0] = a;  _m[1] = b;  _m[2] = c;  _m[3] = d; }
+    constexpr mat4( const vec4& a, const vec4& b, const vec4& c, const vec4& d )
+	: _m{ a, b, c, d } {}
 
-    mat4( GLfloat m00, GLfloat m10, GLfloat m20, GLfloat m30,
+    constexpr mat4( GLfloat m00, GLfloat m10, GLfloat m20, GLfloat m30,
 	  GLfloat m01, GLfloat m11, GLfloat m21, GLfloat m31,
 	  GLfloat m02, GLfloat m12, GLfloat m22, GLfloat m32,
 	  GLfloat m03, GLfloat m13, GLfloat m23, GLfloat m33 )
-	{
-	    _m[0] = vec4( m00, m01, m02, m03 );
-	    _m[1] = vec4( m10, m11, m12, m13 );
-	    _m[2] = vec4( m20, m21, m22, m23 );
-	    _m[3] = vec4( m30, m31, m32, m33 );
-	}
-
-    mat4( const mat4& m )
-	{
-	    if ( *this != m ) {
-		_m[0] = m._m[0];
-		_m[1] = m._m[1];
-		_m[2] = m._m[2];
-		_m[3] = m._m[3];
-	    } 
-	}
+	: _m{ vec4( m00, m01, m02, m03 ), vec4( m10, m11, m12, m13 ),
+	      vec4( m20, m21, m22, m23 ), vec4( m30, m31, m32, m33 ) } {}
 
     //
     //  --- Indexing Operator ---
     //
 
-    vec4& operator [] ( int i ) { return _m[i]; }
-    const vec4& operator [] ( int i ) const { return _m[i]; }
+    constexpr vec4& operator [] ( int i ) { return _m[i]; }
+    constexpr const vec4& operator [] ( int i ) const { return _m[i]; }
 
     //
     //  --- (non-modifying) Arithematic Operators ---
     //
 
-    mat4 operator + ( const mat4& m ) const
+    constexpr mat4 operator + ( const mat4& m ) const
 	{ return mat4( _m[0]+m[0], _m[1]+m[1], _m[2]+m[2], _m[3]+m[3] ); }
 
-    mat4 operator - ( const mat4& m ) const
+    constexpr mat4 operator - ( const mat4& m ) const
 	{ return mat4( _m[0]-m[0], _m[1]-m[1], _m[2]-m[2], _m[3]-m[3] ); }
 
-    mat4 operator * ( const GLfloat s ) const 
+    constexpr mat4 operator * ( const GLfloat s ) const
 	{ return mat4( s*_m[0], s*_m[1], s*_m[2], s*_m[3] ); }
 
     mat4 operator / ( const GLfloat s ) const {
@@ -449,21 +727,17 @@ class mat4 {
 	return *this * r;
     }
 
-    friend mat4 operator * ( const GLfloat s, const mat4& m )
+    friend constexpr mat4 operator * ( const GLfloat s, const mat4& m )
 	{ return m * s; }
 	
-    mat4 operator * ( const mat4& m ) const {
-	mat4  a( 0.0 );
-
-	for ( int i = 0; i < 4; ++i ) {
-	    for ( int j = 0; j < 4; ++j ) {
-		for ( int k = 0; k < 4; ++k ) {
-		    a[i][j] += _m[i][k] * m[k][j];
-		}
-	    }
+    constexpr mat4 operator * ( const mat4& m ) const {
+	if ( ANGEL_RUNTIME() ) {
+	    mat4  a;
+	    mat4Multiply( *this, m, a );
+	    return a;
 	}
-
-	return a;
+	return mat4( m.combine( _m[0] ), m.combine( _m[1] ),
+		     m.combine( _m[2] ), m.combine( _m[3] ) );
     }
 
     //
@@ -486,17 +760,8 @@ class mat4 {
     }
 
     mat4& operator *= ( const mat4& m ) {
-	mat4  a( 0.0 );
-
-	for ( int i = 0; i < 4; ++i ) {
-	    for ( int j = 0; j < 4; ++j ) {
-		for ( int k = 0; k < 4; ++k ) {
-		    a[i][j] += _m[i][k] * m[k][j];
-		}
-	    }
-	}
-
-	return *this = a;
+	mat4Multiply( *this, m, *this );
+	return *this;
     }
 
     mat4& operator /= ( const GLfloat s ) {
@@ -517,12 +782,16 @@ class mat4 {
     //  --- Matrix / Vector operators ---
     //
 
-    vec4 operator * ( const vec4& v ) const {  // m * v
-	return vec4( _m[0][0]*v.x + _m[0][1]*v.y + _m[0][2]*v.z + _m[0][3]*v.w,
-		     _m[1][0]*v.x + _m[1][1]*v.y + _m[1][2]*v.z + _m[1][3]*v.w,
-		     _m[2][0]*v.x + _m[2][1]*v.y + _m[2][2]*v.z + _m[2][3]*v.w,
-		     _m[3][0]*v.x + _m[3][1]*v.y + _m[3][2]*v.z + _m[3][3]*v.w
-	    );
+    constexpr vec4 operator * ( const vec4& v ) const {  // m * v
+	if ( ANGEL_RUNTIME() ) {
+	    vec4  r;
+	    mat4Transform( *this, v, r );
+	    return r;
+	}
+	return vec4( _m[0].x*v.x + _m[0].y*v.y + _m[0].z*v.z + _m[0].w*v.w,
+		     _m[1].x*v.x + _m[1].y*v.y + _m[1].z*v.z + _m[1].w*v.w,
+		     _m[2].x*v.x + _m[2].y*v.y + _m[2].z*v.z + _m[2].w*v.w,
+		     _m[3].x*v.x + _m[3].y*v.y + _m[3].z*v.z + _m[3].w*v.w );
     }
 	
     //
@@ -549,6 +818,11 @@ class mat4 {
 
     operator GLfloat* ()
 	{ return static_cast<GLfloat*>( &_m[0].x ); }
+
+   private:
+    //  row * this, summed in the order of the kernels
+    constexpr vec4 combine( const vec4& row ) const
+	{ return _m[0]*row.x + _m[1]*row.y + _m[2]*row.z + _m[3]*row.w; }
 };
 
 //
@@ -566,10 +840,277 @@ mat4 matrixCompMult( const mat4& A, const mat4& B ) {
 
 inline
 mat4 transpose( const mat4& A ) {
-    return mat4( A[0][0], A[0][1], A[0][2], A[0][3],
-		 A[1][0], A[1][1], A[1][2], A[1][3],
-		 A[2][0], A[2][1], A[2][2], A[2][3],
-		 A[3][0], A[3][1], A[3][2], A[3][3] );
+    mat4  c;
+    mat4Transpose( A, c );
+    return c;
+}
+
+inline
+mat4 inverse( const mat4& A ) {
+    mat4  c;
+    mat4Inverse( A, c );
+    return c;
+}
+
+//----------------------------------------------------------------------------
+//
+//  Batch transforms - structure-of-arrays data transformed by one mat4
+//
+//    Every item gets the arithmetic of mat4 * vec4 in the same order, so a
+//    batch gives the results of transforming the items one at a time.  AVX
+//    does 8 items at once, SSE and NEON 4; the items left over go through
+//    a padded copy.  The outputs may be the inputs.  Boxes may also take a
+//    transformation each, its entries given as arrays like the items.
+//
+
+struct vec3SoA { GLfloat* x;  GLfloat* y;  GLfloat* z; };
+struct vec4SoA { GLfloat* x;  GLfloat* y;  GLfloat* z;  GLfloat* w; };
+
+#if defined(ANGEL_AVX)
+
+typedef __m256 batchf;
+const int batchWidth = 8;
+inline batchf batchLoad( const GLfloat* p ) { return _mm256_loadu_ps( p ); }
+inline void batchStore( GLfloat* p, batchf a ) { _mm256_storeu_ps( p, a ); }
+inline batchf batchSet( GLfloat s ) { return _mm256_set1_ps( s ); }
+inline batchf batchAdd( batchf a, batchf b ) { return _mm256_add_ps( a, b ); }
+inline batchf batchMul( batchf a, batchf b ) { return _mm256_mul_ps( a, b ); }
+inline batchf batchMin( batchf a, batchf b ) { return _mm256_min_ps( a, b ); }  // a < b ? a : b
+inline batchf batchMax( batchf a, batchf b ) { return _mm256_max_ps( b, a ); }  // a < b ? b : a
+
+#elif defined(ANGEL_SSE)
+
+typedef __m128 batchf;
+const int batchWidth = 4;
+inline batchf batchLoad( const GLfloat* p ) { return _mm_loadu_ps( p ); }
+inline void batchStore( GLfloat* p, batchf a ) { _mm_storeu_ps( p, a ); }
+inline batchf batchSet( GLfloat s ) { return _mm_set1_ps( s ); }
+inline batchf batchAdd( batchf a, batchf b ) { return _mm_add_ps( a, b ); }
+inline batchf batchMul( batchf a, batchf b ) { return _mm_mul_ps( a, b ); }
+inline batchf batchMin( batchf a, batchf b ) { return _mm_min_ps( a, b ); }
+inline batchf batchMax( batchf a, batchf b ) { return _mm_max_ps( b, a ); }
+
+#elif defined(ANGEL_NEON)
+
+typedef float32x4_t batchf;
+const int batchWidth = 4;
+inline batchf batchLoad( const GLfloat* p ) { return vld1q_f32( p ); }
+inline void batchStore( GLfloat* p, batchf a ) { vst1q_f32( p, a ); }
+inline batchf batchSet( GLfloat s ) { return vdupq_n_f32( s ); }
+inline batchf batchAdd( batchf a, batchf b ) { return vaddq_f32( a, b ); }
+inline batchf batchMul( batchf a, batchf b ) { return vmulq_f32( a, b ); }
+inline batchf batchMin( batchf a, batchf b ) { return vminq_f32( a, b ); }
+inline batchf batchMax( batchf a, batchf b ) { return vmaxq_f32( a, b ); }
+
+#else
+
+typedef GLfloat batchf;
+const int batchWidth = 1;
+inline batchf batchLoad( const GLfloat* p ) { return *p; }
+inline void batchStore( GLfloat* p, batchf a ) { *p = a; }
+inline batchf batchSet( GLfloat s ) { return s; }
+inline batchf batchAdd( batchf a, batchf b ) { return a + b; }
+inline batchf batchMul( batchf a, batchf b ) { return a * b; }
+inline batchf batchMin( batchf a, batchf b ) { return a < b ? a : b; }
+inline batchf batchMax( batchf a, batchf b ) { return a < b ? b : a; }
+
+#endif // ANGEL_AVX
+
+//  One step of batchWidth items at offset i of the input and output arrays
+typedef void (*batchStep)( const mat4& m, const GLfloat* const* in, GLfloat* const* out, int i );
+
+const int batchArrays = 18;  // most input arrays of a step, the boxes with their transformations
+
+//  The steps over n items, the last ones padded with copies of the first
+inline
+void batchRun( const mat4& m, const GLfloat* const* in, int nIn,
+	       GLfloat* const* out, int nOut, int n, batchStep step )
+{
+    int i = 0;
+    for ( ; i + batchWidth <= n; i += batchWidth ) {
+	step( m, in, out, i );
+    }
+    if ( i < n ) {
+	GLfloat padIn[batchArrays][batchWidth], padOut[6][batchWidth];
+	const GLfloat* pin[batchArrays];
+	GLfloat* pout[6];
+	for ( int k = 0; k < nIn; ++k ) {
+	    for ( int j = 0; j < batchWidth; ++j ) { padIn[k][j] = in[k][i + j < n ? i + j : 0]; }
+	    pin[k] = padIn[k];
+	}
+	for ( int k = 0; k < nOut; ++k ) { pout[k] = padOut[k]; }
+	step( m, pin, pout, 0 );
+	for ( int k = 0; k < nOut; ++k ) {
+	    for ( int j = 0; i + j < n; ++j ) { out[k][i + j] = padOut[k][j]; }
+	}
+    }
+}
+
+//  row r of m times (x, y, z, 1), or (x, y, z, 0) without the translation
+inline batchf batchRow( const mat4& m, int r, batchf x, batchf y, batchf z, bool translate )
+{
+    batchf s = batchAdd( batchAdd( batchMul( batchSet( m[r].x ), x ), batchMul( batchSet( m[r].y ), y ) ),
+			 batchMul( batchSet( m[r].z ), z ) );
+    return translate ? batchAdd( s, batchSet( m[r].w ) ) : s;
+}
+
+inline void pointsStep( const mat4& m, const GLfloat* const* in, GLfloat* const* out, int i )
+{
+    batchf x = batchLoad( in[0] + i ), y = batchLoad( in[1] + i ), z = batchLoad( in[2] + i );
+    batchf rx = batchRow( m, 0, x, y, z, true );
+    batchf ry = batchRow( m, 1, x, y, z, true );
+    batchf rz = batchRow( m, 2, x, y, z, true );
+    batchStore( out[0] + i, rx );
+    batchStore( out[1] + i, ry );
+    batchStore( out[2] + i, rz );
+}
+
+inline void projectStep( const mat4& m, const GLfloat* const* in, GLfloat* const* out, int i )
+{
+    batchf x = batchLoad( in[0] + i ), y = batchLoad( in[1] + i ), z = batchLoad( in[2] + i );
+    batchf rx = batchRow( m, 0, x, y, z, true );
+    batchf ry = batchRow( m, 1, x, y, z, true );
+    batchf rz = batchRow( m, 2, x, y, z, true );
+    batchf rw = batchRow( m, 3, x, y, z, true );
+    batchStore( out[0] + i, rx );
+    batchStore( out[1] + i, ry );
+    batchStore( out[2] + i, rz );
+    batchStore( out[3] + i, rw );
+}
+
+inline void directionsStep( const mat4& m, const GLfloat* const* in, GLfloat* const* out, int i )
+{
+    batchf x = batchLoad( in[0] + i ), y = batchLoad( in[1] + i ), z = batchLoad( in[2] + i );
+    batchf rx = batchRow( m, 0, x, y, z, false );
+    batchf ry = batchRow( m, 1, x, y, z, false );
+    batchf rz = batchRow( m, 2, x, y, z, false );
+    batchStore( out[0] + i, rx );
+    batchStore( out[1] + i, ry );
+    batchStore( out[2] + i, rz );
+}
+
+//  Arvo's method: every output axis starts at the translation and takes
+//  the smaller and the larger of the scaled input extents
+inline void boxesStep( const mat4& m, const GLfloat* const* in, GLfloat* const* out, int i )
+{
+    batchf lo[3], hi[3];
+    for ( int j = 0; j < 3; ++j ) {
+	lo[j] = batchLoad( in[j] + i );
+	hi[j] = batchLoad( in[3 + j] + i );
+    }
+    for ( int r = 0; r < 3; ++r ) {
+	batchf rmin = batchSet( m[r].w ), rmax = rmin;
+	for ( int j = 0; j < 3; ++j ) {
+	    batchf e = batchSet( m[r][j] );
+	    batchf a = batchMul( e, lo[j] ), b = batchMul( e, hi[j] );
+	    rmin = batchAdd( rmin, batchMin( a, b ) );
+	    rmax = batchAdd( rmax, batchMax( a, b ) );
+	}
+	batchStore( out[r] + i, rmin );
+	batchStore( out[3 + r] + i, rmax );
+    }
+}
+
+//  the same with a transformation per item, in[6 + 4 * r + c] holding the
+//  entry (r, c) of the top three rows of every item's matrix
+inline void boxesEachStep( const mat4&, const GLfloat* const* in, GLfloat* const* out, int i )
+{
+    batchf lo[3], hi[3];
+    for ( int j = 0; j < 3; ++j ) {
+	lo[j] = batchLoad( in[j] + i );
+	hi[j] = batchLoad( in[3 + j] + i );
+    }
+    for ( int r = 0; r < 3; ++r ) {
+	const GLfloat* const* row = in + 6 + 4 * r;
+	batchf rmin = batchLoad( row[3] + i ), rmax = rmin;
+	for ( int j = 0; j < 3; ++j ) {
+	    batchf e = batchLoad( row[j] + i );
+	    batchf a = batchMul( e, lo[j] ), b = batchMul( e, hi[j] );
+	    rmin = batchAdd( rmin, batchMin( a, b ) );
+	    rmax = batchAdd( rmax, batchMax( a, b ) );
+	}
+	batchStore( out[r] + i, rmin );
+	batchStore( out[3 + r] + i, rmax );
+    }
+}
+
+//  points (x, y, z, 1) of an affine transformation
+inline
+void transformPoints( const mat4& m, const vec3SoA& in, const vec3SoA& out, int n )
+{
+    const GLfloat* pin[3] = { in.x, in.y, in.z };
+    GLfloat* pout[3] = { out.x, out.y, out.z };
+    batchRun( m, pin, 3, pout, 3, n, pointsStep );
+}
+
+//  points (x, y, z, 1) with the w of a projective transformation
+inline
+void transformPoints( const mat4& m, const vec3SoA& in, const vec4SoA& out, int n )
+{
+    const GLfloat* pin[3] = { in.x, in.y, in.z };
+    GLfloat* pout[4] = { out.x, out.y, out.z, out.w };
+    batchRun( m, pin, 3, pout, 4, n, projectStep );
+}
+
+//  directions (x, y, z, 0), normals need the inverse transpose
+inline
+void transformDirections( const mat4& m, const vec3SoA& in, const vec3SoA& out, int n )
+{
+    const GLfloat* pin[3] = { in.x, in.y, in.z };
+    GLfloat* pout[3] = { out.x, out.y, out.z };
+    batchRun( m, pin, 3, pout, 3, n, directionsStep );
+}
+
+//  bounding boxes of the transformed boxes of an affine transformation
+inline
+void transformBoxes( const mat4& m, const vec3SoA& inMin, const vec3SoA& inMax,
+		     const vec3SoA& outMin, const vec3SoA& outMax, int n )
+{
+    const GLfloat* pin[6] = { inMin.x, inMin.y, inMin.z, inMax.x, inMax.y, inMax.z };
+    GLfloat* pout[6] = { outMin.x, outMin.y, outMin.z, outMax.x, outMax.y, outMax.z };
+    batchRun( m, pin, 6, pout, 6, n, boxesStep );
+}
+
+//  bounding boxes, each by its own affine transformation, rows[4 * r + c]
+//  holding the entries (r, c) of the top three rows
+inline
+void transformBoxes( const GLfloat* const rows[12], const vec3SoA& inMin, const vec3SoA& inMax,
+		     const vec3SoA& outMin, const vec3SoA& outMax, int n )
+{
+    const GLfloat* pin[batchArrays] = { inMin.x, inMin.y, inMin.z, inMax.x, inMax.y, inMax.z };
+    for ( int k = 0; k < 12; ++k ) { pin[6 + k] = rows[k]; }
+    GLfloat* pout[6] = { outMin.x, outMin.y, outMin.z, outMax.x, outMax.y, outMax.z };
+    batchRun( mat4(), pin, batchArrays, pout, 6, n, boxesEachStep );
+}
+
+//  extend the box to hold the n points
+inline
+void pointBounds( const vec3SoA& points, int n, vec3& boundsMin, vec3& boundsMax )
+{
+    if ( n <= 0 ) { return; }
+
+    const GLfloat* p[3] = { points.x, points.y, points.z };
+    for ( int k = 0; k < 3; ++k ) {
+	batchf lo = batchSet( boundsMin[k] ), hi = batchSet( boundsMax[k] );
+	int i = 0;
+	for ( ; i + batchWidth <= n; i += batchWidth ) {
+	    batchf v = batchLoad( p[k] + i );
+	    lo = batchMin( lo, v );
+	    hi = batchMax( hi, v );
+	}
+
+	GLfloat los[batchWidth], his[batchWidth];
+	batchStore( los, lo );
+	batchStore( his, hi );
+	for ( ; i < n; ++i ) {
+	    if ( p[k][i] < los[0] ) { los[0] = p[k][i]; }
+	    if ( p[k][i] > his[0] ) { his[0] = p[k][i]; }
+	}
+	for ( int j = 0; j < batchWidth; ++j ) {
+	    if ( los[j] < boundsMin[k] ) { boundsMin[k] = los[j]; }
+	    if ( his[j] > boundsMax[k] ) { boundsMax[k] = his[j]; }
+	}
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -595,45 +1136,98 @@ vec4 mvmult( const mat4& a, const vec4& b )
     return c;
 }
 
+//----------------------------------------------------------------------------
+//
+//  sin, cos and tan usable at compile time, by the Taylor series around
+//  the nearest multiple of pi/2 in double precision
+//
+
+inline constexpr
+double sinSeries( const double x )
+{
+    double term = x, sum = x;
+    for ( int n = 1; n < 10; ++n ) {
+	term *= -x * x / ( (2*n) * (2*n + 1) );
+	sum += term;
+    }
+    return sum;
+}
+
+inline constexpr
+double cosSeries( const double x )
+{
+    double term = 1.0, sum = 1.0;
+    for ( int n = 1; n < 10; ++n ) {
+	term *= -x * x / ( (2*n - 1) * (2*n) );
+	sum += term;
+    }
+    return sum;
+}
+
+inline constexpr
+double sinConstexpr( const double x )
+{
+    double quarters = x / ( M_PI / 2 );
+    long long k = (long long)( quarters < 0 ? quarters - 0.5 : quarters + 0.5 );
+    double r = x - k * ( M_PI / 2 );
+    switch ( k & 3 ) {
+	case 0:  return sinSeries( r );
+	case 1:  return cosSeries( r );
+	case 2:  return -sinSeries( r );
+	default: return -cosSeries( r );
+    }
+}
+
+inline constexpr
+double cosConstexpr( const double x )
+    { return sinConstexpr( x + M_PI / 2 ); }
+
+inline constexpr
+double tanConstexpr( const double x )
+    { return sinConstexpr( x ) / cosConstexpr( x ); }
+
 //----------------------------------------------------------------------------
 //
 //  Rotation matrix generators
 //
 
-inline
+inline constexpr
 mat4 RotateX( const GLfloat theta )
 {
     GLfloat angle = DegreesToRadians * theta;
+    GLfloat c = ANGEL_RUNTIME() ? cos(angle) : cosConstexpr(angle);
+    GLfloat s = ANGEL_RUNTIME() ? sin(angle) : sinConstexpr(angle);
 
-    mat4 c;
-    c[2][2] = c[1][1] = cos(angle);
-    c[2][1] = sin(angle);
-    c[1][2] = -c[2][1];
-    return c;
+    return mat4( vec4( 1.0, 0.0, 0.0, 0.0 ),
+		 vec4( 0.0,  c,  -s,  0.0 ),
+		 vec4( 0.0,  s,   c,  0.0 ),
+		 vec4( 0.0, 0.0, 0.0, 1.0 ) );
 }
 
-inline
+inline constexpr
 mat4 RotateY( const GLfloat theta )
 {
     GLfloat angle = DegreesToRadians * theta;
+    GLfloat c = ANGEL_RUNTIME() ? cos(angle) : cosConstexpr(angle);
+    GLfloat s = ANGEL_RUNTIME() ? sin(angle) : sinConstexpr(angle);
 
-    mat4 c;
-    c[2][2] = c[0][0] = cos(angle);
-    c[0][2] = sin(angle);
-    c[2][0] = -c[0][2];
-    return c;
+    return mat4( vec4(  c,  0.0,  s,  0.0 ),
+		 vec4( 0.0, 1.0, 0.0, 0.0 ),
+		 vec4( -s,  0.0,  c,  0.0 ),
+		 vec4( 0.0, 0.0, 0.0, 1.0 ) );
 }
 
-inline
+inline constexpr
 mat4 RotateZ( const GLfloat theta )
 {
     GLfloat angle = DegreesToRadians * theta;
+    GLfloat c = ANGEL_RUNTIME() ? cos(angle) : cosConstexpr(angle);
+    GLfloat s = ANGEL_RUNTIME() ? sin(angle) : sinConstexpr(angle);
 
-    mat4 c;
-    c[0][0] = c[1][1] = cos(angle);
-    c[1][0] = sin(angle);
-    c[0][1] = -c[1][0];
-    return c;
+    return mat4( vec4(  c,  -s,  0.0, 0.0 ),
+		 vec4(  s,   c,  0.0, 0.0 ),
+		 vec4( 0.0, 0.0, 1.0, 0.0 ),
+		 vec4( 0.0, 0.0, 0.0, 1.0 ) );
 }
 
 //----------------------------------------------------------------------------
@@ -641,44 +1235,51 @@ mat4 RotateZ( const GLfloat theta )
 //  Translation matrix generators
 //
 
-inline
+inline constexpr
 mat4 Translate( const GLfloat x, const GLfloat y, const GLfloat z )
 {
-    mat4 c;
-    c[0][3] = x;
-    c[1][3] = y;
-    c[2][3] = z;
-    return c;
+    return mat4( vec4( 1.0, 0.0, 0.0,  x  ),
+		 vec4( 0.0, 1.0, 0.0,  y  ),
+		 vec4( 0.0, 0.0, 1.0,  z  ),
+		 vec4( 0.0, 0.0, 0.0, 1.0 ) );
 }
 
-inline
+inline constexpr
 mat4 Translate( const vec3& v )
 {
     return Translate( v.x, v.y, v.z );
 }
 
-inline
+inline constexpr
 mat4 Translate( const vec4& v )
 {
     return Translate( v.x, v.y, v.z );
 }
 
+#ifdef ANGEL_EXPRESSION_TEMPLATES
+template< class E, class V = typename VecValue<E>::type >
+inline
+mat4 Translate( const E& e )
+{
+    return Translate( V( e ) );
+}
+#endif // ANGEL_EXPRESSION_TEMPLATES
+
 //----------------------------------------------------------------------------
 //
 //  Scale matrix generators
 //
 
-inline
+inline constexpr
 mat4 Scale( const GLfloat x, const GLfloat y, const GLfloat z )
 {
-    mat4 c;
-    c[0][0] = x;
-    c[1][1] = y;
-    c[2][2] = z;
-    return c;
+    return mat4( vec4(  x,  0.0, 0.0, 0.0 ),
+		 vec4( 0.0,  y,  0.0, 0.0 ),
+		 vec4( 0.0, 0.0,  z,  0.0 ),
+		 vec4( 0.0, 0.0, 0.0, 1.0 ) );
 }
 
-inline
+inline constexpr
 mat4 Scale( const vec3& v )
 {
     return Scale( v.x, v.y, v.z );
@@ -695,60 +1296,47 @@ mat4 Scale( const vec3& v )
 
 
 
-inline
+inline constexpr
 mat4 Ortho( const GLfloat left, const GLfloat right,
 	    const GLfloat bottom, const GLfloat top,
 	    const GLfloat zNear, const GLfloat zFar )
 {
-    mat4 c;
-    c[0][0] = 2.0/(right - left);
-    c[1][1] = 2.0/(top - bottom);
-    c[2][2] = 2.0/(zNear - zFar);
-    c[3][3] = 1.0;
-    c[0][3] = -(right + left)/(right - left);
-    c[1][3] = -(top + bottom)/(top - bottom);
-    c[2][3] = -(zFar + zNear)/(zFar - zNear);
-    return c;
+    return mat4( vec4( 2.0/(right - left), 0.0, 0.0, -(right + left)/(right - left) ),
+		 vec4( 0.0, 2.0/(top - bottom), 0.0, -(top + bottom)/(top - bottom) ),
+		 vec4( 0.0, 0.0, 2.0/(zNear - zFar), -(zFar + zNear)/(zFar - zNear) ),
+		 vec4( 0.0, 0.0, 0.0, 1.0 ) );
 }
 
-inline
+inline constexpr
 mat4 Ortho2D( const GLfloat left, const GLfloat right,
 	      const GLfloat bottom, const GLfloat top )
 {
     return Ortho( left, right, bottom, top, -1.0, 1.0 );
 }
 
-inline
+inline constexpr
 mat4 Frustum( const GLfloat left, const GLfloat right,
 	      const GLfloat bottom, const GLfloat top,
 	      const GLfloat zNear, const GLfloat zFar )
 {
-    mat4 c;
-    c[0][0] = 2.0*zNear/(right - left);
-    c[0][2] = (right + left)/(right - left);
-    c[1][1] = 2.0*zNear/(top - bottom);
-    c[1][2] = (top + bottom)/(top - bottom);
-    c[2][2] = -(zFar + zNear)/(zFar - zNear);
-    c[2][3] = -2.0*zFar*zNear/(zFar - zNear);
-    c[3][2] = -1.0;
-	c[3][3] = 0.0;
-    return c;
+    return mat4( vec4( 2.0*zNear/(right - left), 0.0, (right + left)/(right - left), 0.0 ),
+		 vec4( 0.0, 2.0*zNear/(top - bottom), (top + bottom)/(top - bottom), 0.0 ),
+		 vec4( 0.0, 0.0, -(zFar + zNear)/(zFar - zNear), -2.0*zFar*zNear/(zFar - zNear) ),
+		 vec4( 0.0, 0.0, -1.0, 0.0 ) );
 }
 
-inline 
+inline constexpr
 mat4 Perspective( const GLfloat fovy, const GLfloat aspect,
 		  const GLfloat zNear, const GLfloat zFar)
 {
-    GLfloat top   = tan(fovy*DegreesToRadians/2) * zNear;
+    GLfloat top   = ANGEL_RUNTIME() ? tan(fovy*DegreesToRadians/2) * zNear
+				    : tanConstexpr(fovy*DegreesToRadians/2) * zNear;
     GLfloat right = top * aspect;
 
-    mat4 c(0.0);
-    c[0][0] = zNear/right;
-    c[1][1] = zNear/top;
-    c[2][2] = -(zFar + zNear)/(zFar - zNear);
-    c[2][3] = -2.0*zFar*zNear/(zFar - zNear);
-    c[3][2] = -1.0;
-    return c;
+    return mat4( vec4( zNear/right, 0.0, 0.0, 0.0 ),
+		 vec4( 0.0, zNear/top, 0.0, 0.0 ),
+		 vec4( 0.0, 0.0, -(zFar + zNear)/(zFar - zNear), -2.0*zFar*zNear/(zFar - zNear) ),
+		 vec4( 0.0, 0.0, -1.0, 0.0 ) );
 }
 
 //----------------------------------------------------------------------------
@@ -804,6 +1392,19 @@ mat4 identity()
 }
 
 
+//----------------------------------------------------------------------------
+//
+//  The types copy as plain memory
+//
+
+static_assert( std::is_trivially_copyable<vec4>::value && std::is_standard_layout<vec4>::value,
+	       "vec4 must be trivially copyable" );
+static_assert( std::is_trivially_copyable<mat4>::value && std::is_standard_layout<mat4>::value,
+	       "mat4 must be trivially copyable" );
+static_assert( std::is_trivially_copyable<vec2>::value && std::is_trivially_copyable<vec3>::value &&
+	       std::is_trivially_copyable<mat2>::value && std::is_trivially_copyable<mat3>::value,
+	       "vectors and matrices must be trivially copyable" );
+
 }  // namespace Angel
 
 #endif // __ANGEL_MAT_H__
@@ -0,0 +1,404 @@
+#include "occlusion.h"
+#include "timer.h"
+#include "profiler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE
+#include <emmintrin.h>
+#endif
+
+#include "alloctrack.h"
+
+// add the twelve triangles of a box
+void OccluderMesh::addBox(const vec3& boxMin, const vec3& boxMax)
+{
+	int base = (int)vertices.size();
+	for(int i = 0; i < 8; i++)
+	{
+		vertices.push_back(vec3(i & 1 ? boxMax.x : boxMin.x, i & 2 ? boxMax.y : boxMin.y, i & 4 ? boxMax.z : boxMin.z));
+	}
+
+	static const int boxIndices[36] = {0,2,1, 1,2,3, 4,5,6, 5,7,6, 0,1,4, 1,5,4, 2,6,3, 3,6,7, 0,4,2, 2,4,6, 1,3,5, 3,7,5};
+	for(int i = 0; i < 36; i++)
+	{
+		indices.push_back(base + boxIndices[i]);
+	}
+}
+
+// add a triangle list as it is
+void OccluderMesh::addTriangles(const vec3* triangleVertices, int nVertices)
+{
+	int base = (int)vertices.size();
+	for(int i = 0; i < nVertices; i++)
+	{
+		vertices.push_back(triangleVertices[i]);
+		indices.push_back(base + i);
+	}
+}
+
+OcclusionCuller::OcclusionCuller(int nThreads) : frameStart(0), generation(0), pending(0), quit(false)
+{
+	// allocate the pyramid levels
+	for(int i = 0; i < occlusionLevels; i++)
+	{
+		int w = occlusionWidth >> i, h = occlusionHeight >> i;
+		levels[i] = new float[(w > 0 ? w : 1) * (h > 0 ? h : 1)];
+	}
+
+	stats.occluderTriangles = stats.tested = stats.culled = 0;
+	stats.rasterTime = stats.testTime = 0;
+	triangles.reserve(occlusionTriangles);
+
+	// the calling thread takes the first band, the workers the others
+	if(nThreads <= 0)
+	{
+		nThreads = (int)std::thread::hardware_concurrency();
+		if(nThreads > 8) nThreads = 8;
+		if(nThreads < 1) nThreads = 1;
+	}
+	for(int i = 1; i < nThreads; i++)
+	{
+		workers.push_back(std::thread(&OcclusionCuller::workerLoop, this, i));
+	}
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	// stop the workers
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	startCondition.notify_all();
+	for(int i = 0; i < (int)workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+	for(int i = 0; i < occlusionLevels; i++)
+	{
+		delete [] levels[i];
+	}
+}
+
+// start a new frame seen through the given matrix
+void OcclusionCuller::beginFrame(const mat4& viewProjMatrix)
+{
+	frameStart = currentTime();
+	this->viewProjMatrix = viewProjMatrix;
+	triangles.clear();
+	stats.occluderTriangles = stats.tested = stats.culled = 0;
+	stats.testTime = 0;
+}
+
+// transform the occluder into clip space and collect its triangles
+void OcclusionCuller::addOccluder(const OccluderMesh* mesh, const Transform& transform)
+{
+	mat4 m = viewProjMatrix * transform;
+	for(int i = 0; i + 2 < (int)mesh->indices.size(); i += 3)
+	{
+		vec4 clip[3];
+		for(int j = 0; j < 3; j++)
+		{
+			clip[j] = m * vec4(mesh->vertices[mesh->indices[i + j]], 1);
+		}
+		addTriangle(clip);
+	}
+}
+
+// clip the triangle by the near plane and store it in screen space
+void OcclusionCuller::addTriangle(const vec4* clip)
+{
+	// Sutherland-Hodgman against z > -w gives at most four corners
+	vec4 polygon[4];
+	int n = 0;
+	for(int i = 0; i < 3; i++)
+	{
+		const vec4& a = clip[i];
+		const vec4& b = clip[(i + 1) % 3];
+		float da = a.z + a.w;
+		float db = b.z + b.w;
+		if(da >= 0) polygon[n++] = a;
+		if((da >= 0) != (db >= 0)) polygon[n++] = a + (b - a) * (da / (da - db));
+	}
+	if(n < 3) return;
+
+	// project the corners onto the depth buffer
+	float x[4], y[4], z[4];
+	for(int i = 0; i < n; i++)
+	{
+		float w = polygon[i].w > 1e-6f ? polygon[i].w : 1e-6f;
+		x[i] = (polygon[i].x / w * 0.5f + 0.5f) * occlusionWidth;
+		y[i] = (polygon[i].y / w * 0.5f + 0.5f) * occlusionHeight;
+		z[i] = polygon[i].z / w * 0.5f + 0.5f;
+	}
+
+	// split into a fan of screen triangles
+	for(int i = 1; i + 1 < n; i++)
+	{
+		ScreenTriangle t;
+		int k[3] = {0, i, i + 1};
+		float ymin = occlusionHeight, ymax = 0, xmin = occlusionWidth, xmax = 0;
+		for(int j = 0; j < 3; j++)
+		{
+			t.x[j] = x[k[j]];
+			t.y[j] = y[k[j]];
+			t.z[j] = z[k[j]];
+			ymin = t.y[j] < ymin ? t.y[j] : ymin;
+			ymax = t.y[j] > ymax ? t.y[j] : ymax;
+			xmin = t.x[j] < xmin ? t.x[j] : xmin;
+			xmax = t.x[j] > xmax ? t.x[j] : xmax;
+		}
+
+		// skip triangles off the screen
+		if(xmax < 0 || xmin > occlusionWidth || ymax < 0 || ymin > occlusionHeight) continue;
+
+		t.ymin = ymin < 0 ? 0 : (int)ymin;
+		t.ymax = ymax > occlusionHeight - 1 ? occlusionHeight - 1 : (int)ymax;
+		triangles.push_back(t);
+	}
+}
+
+// rasterize the collected occluders and build the pyramid
+void OcclusionCuller::endOccluders()
+{
+	stats.occluderTriangles = (int)triangles.size();
+	int nBands = (int)workers.size() + 1;
+
+	// wake the workers up for the other bands
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending = nBands - 1;
+		generation++;
+	}
+	startCondition.notify_all();
+
+	rasterizeBand(0, nBands);
+
+	// wait for the other bands
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while(pending > 0) doneCondition.wait(lock);
+	}
+
+	buildPyramid();
+	stats.rasterTime = currentTime() - frameStart;
+}
+
+// worker thread waiting for frames
+void OcclusionCuller::workerLoop(int band)
+{
+	PROFILE_THREAD("occlusion worker");
+	ALLOC_SCOPE("occlusion");
+	int seen = 0;
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while(!quit && generation == seen) startCondition.wait(lock);
+			if(quit) return;
+			seen = generation;
+		}
+
+		rasterizeBand(band, (int)workers.size() + 1);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending--;
+		}
+		doneCondition.notify_one();
+	}
+}
+
+// clear and rasterize one horizontal band of the depth buffer
+void OcclusionCuller::rasterizeBand(int band, int nBands)
+{
+	PROFILE_ZONE("rasterize band");
+	int y0 = occlusionHeight * band / nBands;
+	int y1 = occlusionHeight * (band + 1) / nBands;
+	float* depth = levels[0];
+
+	for(int i = y0 * occlusionWidth; i < y1 * occlusionWidth; i++)
+	{
+		depth[i] = 1;
+	}
+
+	for(int i = 0; i < (int)triangles.size(); i++)
+	{
+		const ScreenTriangle& t = triangles[i];
+		if(t.ymax < y0 || t.ymin >= y1) continue;
+
+		// edge functions e(x, y) = a * x + b * y + c, positive inside for either winding
+		float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+		if(area == 0) continue;
+		float sign = area > 0 ? 1.0f : -1.0f;
+		float a[3], b[3], c[3];
+		for(int j = 0; j < 3; j++)
+		{
+			int k = (j + 1) % 3;
+			a[j] = (t.y[j] - t.y[k]) * sign;
+			b[j] = (t.x[k] - t.x[j]) * sign;
+			c[j] = (t.x[j] * t.y[k] - t.x[k] * t.y[j]) * sign;
+		}
+
+		// depth plane z(x, y) = dzdx * x + dzdy * y + z0
+		float dzdx = ((t.z[1] - t.z[0]) * (t.y[2] - t.y[0]) - (t.z[2] - t.z[0]) * (t.y[1] - t.y[0])) / area;
+		float dzdy = ((t.x[1] - t.x[0]) * (t.z[2] - t.z[0]) - (t.x[2] - t.x[0]) * (t.z[1] - t.z[0])) / area;
+		float z0 = t.z[0] - dzdx * t.x[0] - dzdy * t.y[0];
+
+		// pixel range of the triangle inside the band, x aligned to four pixels
+		float fxmin = t.x[0] < t.x[1] ? t.x[0] : t.x[1]; fxmin = t.x[2] < fxmin ? t.x[2] : fxmin;
+		float fxmax = t.x[0] > t.x[1] ? t.x[0] : t.x[1]; fxmax = t.x[2] > fxmax ? t.x[2] : fxmax;
+		int xmin = fxmin < 0 ? 0 : ((int)fxmin & ~3);
+		int xmax = fxmax > occlusionWidth - 1 ? occlusionWidth - 1 : (int)fxmax;
+		int ymin = t.ymin > y0 ? t.ymin : y0;
+		int ymax = t.ymax < y1 - 1 ? t.ymax : y1 - 1;
+
+		for(int y = ymin; y <= ymax; y++)
+		{
+			float py = y + 0.5f;
+			float* row = depth + y * occlusionWidth;
+
+#ifdef OCCLUSION_SSE
+			__m128 e0 = _mm_set1_ps(b[0] * py + c[0]), a0 = _mm_set1_ps(a[0]);
+			__m128 e1 = _mm_set1_ps(b[1] * py + c[1]), a1 = _mm_set1_ps(a[1]);
+			__m128 e2 = _mm_set1_ps(b[2] * py + c[2]), a2 = _mm_set1_ps(a[2]);
+			__m128 zr = _mm_set1_ps(dzdy * py + z0), zx = _mm_set1_ps(dzdx);
+			__m128 zero = _mm_setzero_ps();
+			for(int x = xmin; x <= xmax; x += 4)
+			{
+				// four pixel centers at once
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+				__m128 w0 = _mm_add_ps(_mm_mul_ps(a0, px), e0);
+				__m128 w1 = _mm_add_ps(_mm_mul_ps(a1, px), e1);
+				__m128 w2 = _mm_add_ps(_mm_mul_ps(a2, px), e2);
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+				if(_mm_movemask_ps(inside) == 0) continue;
+
+				// keep the nearer depth of the covered pixels
+				__m128 z = _mm_add_ps(_mm_mul_ps(zx, px), zr);
+				__m128 old = _mm_loadu_ps(row + x);
+				__m128 nearer = _mm_min_ps(old, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+			}
+#else
+			for(int x = xmin; x <= xmax; x++)
+			{
+				float px = x + 0.5f;
+				if(a[0] * px + b[0] * py + c[0] < 0) continue;
+				if(a[1] * px + b[1] * py + c[1] < 0) continue;
+				if(a[2] * px + b[2] * py + c[2] < 0) continue;
+
+				// keep the nearer depth
+				float z = dzdx * px + dzdy * py + z0;
+				if(z < row[x]) row[x] = z;
+			}
+#endif
+		}
+	}
+}
+
+// build the pyramid keeping the farthest depth of every 2x2 block
+void OcclusionCuller::buildPyramid()
+{
+	for(int i = 1; i < occlusionLevels; i++)
+	{
+		int w = occlusionWidth >> i, h = occlusionHeight >> i;
+		int pw = occlusionWidth >> (i - 1);
+		const float* src = levels[i - 1];
+		float* dst = levels[i];
+		for(int y = 0; y < h; y++)
+		{
+			for(int x = 0; x < w; x++)
+			{
+				const float* s = src + 2 * y * pw + 2 * x;
+				float z0 = s[0] > s[1] ? s[0] : s[1];
+				float z1 = s[pw] > s[pw + 1] ? s[pw] : s[pw + 1];
+				dst[y * w + x] = z0 > z1 ? z0 : z1;
+			}
+		}
+	}
+}
+
+// test the bounding box in object coordinates against the pyramid
+bool OcclusionCuller::isVisible(const vec3& boundsMin, const vec3& boundsMax, const Transform& transform)
+{
+	double start = currentTime();
+	stats.tested++;
+	bool visible = false;
+
+	// project the box corners in one batch
+	mat4 m = viewProjMatrix * transform;
+	GLfloat cx[8], cy[8], cz[8], px[8], py[8], pz[8], pw[8];
+	for(int i = 0; i < 8; i++)
+	{
+		cx[i] = i & 1 ? boundsMax.x : boundsMin.x;
+		cy[i] = i & 2 ? boundsMax.y : boundsMin.y;
+		cz[i] = i & 4 ? boundsMax.z : boundsMin.z;
+	}
+	vec3SoA corners = {cx, cy, cz};
+	vec4SoA projected = {px, py, pz, pw};
+	transformPoints(m, corners, projected, 8);
+
+	// find the screen rectangle and the nearest depth
+	float xmin = 1e30f, ymin = 1e30f, xmax = -1e30f, ymax = -1e30f, zmin = 1;
+	for(int i = 0; i < 8 && !visible; i++)
+	{
+		vec4 p(px[i], py[i], pz[i], pw[i]);
+
+		// a box crossing the near plane is always visible
+		if(p.z < -p.w || p.w <= 1e-6f)
+		{
+			visible = true;
+			break;
+		}
+
+		float x = (p.x / p.w * 0.5f + 0.5f) * occlusionWidth;
+		float y = (p.y / p.w * 0.5f + 0.5f) * occlusionHeight;
+		float z = p.z / p.w * 0.5f + 0.5f;
+		xmin = x < xmin ? x : xmin; xmax = x > xmax ? x : xmax;
+		ymin = y < ymin ? y : ymin; ymax = y > ymax ? y : ymax;
+		zmin = z < zmin ? z : zmin;
+	}
+
+	if(!visible)
+	{
+		// clamp the rectangle to the screen, boxes off the screen are left to the frustum
+		int x0 = xmin < 0 ? 0 : (int)xmin;
+		int y0 = ymin < 0 ? 0 : (int)ymin;
+		int x1 = xmax > occlusionWidth - 1 ? occlusionWidth - 1 : (int)xmax;
+		int y1 = ymax > occlusionHeight - 1 ? occlusionHeight - 1 : (int)ymax;
+		if(x1 < x0 || y1 < y0)
+		{
+			visible = true;
+		}
+		else
+		{
+			// pick the level where the rectangle covers a few texels only
+			int level = 0;
+			while(level < occlusionLevels - 1 && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+			{
+				level++;
+			}
+
+			// visible if any texel is farther than the box
+			int w = occlusionWidth >> level;
+			const float* depth = levels[level];
+			for(int y = y0 >> level; y <= (y1 >> level) && !visible; y++)
+			{
+				for(int x = x0 >> level; x <= (x1 >> level); x++)
+				{
+					if(zmin <= depth[y * w + x])
+					{
+						visible = true;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	if(!visible) stats.culled++;
+	stats.testTime += currentTime() - start;
+	return visible;
+}
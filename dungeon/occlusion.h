@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- occlusion.h ---
+//
+//   Software occlusion culling: simplified occluder meshes are rasterized
+//   on the CPU into a small depth buffer, a hierarchical-Z pyramid is built
+//   from it and object bounding boxes are tested against the pyramid.
+//   No OpenGL calls are made, so it runs without a window.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __OCCLUSION_H__
+#define __OCCLUSION_H__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Angel.h"
+#include "transform.h"
+
+const int occlusionWidth = 256;      // depth buffer width in pixels (multiple of 4)
+const int occlusionHeight = 128;     // depth buffer height in pixels
+const int occlusionLevels = 8;       // number of hierarchical-Z levels
+const int occlusionTriangles = 4096; // screen triangles reserved so the frames do not allocate
+
+// simplified triangle mesh used for occlusion only
+struct OccluderMesh
+{
+	std::vector<vec3> vertices; // vertex positions in object coordinates
+	std::vector<int> indices;   // three vertex indices per triangle
+
+	void addBox(const vec3& boxMin, const vec3& boxMax);
+	void addTriangles(const vec3* triangleVertices, int nVertices);
+};
+
+// occlusion statistics of the last frame
+struct OcclusionStats
+{
+	int occluderTriangles; // triangles rasterized
+	int tested;            // bounding boxes tested
+	int culled;            // bounding boxes found occluded
+	double rasterTime;     // rasterization and pyramid build time in milliseconds
+	double testTime;       // bounding box test time in milliseconds
+};
+
+// CPU depth buffer with a hierarchical-Z pyramid
+class OcclusionCuller
+{
+public:
+	OcclusionStats stats; // statistics of the last frame
+
+	OcclusionCuller(int nThreads = 0);
+	~OcclusionCuller();
+
+	void beginFrame(const mat4& viewProjMatrix);
+	void addOccluder(const OccluderMesh* mesh, const Transform& transform);
+	void endOccluders();
+	bool isVisible(const vec3& boundsMin, const vec3& boundsMax, const Transform& transform);
+
+	const float* depthBuffer() const { return levels[0]; }
+
+private:
+	// occluder triangle in screen space
+	struct ScreenTriangle
+	{
+		float x[3], y[3], z[3];
+		int ymin, ymax;
+	};
+
+	mat4 viewProjMatrix;
+	std::vector<ScreenTriangle> triangles;
+	float* levels[occlusionLevels]; // depth pyramid, level 0 is the depth buffer
+	double frameStart;
+
+	// worker threads rasterizing horizontal bands
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable startCondition, doneCondition;
+	int generation, pending;
+	bool quit;
+
+	void addTriangle(const vec4* clip);
+	void rasterizeBand(int band, int nBands);
+	void workerLoop(int band);
+	void buildPyramid();
+};
+
+#endif // __OCCLUSION_H__
@@ -0,0 +1,118 @@
+#include "perfcounters.h"
+
+#if defined(ENABLE_PERF_COUNTERS) && defined(__linux__)
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <mutex>
+#include <map>
+#include <string>
+
+// totals of one phase
+struct PerfTotals
+{
+	int calls;
+	unsigned long long counts[nPerfCounters];
+	double time; // in milliseconds
+	long long triangles;
+};
+
+static std::mutex totalsMutex;
+static std::map<std::string, PerfTotals> totals;
+
+// counter group of the calling thread, -1 until opened, -2 if not available
+static thread_local int groupFd = -1;
+
+// open one counter of the group
+static int openCounter(unsigned type, unsigned long long config, int leader)
+{
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = leader < 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+// counters of the calling thread, opened at its first phase
+static bool openGroup()
+{
+	if(groupFd == -2) return false;
+	if(groupFd >= 0) return true;
+
+	static const unsigned long long configs[nPerfCounters] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+	int leader = openCounter(PERF_TYPE_HARDWARE, configs[0], -1);
+	for(int i = 1; i < nPerfCounters && leader >= 0; i++)
+	{
+		if(openCounter(PERF_TYPE_HARDWARE, configs[i], leader) < 0)
+		{
+			close(leader);
+			leader = -1;
+		}
+	}
+	if(leader < 0)
+	{
+		fprintf(stderr, "perf counters: not available (%s)\n", strerror(errno));
+		groupFd = -2;
+		return false;
+	}
+
+	ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	groupFd = leader;
+	return true;
+}
+
+// current values of the counters of the calling thread
+bool perfRead(unsigned long long values[nPerfCounters])
+{
+	if(!openGroup()) return false;
+
+	// number of counters followed by their values
+	unsigned long long data[1 + nPerfCounters];
+	if(read(groupFd, data, sizeof(data)) != (ssize_t)sizeof(data) || data[0] != nPerfCounters) return false;
+	memcpy(values, data + 1, sizeof(data) - sizeof(data[0]));
+	return true;
+}
+
+// add the counts of a phase to its totals
+void perfRecord(const char* name, const unsigned long long start[nPerfCounters], const unsigned long long end[nPerfCounters], double time, long long triangles)
+{
+	std::lock_guard<std::mutex> lock(totalsMutex);
+	PerfTotals& phase = totals[name];
+	phase.calls++;
+	for(int i = 0; i < nPerfCounters; i++)
+	{
+		phase.counts[i] += end[i] - start[i];
+	}
+	phase.time += time;
+	phase.triangles += triangles;
+}
+
+// print the totals of every phase
+void perfReport()
+{
+	std::lock_guard<std::mutex> lock(totalsMutex);
+	if(totals.empty()) return;
+
+	printf("%-20s %8s %10s %12s %6s %12s %12s %15s %15s\n", "phase", "calls", "time (ms)", "cycles", "IPC", "triangles", "cycles/tri", "cache miss/tri", "branch miss/tri");
+	for(std::map<std::string, PerfTotals>::iterator i = totals.begin(); i != totals.end(); ++i)
+	{
+		const PerfTotals& phase = i->second;
+		const unsigned long long* counts = phase.counts;
+		double ipc = counts[perfCycles] ? (double)counts[perfInstructions] / counts[perfCycles] : 0;
+		double triangles = phase.triangles > 0 ? (double)phase.triangles : 1;
+		printf("%-20s %8d %10.3f %12llu %6.2f %12lld %12.1f %15.3f %15.3f\n", i->first.c_str(), phase.calls, phase.time, counts[perfCycles], ipc, phase.triangles,
+			counts[perfCycles] / triangles, counts[perfCacheMisses] / triangles, counts[perfBranchMisses] / triangles);
+	}
+}
+
+#endif // ENABLE_PERF_COUNTERS
@@ -0,0 +1,76 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- perfcounters.h ---
+//
+//   Hardware performance counters around named phases.  PERF_PHASE("name",
+//   triangles) counts the cycles, instructions, cache misses and branch
+//   misses of the enclosing scope with perf_event_open; PERF_TRIANGLES(n)
+//   adds triangles handled later in the scope.  PERF_REPORT() prints the
+//   IPC and the misses per triangle of every phase.
+//
+//   Linux only, compiled out unless ENABLE_PERF_COUNTERS is defined
+//   (-DENABLE_PERF_COUNTERS).  Counting user space only works with
+//   kernel.perf_event_paranoid up to 2.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PERFCOUNTERS_H__
+#define __PERFCOUNTERS_H__
+
+#if defined(ENABLE_PERF_COUNTERS) && defined(__linux__)
+
+#include "timer.h"
+
+// counters read together
+enum PerfCounter
+{
+	perfCycles,
+	perfInstructions,
+	perfCacheMisses,
+	perfBranchMisses,
+	nPerfCounters
+};
+
+bool perfRead(unsigned long long values[nPerfCounters]);
+void perfRecord(const char* name, const unsigned long long start[nPerfCounters], const unsigned long long end[nPerfCounters], double time, long long triangles);
+void perfReport();
+
+// counts its scope
+class PerfPhase
+{
+public:
+	long long triangles; // triangles handled in the phase
+
+	PerfPhase(const char* name, long long triangles) : triangles(triangles), name(name)
+	{
+		valid = perfRead(start);
+		startTime = currentTime();
+	}
+
+	~PerfPhase()
+	{
+		unsigned long long end[nPerfCounters];
+		double time = currentTime() - startTime;
+		if(valid && perfRead(end)) perfRecord(name, start, end, time, triangles);
+	}
+
+private:
+	const char* name;
+	unsigned long long start[nPerfCounters];
+	double startTime;
+	bool valid;
+};
+
+#define PERF_PHASE(name, triangles) PerfPhase perfPhase(name, triangles)
+#define PERF_TRIANGLES(n) (perfPhase.triangles += (n))
+#define PERF_REPORT() perfReport()
+
+#else
+
+#define PERF_PHASE(name, triangles)
+#define PERF_TRIANGLES(n)
+#define PERF_REPORT()
+
+#endif // ENABLE_PERF_COUNTERS
+
+#endif // __PERFCOUNTERS_H__
@@ -0,0 +1,241 @@
+#include "portal.h"
+
+// add an object shown when the cell is reached, hidden until then
+void Cell::addObject(Object* object)
+{
+	object->visible = false;
+	objects.push_back(object);
+}
+
+// remove an object from the cell, it stays as it is
+void Cell::removeObject(Object* object)
+{
+	for(int i = 0; i < (int)objects.size(); i++)
+	{
+		if(objects[i] == object)
+		{
+			objects.erase(objects.begin() + i);
+			return;
+		}
+	}
+}
+
+// test if the point is inside the cell extent
+bool Cell::contains(const vec3& point) const
+{
+	return point.x >= boundsMin.x && point.x <= boundsMax.x &&
+		point.y >= boundsMin.y && point.y <= boundsMax.y &&
+		point.z >= boundsMin.z && point.z <= boundsMax.z;
+}
+
+CellGraph::~CellGraph()
+{
+	for(int i = 0; i < (int)cells.size(); i++)
+	{
+		delete cells[i];
+	}
+}
+
+// create a new cell
+Cell* CellGraph::addCell(const char* name, const vec3& boundsMin, const vec3& boundsMax)
+{
+	Cell* cell = new Cell(name, boundsMin, boundsMax);
+	cells.push_back(cell);
+	return cell;
+}
+
+// create a portal from one cell to another
+void CellGraph::addPortal(Cell* from, Cell* to, const vec3* vertices, int nVertices, bool open)
+{
+	Portal portal;
+	portal.nVertices = nVertices < maxPortalVertices ? nVertices : maxPortalVertices;
+	for(int i = 0; i < portal.nVertices; i++)
+	{
+		portal.vertices[i] = vertices[i];
+	}
+	portal.normal = normalize(cross(vertices[1] - vertices[0], vertices[2] - vertices[0]));
+	portal.target = to;
+	portal.open = open;
+	from->portals.push_back(portal);
+}
+
+// create portals on the four vertical sides of a box, crossed inwards or outwards
+void CellGraph::addBoxPortals(Cell* from, Cell* to, const vec3& boxMin, const vec3& boxMax, bool inwards, bool open)
+{
+	// box corners on the ground level counter-clockwise seen from above
+	vec3 corners[4] = {vec3(boxMin.x, 0, boxMin.z), vec3(boxMin.x, 0, boxMax.z), vec3(boxMax.x, 0, boxMax.z), vec3(boxMax.x, 0, boxMin.z)};
+
+	for(int i = 0; i < 4; i++)
+	{
+		vec3 a = corners[i], b = corners[(i + 1) % 4];
+		vec3 side[4] = {vec3(a.x, boxMin.y, a.z), vec3(b.x, boxMin.y, b.z), vec3(b.x, boxMax.y, b.z), vec3(a.x, boxMax.y, a.z)};
+
+		// this winding faces out of the box, reverse it for portals seen from inside
+		if(!inwards)
+		{
+			vec3 t = side[1]; side[1] = side[3]; side[3] = t;
+		}
+		addPortal(from, to, side, 4, open);
+	}
+}
+
+// find the smallest cell containing the point
+Cell* CellGraph::locate(const vec3& point) const
+{
+	Cell* best = NULL;
+	float bestVolume = 0;
+	for(int i = 0; i < (int)cells.size(); i++)
+	{
+		if(!cells[i]->contains(point)) continue;
+
+		vec3 size = cells[i]->boundsMax - cells[i]->boundsMin;
+		float volume = size.x * size.y * size.z;
+		if(!best || volume < bestVolume)
+		{
+			best = cells[i];
+			bestVolume = volume;
+		}
+	}
+	return best;
+}
+
+// test if the segment crosses the portal from its front to its back side
+static bool crossesPortal(const Portal& portal, const vec3& from, const vec3& to)
+{
+	float d0 = dot(portal.normal, from - portal.vertices[0]);
+	float d1 = dot(portal.normal, to - portal.vertices[0]);
+	if(d0 < 0 || d1 >= 0) return false;
+
+	// intersection point with the portal plane
+	vec3 p = from + (to - from) * (d0 / (d0 - d1));
+
+	// the point must be inside the convex polygon
+	for(int i = 0; i < portal.nVertices; i++)
+	{
+		vec3 a = portal.vertices[i];
+		vec3 b = portal.vertices[(i + 1) % portal.nVertices];
+		if(dot(cross(b - a, p - a), portal.normal) < 0) return false;
+	}
+	return true;
+}
+
+// follow the camera through the portals it crossed when moving
+void CellGraph::moveCamera(const vec3& from, const vec3& to)
+{
+	if(!cameraCell)
+	{
+		cameraCell = locate(to);
+		return;
+	}
+
+	for(int i = 0; i < (int)cameraCell->portals.size(); i++)
+	{
+		if(crossesPortal(cameraCell->portals[i], from, to))
+		{
+			cameraCell = cameraCell->portals[i].target;
+			return;
+		}
+	}
+}
+
+// compute the cells visible from the camera and show their objects only
+void CellGraph::update(const vec3& eye, const mat4& viewProjMatrix)
+{
+	// hide the objects of the cells visible last time
+	for(int i = 0; i < (int)visibleCells.size(); i++)
+	{
+		Cell* cell = visibleCells[i];
+		for(int j = 0; j < (int)cell->objects.size(); j++)
+		{
+			cell->objects[j]->visible = false;
+		}
+	}
+
+	// flow the visibility from the camera cell over the whole screen
+	frame++;
+	portalsTested = 0;
+	visibleCells.clear();
+	if(cameraCell)
+	{
+		flow(cameraCell, eye, viewProjMatrix, PortalRect(), 0);
+	}
+
+	// show the objects of the reached cells
+	for(int i = 0; i < (int)visibleCells.size(); i++)
+	{
+		Cell* cell = visibleCells[i];
+		for(int j = 0; j < (int)cell->objects.size(); j++)
+		{
+			cell->objects[j]->visible = true;
+		}
+	}
+}
+
+// reach the cell and continue through its portals seen inside the screen rectangle
+void CellGraph::flow(Cell* cell, const vec3& eye, const mat4& viewProjMatrix, const PortalRect& rect, int depth)
+{
+	if(cell->visitFrame != frame)
+	{
+		cell->visitFrame = frame;
+		cell->rect = rect;
+		visibleCells.push_back(cell);
+	}
+	else cell->rect.merge(rect);
+
+	if(depth >= maxPortalDepth) return;
+
+	// a cell is not entered again from the cells seen through it, the back portals would loop
+	cell->flowing = true;
+	for(int i = 0; i < (int)cell->portals.size(); i++)
+	{
+		const Portal& portal = cell->portals[i];
+		if(!portal.open || portal.target->flowing) continue;
+
+		// the portal must face the eye
+		if(dot(portal.normal, eye - portal.vertices[0]) <= 0) continue;
+		portalsTested++;
+
+		// portal corners in clip space
+		vec4 clip[maxPortalVertices];
+		for(int j = 0; j < portal.nVertices; j++)
+		{
+			clip[j] = viewProjMatrix * vec4(portal.vertices[j], 1);
+		}
+
+		// clip the polygon by the near plane (z > -w) and project it onto the screen
+		PortalRect portalRect;
+		portalRect.xmin = portalRect.ymin = 1;
+		portalRect.xmax = portalRect.ymax = -1;
+		for(int j = 0; j < portal.nVertices; j++)
+		{
+			vec4 a = clip[j];
+			vec4 b = clip[(j + 1) % portal.nVertices];
+			float da = a.z + a.w;
+			float db = b.z + b.w;
+
+			// collect the inside corner and the intersection with the near plane
+			vec4 points[2];
+			int nPoints = 0;
+			if(da >= 0) points[nPoints++] = a;
+			if((da >= 0) != (db >= 0)) points[nPoints++] = a + (b - a) * (da / (da - db));
+
+			for(int k = 0; k < nPoints; k++)
+			{
+				float w = points[k].w > 1e-6f ? points[k].w : 1e-6f;
+				float x = points[k].x / w;
+				float y = points[k].y / w;
+				if(x < portalRect.xmin) portalRect.xmin = x;
+				if(x > portalRect.xmax) portalRect.xmax = x;
+				if(y < portalRect.ymin) portalRect.ymin = y;
+				if(y > portalRect.ymax) portalRect.ymax = y;
+			}
+		}
+
+		// narrow the rectangle to the portal and continue if anything is left
+		portalRect.narrow(rect);
+		if(portalRect.empty()) continue;
+
+		flow(portal.target, eye, viewProjMatrix, portalRect, depth + 1);
+	}
+	cell->flowing = false;
+}
@@ -0,0 +1,124 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- portal.h ---
+//
+//   Cell and portal visibility: every space of the dungeon is a cell,
+//   doorways between cells are portal polygons.  The camera cell is
+//   tracked by following portal crossings and each frame visibility
+//   flows from it through the portals that survive frustum clipping.
+//   A cell reached through portals keeps the screen rectangle it was
+//   seen through, its objects are drawn clipped to it.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PORTAL_H__
+#define __PORTAL_H__
+
+#include <vector>
+#include "Angel.h"
+#include "scene.h"
+
+class Cell;
+
+const int maxPortalVertices = 8; // maximal number of portal polygon corners
+const int maxPortalDepth = 32;   // maximal number of portals visibility flows through
+
+// screen rectangle in normalized device coordinates
+struct PortalRect
+{
+	float xmin, ymin, xmax, ymax;
+
+	PortalRect() : xmin(-1), ymin(-1), xmax(1), ymax(1)
+	{
+	}
+
+	bool empty() const
+	{
+		return xmin >= xmax || ymin >= ymax;
+	}
+
+	// the rectangle covers the whole screen
+	bool full() const
+	{
+		return xmin <= -1 && ymin <= -1 && xmax >= 1 && ymax >= 1;
+	}
+
+	// grow the rectangle to contain another one
+	void merge(const PortalRect& r)
+	{
+		if(r.xmin < xmin) xmin = r.xmin;
+		if(r.ymin < ymin) ymin = r.ymin;
+		if(r.xmax > xmax) xmax = r.xmax;
+		if(r.ymax > ymax) ymax = r.ymax;
+	}
+
+	// shrink the rectangle to its intersection with another one
+	void narrow(const PortalRect& r)
+	{
+		if(r.xmin > xmin) xmin = r.xmin;
+		if(r.ymin > ymin) ymin = r.ymin;
+		if(r.xmax < xmax) xmax = r.xmax;
+		if(r.ymax < ymax) ymax = r.ymax;
+	}
+};
+
+// doorway from one cell to another
+struct Portal
+{
+	vec3 vertices[maxPortalVertices]; // polygon corners, counter-clockwise seen from the source cell
+	int nVertices;                    // actual number of corners
+	vec3 normal;                      // polygon normal pointing into the source cell
+	Cell* target;                     // cell on the other side of the portal
+	bool open;                        // visibility flows through open portals only
+};
+
+// convex space of the dungeon
+class Cell
+{
+public:
+	const char* name;             // cell name for debugging
+	vec3 boundsMin, boundsMax;    // cell extent used to locate a point
+	std::vector<Portal> portals;  // doorways leading out of the cell
+	std::vector<Object*> objects; // objects shown when the cell is reached
+	int visitFrame;               // last frame the cell was reached
+	PortalRect rect;              // screen rectangle the cell was seen through in that frame
+	bool flowing;                 // the visibility is flowing through the cell, it is not entered again
+
+	Cell(const char* name, const vec3& boundsMin, const vec3& boundsMax) : name(name), boundsMin(boundsMin), boundsMax(boundsMax), visitFrame(-1), flowing(false)
+	{
+	}
+
+	void addObject(Object* object);
+	void removeObject(Object* object);
+	bool contains(const vec3& point) const;
+};
+
+// all cells of the dungeon and the set visible from the camera
+class CellGraph
+{
+public:
+	std::vector<Cell*> cells;        // all cells
+	std::vector<Cell*> visibleCells; // cells reached in the last update
+	Cell* cameraCell;                // cell the camera is in
+	int frame;                       // update counter
+	int portalsTested;               // portals tested in the last update
+
+	CellGraph() : cameraCell(NULL), frame(0), portalsTested(0)
+	{
+	}
+
+	~CellGraph();
+
+	Cell* addCell(const char* name, const vec3& boundsMin, const vec3& boundsMax);
+	void addPortal(Cell* from, Cell* to, const vec3* vertices, int nVertices, bool open);
+	void addBoxPortals(Cell* from, Cell* to, const vec3& boxMin, const vec3& boxMax, bool inwards, bool open);
+
+	Cell* locate(const vec3& point) const;
+	void moveCamera(const vec3& from, const vec3& to);
+	void update(const vec3& eye, const mat4& viewProjMatrix);
+
+private:
+	void flow(Cell* cell, const vec3& eye, const mat4& viewProjMatrix, const PortalRect& rect, int depth);
+};
+
+#endif // __PORTAL_H__
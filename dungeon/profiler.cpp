@@ -0,0 +1,164 @@
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+
+// one timed zone
+struct ProfileEvent
+{
+	const char* name;
+	double start, end; // in milliseconds
+};
+
+// zones of one thread, written by that thread only
+struct ProfileBuffer
+{
+	ProfileEvent events[profileBufferSize];
+	std::atomic<unsigned> count; // zones written, the last profileBufferSize are kept
+	int threadId;
+	char threadName[32];
+};
+
+static std::mutex buffersMutex;             // guards the buffer list, not the buffers
+static std::vector<ProfileBuffer*> buffers; // buffers of all threads
+static thread_local ProfileBuffer* threadBuffer = NULL;
+static ProfileBuffer* gpuBuffer = NULL;     // phases read back from the GPU timer queries
+
+// new buffer added to the list
+static ProfileBuffer* createBuffer()
+{
+	ProfileBuffer* buffer = new ProfileBuffer;
+	buffer->count.store(0);
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	buffer->threadId = (int)buffers.size();
+	sprintf(buffer->threadName, "thread %d", buffer->threadId);
+	buffers.push_back(buffer);
+	return buffer;
+}
+
+// buffer of the calling thread, created at its first zone
+static ProfileBuffer* getThreadBuffer()
+{
+	if(!threadBuffer) threadBuffer = createBuffer();
+	return threadBuffer;
+}
+
+// append a zone, the oldest one is overwritten when full
+static void record(ProfileBuffer* buffer, const char* name, double start, double end)
+{
+	unsigned index = buffer->count.load(std::memory_order_relaxed);
+	ProfileEvent& event = buffer->events[index & (profileBufferSize - 1)];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	buffer->count.store(index + 1, std::memory_order_release);
+}
+
+// store a zone of the calling thread
+void profilerRecord(const char* name, double start, double end)
+{
+	record(getThreadBuffer(), name, start, end);
+}
+
+// store a GPU phase, times already on the CPU clock; called from the render thread only
+void profilerRecordGpu(const char* name, double start, double end)
+{
+	if(!gpuBuffer)
+	{
+		gpuBuffer = createBuffer();
+		strcpy(gpuBuffer->threadName, "GPU");
+	}
+	record(gpuBuffer, name, start, end);
+}
+
+// name shown for the calling thread in the trace
+void profilerSetThreadName(const char* name)
+{
+	ProfileBuffer* buffer = getThreadBuffer();
+	strncpy(buffer->threadName, name, sizeof(buffer->threadName) - 1);
+	buffer->threadName[sizeof(buffer->threadName) - 1] = 0;
+}
+
+// value below which the given fraction of the sorted values lies
+static double percentile(const std::vector<double>& sorted, double fraction)
+{
+	size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+// write the trace of all threads and print the zone statistics
+void profilerExport(const char* filename)
+{
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	if(buffers.empty()) return;
+
+	// earliest zone as the time origin
+	double origin = 1e300;
+	for(size_t i = 0; i < buffers.size(); i++)
+	{
+		unsigned count = buffers[i]->count.load(std::memory_order_acquire);
+		unsigned first = count > (unsigned)profileBufferSize ? count - profileBufferSize : 0;
+		for(unsigned j = first; j < count; j++)
+		{
+			origin = std::min(origin, buffers[i]->events[j & (profileBufferSize - 1)].start);
+		}
+	}
+
+	// complete events in microseconds, one track per thread
+	std::map<std::string, std::vector<double> > durations;
+	FILE* file = fopen(filename, "w");
+	if(file) fprintf(file, "{\"traceEvents\":[\n");
+	bool firstEvent = true;
+	for(size_t i = 0; i < buffers.size(); i++)
+	{
+		ProfileBuffer* buffer = buffers[i];
+		if(file)
+		{
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				firstEvent ? "" : ",\n", buffer->threadId, buffer->threadName);
+			firstEvent = false;
+		}
+
+		unsigned count = buffer->count.load(std::memory_order_acquire);
+		unsigned first = count > (unsigned)profileBufferSize ? count - profileBufferSize : 0;
+		for(unsigned j = first; j < count; j++)
+		{
+			const ProfileEvent& event = buffer->events[j & (profileBufferSize - 1)];
+			durations[event.name].push_back(event.end - event.start);
+			if(file)
+			{
+				fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					event.name, buffer->threadId, (event.start - origin) * 1000, (event.end - event.start) * 1000);
+			}
+		}
+	}
+	if(file)
+	{
+		fprintf(file, "\n]}\n");
+		fclose(file);
+		printf("profiler: trace written to %s\n", filename);
+	}
+	else fprintf(stderr, "profiler: cannot write %s\n", filename);
+
+	// percentiles of each zone
+	printf("%-24s %8s %10s %10s %10s %10s %10s %10s\n", "zone (ms)", "count", "total", "mean", "p50", "p95", "p99", "max");
+	for(std::map<std::string, std::vector<double> >::iterator i = durations.begin(); i != durations.end(); ++i)
+	{
+		std::vector<double>& times = i->second;
+		std::sort(times.begin(), times.end());
+		double total = 0;
+		for(size_t j = 0; j < times.size(); j++) total += times[j];
+		printf("%-24s %8d %10.3f %10.4f %10.4f %10.4f %10.4f %10.4f\n", i->first.c_str(), (int)times.size(), total, total / times.size(),
+			percentile(times, 0.5), percentile(times, 0.95), percentile(times, 0.99), times.back());
+	}
+}
+
+#endif // ENABLE_PROFILER
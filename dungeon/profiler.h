@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- profiler.h ---
+//
+//   Scoped-zone CPU profiler.  PROFILE_ZONE("name") times the enclosing
+//   scope; each thread writes its zones into its own ring buffer without
+//   locks.  At exit the zones are exported as Chrome trace-event JSON
+//   (chrome://tracing, Perfetto) and summarized with percentiles.
+//   PROFILE_GPU adds a phase measured on the GPU, on a track of its own.
+//
+//   Compiled out unless ENABLE_PROFILER is defined (-DENABLE_PROFILER).
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#ifdef ENABLE_PROFILER
+
+#include "timer.h"
+
+const int profileBufferSize = 1 << 16; // zones kept per thread (power of two)
+
+void profilerRecord(const char* name, double start, double end);
+void profilerRecordGpu(const char* name, double start, double end);
+void profilerSetThreadName(const char* name);
+void profilerExport(const char* filename);
+
+// times its scope
+class ProfileZone
+{
+public:
+	ProfileZone(const char* name) : name(name), start(currentTime()) {}
+	~ProfileZone() { profilerRecord(name, start, currentTime()); }
+
+private:
+	const char* name;
+	double start;
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name) profilerSetThreadName(name)
+#define PROFILE_GPU(name, start, end) profilerRecordGpu(name, start, end)
+#define PROFILE_EXPORT(filename) profilerExport(filename)
+
+#else
+
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD(name)
+#define PROFILE_GPU(name, start, end)
+#define PROFILE_EXPORT(filename)
+
+#endif // ENABLE_PROFILER
+
+#endif // __PROFILER_H__
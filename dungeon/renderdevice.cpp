@@ -0,0 +1,691 @@
+#include <stdio.h>
+#include <string.h>
+#include "renderdevice.h"
+#include "hud.h"
+
+const char* renderCommandNames[nRenderCommands] =
+{
+	"create buffer", "delete buffer", "bind buffer", "buffer data", "buffer sub data",
+	"enable attribute", "attribute pointer", "bind vertex array",
+	"create texture", "active texture", "bind texture", "texture parameter", "texture image",
+	"create program", "use program", "attribute location", "uniform location", "uniform",
+	"enable", "disable", "hint", "viewport", "scissor", "clear color", "clear", "draw"
+};
+
+RenderCounters renderCounters; // counted by the devices, also linked without the overlay
+
+// count a call made to OpenGL, or recorded by the null device, in the counters of the frame
+static void countCall(int type)
+{
+	switch(type)
+	{
+	case commandUniform:
+		renderCounters.uniformChanges++;
+		break;
+	case commandDraw:
+		renderCounters.drawCalls++;
+		break;
+	case commandBindBuffer: case commandEnableAttribute: case commandAttributePointer: case commandBindVertexArray:
+	case commandActiveTexture: case commandBindTexture: case commandUseProgram:
+	case commandEnable: case commandDisable: case commandScissor: case commandClearColor:
+		renderCounters.stateChanges++;
+		break;
+	}
+}
+
+// OpenGL device
+
+// capabilities of the shadowed enables, the texture enables are per unit and pass through
+static const GLenum cachedCapabilities[stateCacheCapabilities] = {GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND};
+
+GLRenderDevice::GLRenderDevice() : caching(true), validating(false)
+{
+#ifdef DEBUG
+	validating = true;
+#endif // DEBUG
+	resetStats();
+	invalidate();
+}
+
+void GLRenderDevice::resetStats()
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+// forget the whole shadow, the next call of every kind goes to OpenGL
+void GLRenderDevice::invalidate()
+{
+	clearKnown = false;
+	invalidateEnables();
+	invalidateBindings();
+}
+
+// forget the buffers, the vertex array, the attributes, the textures and the program
+void GLRenderDevice::invalidateBindings()
+{
+	arrayBuffer = elementBuffer = vertexArray = program = activeUnit = stateUnknown;
+	for(int i = 0; i < stateCacheUnits; i++) textures[i] = stateUnknown;
+	invalidateAttributes();
+}
+
+// forget the depth test, the face culling and the blending
+void GLRenderDevice::invalidateEnables()
+{
+	for(int i = 0; i < stateCacheCapabilities; i++) enables[i] = stateUnknown;
+}
+
+// the attributes belong to the bound vertex array
+void GLRenderDevice::invalidateAttributes()
+{
+	for(int i = 0; i < stateCacheAttributes; i++)
+	{
+		attributes[i].enabled = stateUnknown;
+		attributes[i].buffer = stateUnknown;
+	}
+}
+
+// count the state call, true if it sets what is already set and is dropped
+bool GLRenderDevice::redundant(bool same, int& dropped)
+{
+	stats.calls++;
+	if(validating) validate();
+	if(!caching || !same) return false;
+	stats.filtered++;
+	dropped++;
+	return true;
+}
+
+// report a shadow value differing from OpenGL, the unknown values are not checked
+void GLRenderDevice::check(const char* name, GLint value, GLuint shadow)
+{
+	if(shadow == stateUnknown || (GLuint)value == shadow) return;
+	fprintf(stderr, "state cache: %s is %d in OpenGL, %u in the shadow\n", name, value, shadow);
+	stats.mismatches++;
+}
+
+// compare the known shadow values with OpenGL, returns the number of mismatches
+int GLRenderDevice::validate()
+{
+	int mismatches = stats.mismatches;
+	GLint value;
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &value);
+	check("array buffer", value, arrayBuffer);
+	glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &value);
+	check("element buffer", value, elementBuffer);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &value);
+	check("vertex array", value, vertexArray);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &value);
+	check("program", value, program);
+
+	// the 2D texture of every unit, the active unit is restored
+	GLint unit;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &unit);
+	check("active texture", unit - GL_TEXTURE0, activeUnit);
+	for(int i = 0; i < stateCacheUnits; i++)
+	{
+		if(textures[i] == stateUnknown) continue;
+		glActiveTexture(GL_TEXTURE0 + i);
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &value);
+		check("2D texture", value, textures[i]);
+	}
+	glActiveTexture(unit);
+
+	// the attributes of the bound vertex array
+	for(int i = 0; i < stateCacheAttributes; i++)
+	{
+		const AttributeState& a = attributes[i];
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &value);
+		check("attribute enabled", value, a.enabled);
+		if(a.buffer == stateUnknown) continue;
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &value);
+		check("attribute buffer", value, a.buffer);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &value);
+		check("attribute size", value, a.size);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &value);
+		check("attribute type", value, a.type);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &value);
+		check("attribute normalized", value, a.normalized);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &value);
+		check("attribute stride", value, a.stride);
+		void* pointer;
+		glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+		check("attribute offset", (GLint)(size_t)pointer, (GLuint)a.offset);
+	}
+
+	for(int i = 0; i < stateCacheCapabilities; i++)
+	{
+		check("enable", glIsEnabled(cachedCapabilities[i]), enables[i]);
+	}
+
+	if(clearKnown)
+	{
+		GLfloat color[4];
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, color);
+		if(memcmp(color, clearValue, sizeof(color)))
+		{
+			fprintf(stderr, "state cache: clear color is %g %g %g %g in OpenGL, %g %g %g %g in the shadow\n",
+				color[0], color[1], color[2], color[3], clearValue[0], clearValue[1], clearValue[2], clearValue[3]);
+			stats.mismatches++;
+		}
+	}
+	return stats.mismatches - mismatches;
+}
+
+GLuint GLRenderDevice::createBuffer()
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	return buffer;
+}
+
+// a deleted buffer is unbound from the targets and the attributes
+void GLRenderDevice::deleteBuffer(GLuint buffer)
+{
+	glDeleteBuffers(1, &buffer);
+	if(arrayBuffer == buffer) arrayBuffer = 0;
+	if(elementBuffer == buffer) elementBuffer = 0;
+	for(int i = 0; i < stateCacheAttributes; i++)
+	{
+		if(attributes[i].buffer == buffer) attributes[i].buffer = stateUnknown;
+	}
+}
+
+// the array and element buffers are shadowed, the other targets pass through
+void GLRenderDevice::bindBuffer(GLenum target, GLuint buffer)
+{
+	GLuint* shadow = target == GL_ARRAY_BUFFER ? &arrayBuffer : target == GL_ELEMENT_ARRAY_BUFFER ? &elementBuffer : NULL;
+	if(redundant(shadow && *shadow == buffer, stats.buffers)) return;
+	glBindBuffer(target, buffer);
+	countCall(commandBindBuffer);
+	if(shadow) *shadow = buffer;
+}
+
+void GLRenderDevice::bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	glBufferData(target, size, data, usage);
+}
+
+void GLRenderDevice::bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	glBufferSubData(target, offset, size, data);
+}
+
+void GLRenderDevice::enableVertexAttribArray(GLuint index)
+{
+	bool cached = index < (GLuint)stateCacheAttributes;
+	if(redundant(cached && attributes[index].enabled == 1, stats.attributes)) return;
+	glEnableVertexAttribArray(index);
+	countCall(commandEnableAttribute);
+	if(cached) attributes[index].enabled = 1;
+}
+
+// the pointer is the same if the array buffer is too
+void GLRenderDevice::vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset)
+{
+	bool cached = index < (GLuint)stateCacheAttributes;
+	AttributeState* a = cached ? &attributes[index] : NULL;
+	bool same = a && a->buffer != stateUnknown && a->buffer == arrayBuffer && a->size == size && a->type == type &&
+		a->normalized == normalized && a->stride == stride && a->offset == offset;
+	if(redundant(same, stats.attributes)) return;
+	glVertexAttribPointer(index, size, type, normalized, stride, BUFFER_OFFSET(offset));
+	countCall(commandAttributePointer);
+	if(a)
+	{
+		a->buffer = arrayBuffer;
+		a->size = size;
+		a->type = type;
+		a->normalized = normalized;
+		a->stride = stride;
+		a->offset = offset;
+	}
+}
+
+// the element buffer and the attributes come with the vertex array
+void GLRenderDevice::bindVertexArray(GLuint array)
+{
+	if(redundant(vertexArray == array, stats.vertexArrays)) return;
+	glBindVertexArray(array);
+	countCall(commandBindVertexArray);
+	vertexArray = array;
+	elementBuffer = stateUnknown;
+	invalidateAttributes();
+}
+
+GLuint GLRenderDevice::createTexture()
+{
+	GLuint texture;
+	glGenTextures(1, &texture);
+	return texture;
+}
+
+void GLRenderDevice::activeTexture(GLenum unit)
+{
+	if(redundant(activeUnit == unit - GL_TEXTURE0, stats.textures)) return;
+	glActiveTexture(unit);
+	countCall(commandActiveTexture);
+	activeUnit = unit - GL_TEXTURE0;
+}
+
+// the 2D textures of the first units are shadowed, the other targets and units pass through
+void GLRenderDevice::bindTexture(GLenum target, GLuint texture)
+{
+	GLuint* shadow = target == GL_TEXTURE_2D && activeUnit < (GLuint)stateCacheUnits ? &textures[activeUnit] : NULL;
+	if(redundant(shadow && *shadow == texture, stats.textures)) return;
+	glBindTexture(target, texture);
+	countCall(commandBindTexture);
+	if(shadow) *shadow = texture;
+}
+
+void GLRenderDevice::texParameteri(GLenum target, GLenum name, GLint value)
+{
+	glTexParameteri(target, name, value);
+}
+
+void GLRenderDevice::texImage2D(GLenum target, GLint internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* data)
+{
+	glTexImage2D(target, 0, internalFormat, width, height, 0, format, type, data);
+}
+
+// InitShader leaves the new program in use
+GLuint GLRenderDevice::createProgram(const char* vertexShaderFile, const char* fragmentShaderFile)
+{
+	program = InitShader(vertexShaderFile, fragmentShaderFile);
+	return program;
+}
+
+void GLRenderDevice::useProgram(GLuint program)
+{
+	if(redundant(this->program == program, stats.programs)) return;
+	glUseProgram(program);
+	countCall(commandUseProgram);
+	this->program = program;
+}
+
+GLint GLRenderDevice::getAttribLocation(GLuint program, const char* name)
+{
+	return glGetAttribLocation(program, name);
+}
+
+GLint GLRenderDevice::getUniformLocation(GLuint program, const char* name)
+{
+	return glGetUniformLocation(program, name);
+}
+
+void GLRenderDevice::uniform1i(GLint location, GLint value)
+{
+	glUniform1i(location, value);
+	countCall(commandUniform);
+}
+
+void GLRenderDevice::uniform1f(GLint location, GLfloat value)
+{
+	glUniform1f(location, value);
+	countCall(commandUniform);
+}
+
+void GLRenderDevice::uniform3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	glUniform3fv(location, count, value);
+	countCall(commandUniform);
+}
+
+void GLRenderDevice::uniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	glUniform4fv(location, count, value);
+	countCall(commandUniform);
+}
+
+void GLRenderDevice::uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+	glUniformMatrix4fv(location, count, transpose, value);
+	countCall(commandUniform);
+}
+
+// index of the capability in the shadow, -1 if it passes through
+int GLRenderDevice::findCapability(GLenum capability) const
+{
+	for(int i = 0; i < stateCacheCapabilities; i++)
+	{
+		if(cachedCapabilities[i] == capability) return i;
+	}
+	return -1;
+}
+
+void GLRenderDevice::enable(GLenum capability)
+{
+	int i = findCapability(capability);
+	if(redundant(i >= 0 && enables[i] == 1, stats.enables)) return;
+	glEnable(capability);
+	countCall(commandEnable);
+	if(i >= 0) enables[i] = 1;
+}
+
+void GLRenderDevice::disable(GLenum capability)
+{
+	int i = findCapability(capability);
+	if(redundant(i >= 0 && enables[i] == 0, stats.enables)) return;
+	glDisable(capability);
+	countCall(commandDisable);
+	if(i >= 0) enables[i] = 0;
+}
+
+void GLRenderDevice::hint(GLenum target, GLenum mode)
+{
+	glHint(target, mode);
+}
+
+void GLRenderDevice::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	glViewport(x, y, width, height);
+}
+
+void GLRenderDevice::scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	glScissor(x, y, width, height);
+	countCall(commandScissor);
+}
+
+void GLRenderDevice::clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	GLfloat color[4] = {red, green, blue, alpha};
+	if(redundant(clearKnown && !memcmp(color, clearValue, sizeof(color)), stats.clears)) return;
+	glClearColor(red, green, blue, alpha);
+	countCall(commandClearColor);
+	memcpy(clearValue, color, sizeof(color));
+	clearKnown = true;
+}
+
+void GLRenderDevice::clear(GLbitfield mask)
+{
+	glClear(mask);
+}
+
+void GLRenderDevice::drawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	glDrawArrays(mode, first, count);
+	countCall(commandDraw);
+}
+
+// null device
+
+NullRenderDevice::NullRenderDevice() : nextName(0)
+{
+	reset();
+}
+
+// forget the recorded commands, the names and the locations handed out stay valid
+void NullRenderDevice::reset()
+{
+	commands.clear();
+	data.clear();
+	for(int i = 0; i < nRenderCommands; i++) counts[i] = 0;
+	triangles = 0;
+}
+
+// print the number of commands of every type recorded
+void NullRenderDevice::report() const
+{
+	printf("null device: %d commands, %lld triangles\n", (int)commands.size(), triangles);
+	for(int i = 0; i < nRenderCommands; i++)
+	{
+		if(counts[i] > 0) printf("%8d %s\n", counts[i], renderCommandNames[i]);
+	}
+}
+
+void NullRenderDevice::record(int type, GLuint target, GLuint name, GLint value)
+{
+	RenderCommand command = {type, target, name, value};
+	commands.push_back(command);
+	counts[type]++;
+	countCall(type);
+}
+
+// the uniform values are copied, the command points at them
+void NullRenderDevice::recordUniform(GLint location, const GLfloat* values, int n)
+{
+	record(commandUniform, location, (GLuint)data.size(), n);
+	data.insert(data.end(), values, values + n);
+}
+
+// the same location for the same name whatever the program, the shaders are never compiled
+GLint NullRenderDevice::findLocation(const char* name)
+{
+	for(int i = 0; i < (int)locations.size(); i++)
+	{
+		if(!strcmp(locations[i].c_str(), name)) return i;
+	}
+	locations.push_back(name);
+	return (GLint)locations.size() - 1;
+}
+
+GLuint NullRenderDevice::createBuffer()
+{
+	record(commandCreateBuffer, 0, ++nextName, 0);
+	return nextName;
+}
+
+void NullRenderDevice::deleteBuffer(GLuint buffer)
+{
+	record(commandDeleteBuffer, 0, buffer, 0);
+}
+
+void NullRenderDevice::bindBuffer(GLenum target, GLuint buffer)
+{
+	record(commandBindBuffer, target, buffer, 0);
+}
+
+void NullRenderDevice::bufferData(GLenum target, GLsizeiptr size, const void*, GLenum usage)
+{
+	record(commandBufferData, target, usage, (GLint)size);
+}
+
+void NullRenderDevice::bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void*)
+{
+	record(commandBufferSubData, target, (GLuint)offset, (GLint)size);
+}
+
+void NullRenderDevice::enableVertexAttribArray(GLuint index)
+{
+	record(commandEnableAttribute, index, 0, 0);
+}
+
+void NullRenderDevice::vertexAttribPointer(GLuint index, GLint size, GLenum, GLboolean, GLsizei, GLintptr offset)
+{
+	record(commandAttributePointer, index, (GLuint)offset, size);
+}
+
+void NullRenderDevice::bindVertexArray(GLuint vertexArray)
+{
+	record(commandBindVertexArray, 0, vertexArray, 0);
+}
+
+GLuint NullRenderDevice::createTexture()
+{
+	record(commandCreateTexture, 0, ++nextName, 0);
+	return nextName;
+}
+
+void NullRenderDevice::activeTexture(GLenum unit)
+{
+	record(commandActiveTexture, unit, 0, 0);
+}
+
+void NullRenderDevice::bindTexture(GLenum target, GLuint texture)
+{
+	record(commandBindTexture, target, texture, 0);
+}
+
+void NullRenderDevice::texParameteri(GLenum target, GLenum name, GLint value)
+{
+	record(commandTextureParameter, target, name, value);
+}
+
+void NullRenderDevice::texImage2D(GLenum target, GLint, GLsizei width, GLsizei height, GLenum format, GLenum, const void*)
+{
+	record(commandTextureImage, target, format, width * height);
+}
+
+GLuint NullRenderDevice::createProgram(const char*, const char*)
+{
+	record(commandCreateProgram, 0, ++nextName, 0);
+	return nextName;
+}
+
+void NullRenderDevice::useProgram(GLuint program)
+{
+	record(commandUseProgram, 0, program, 0);
+}
+
+GLint NullRenderDevice::getAttribLocation(GLuint program, const char* name)
+{
+	GLint location = findLocation(name);
+	record(commandAttributeLocation, location, program, 0);
+	return location;
+}
+
+GLint NullRenderDevice::getUniformLocation(GLuint program, const char* name)
+{
+	GLint location = findLocation(name);
+	record(commandUniformLocation, location, program, 0);
+	return location;
+}
+
+void NullRenderDevice::uniform1i(GLint location, GLint value)
+{
+	GLfloat v = (GLfloat)value;
+	recordUniform(location, &v, 1);
+}
+
+void NullRenderDevice::uniform1f(GLint location, GLfloat value)
+{
+	recordUniform(location, &value, 1);
+}
+
+void NullRenderDevice::uniform3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	recordUniform(location, value, 3 * count);
+}
+
+void NullRenderDevice::uniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	recordUniform(location, value, 4 * count);
+}
+
+void NullRenderDevice::uniformMatrix4fv(GLint location, GLsizei count, GLboolean, const GLfloat* value)
+{
+	recordUniform(location, value, 16 * count);
+}
+
+void NullRenderDevice::enable(GLenum capability)
+{
+	record(commandEnable, capability, 0, 0);
+}
+
+void NullRenderDevice::disable(GLenum capability)
+{
+	record(commandDisable, capability, 0, 0);
+}
+
+void NullRenderDevice::hint(GLenum target, GLenum mode)
+{
+	record(commandHint, target, mode, 0);
+}
+
+void NullRenderDevice::viewport(GLint, GLint, GLsizei width, GLsizei height)
+{
+	record(commandViewport, 0, width, height);
+}
+
+void NullRenderDevice::scissor(GLint, GLint, GLsizei width, GLsizei height)
+{
+	record(commandScissor, 0, width, height);
+}
+
+void NullRenderDevice::clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	GLfloat color[4] = {red, green, blue, alpha};
+	record(commandClearColor, 0, (GLuint)data.size(), 4);
+	data.insert(data.end(), color, color + 4);
+}
+
+void NullRenderDevice::clear(GLbitfield mask)
+{
+	record(commandClear, mask, 0, 0);
+}
+
+void NullRenderDevice::drawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	record(commandDraw, mode, first, count);
+	if(mode == GL_TRIANGLES) triangles += count / 3;
+}
+
+// per-object drawing
+
+// look up the attributes and uniforms of the per-object drawing in the program
+void getObjectLocations(RenderDevice* device, GLuint program, ObjectLocations& locations)
+{
+	locations.position = device->getAttribLocation(program, "vPosition");
+	locations.normal = device->getAttribLocation(program, "vNormal");
+	locations.texcoord = device->getAttribLocation(program, "vTexture");
+	locations.shininess = device->getUniformLocation(program, "shininess");
+	const char* names[4][2] = {{"AmbientProd[0]", "AmbientProd[1]"}, {"DiffuseProd[0]", "DiffuseProd[1]"},
+		{"SpecularProd[0]", "SpecularProd[1]"}, {"LightPosition[0]", "LightPosition[1]"}};
+	for(int i = 0; i < 2; i++)
+	{
+		locations.ambient[i] = device->getUniformLocation(program, names[0][i]);
+		locations.diffuse[i] = device->getUniformLocation(program, names[1][i]);
+		locations.specular[i] = device->getUniformLocation(program, names[2][i]);
+		locations.lightPosition[i] = device->getUniformLocation(program, names[3][i]);
+	}
+	locations.spotDirection = device->getUniformLocation(program, "spotDirection");
+	locations.modelView = device->getUniformLocation(program, "modelview_matrix");
+}
+
+// bind the buffer of the object and link its position, normal and texture coordinate attributes
+void setObjectAttributes(RenderDevice* device, const ObjectLocations& locations, const Object* object)
+{
+	device->bindBuffer(GL_ARRAY_BUFFER, object->buffer);
+
+	// sizes of vertex/normal buffers
+	int vsize = sizeof(*object->vertices) * object->nVertices;
+	int nsize = sizeof(*object->normals) * object->nVertices;
+
+	// link the position attribute data
+	device->enableVertexAttribArray(locations.position);
+	device->vertexAttribPointer(locations.position, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+	// link the normal attribute data
+	device->enableVertexAttribArray(locations.normal);
+	device->vertexAttribPointer(locations.normal, 3, GL_FLOAT, GL_FALSE, 0, vsize);
+
+	// link the texture coordinate attribute data
+	device->enableVertexAttribArray(locations.texcoord);
+	device->vertexAttribPointer(locations.texcoord, 2, GL_FLOAT, GL_FALSE, 0, vsize + nsize);
+}
+
+// set the shininess and the products and positions of both lights, the second one scaled by the flash
+void setObjectLighting(RenderDevice* device, const ObjectLocations& locations, const Material& material, const Light lights[2], float flash, const vec3& spotDirection)
+{
+	// shininess
+	device->uniform1f(locations.shininess, material.shininess);
+
+	// lighting variables for the light0 and the light1
+	for(int i = 0; i < 2; i++)
+	{
+		vec4 products[3];
+		lightProducts(lights[i], material, i == 0 ? 1 : flash, products);
+		device->uniform4fv(locations.ambient[i], 1, products[0]);
+		device->uniform4fv(locations.diffuse[i], 1, products[1]);
+		device->uniform4fv(locations.specular[i], 1, products[2]);
+		device->uniform4fv(locations.lightPosition[i], 1, lights[i].position);
+	}
+	device->uniform3fv(locations.spotDirection, 1, spotDirection);
+}
+
+// set the model-view matrix, bind the texture unless it is 0 and draw the triangles of the object
+void drawObject(RenderDevice* device, const ObjectLocations& locations, const Object* object, GLuint texture, const mat4& modelViewMatrix)
+{
+	device->uniformMatrix4fv(locations.modelView, 1, GL_TRUE, modelViewMatrix);
+	if(texture != 0) device->bindTexture(GL_TEXTURE_2D, texture);
+	device->drawArrays(GL_TRIANGLES, 0, object->nVertices);
+}
@@ -0,0 +1,293 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- renderdevice.h ---
+//
+//   Thin interface between the scene drawing and the graphics API: the
+//   buffers, textures, programs, state and draws the per-object path
+//   uses, with the arguments of the OpenGL calls they stand for.  The
+//   OpenGL device forwards the calls through a shadow of the bound
+//   buffers, vertex array, attributes, textures, program, enables and
+//   clear color, dropping those that would not change the state.  The
+//   null device makes no call at all, it records the commands with their
+//   uniform values into a buffer and counts them, so the traversal and the
+//   submission can be timed and checked without a driver.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __RENDERDEVICE_H__
+#define __RENDERDEVICE_H__
+
+#include <vector>
+#include <string>
+#include "Angel.h"
+#include "scene.h"
+
+// commands of the devices
+enum RenderCommandType
+{
+	commandCreateBuffer,
+	commandDeleteBuffer,
+	commandBindBuffer,
+	commandBufferData,
+	commandBufferSubData,
+	commandEnableAttribute,
+	commandAttributePointer,
+	commandBindVertexArray,
+	commandCreateTexture,
+	commandActiveTexture,
+	commandBindTexture,
+	commandTextureParameter,
+	commandTextureImage,
+	commandCreateProgram,
+	commandUseProgram,
+	commandAttributeLocation,
+	commandUniformLocation,
+	commandUniform,
+	commandEnable,
+	commandDisable,
+	commandHint,
+	commandViewport,
+	commandScissor,
+	commandClearColor,
+	commandClear,
+	commandDraw,
+	nRenderCommands
+};
+
+extern const char* renderCommandNames[nRenderCommands];
+
+const int stateCacheUnits = 8;       // texture units of the shadowed 2D bindings
+const int stateCacheAttributes = 16; // vertex attributes shadowed
+const int stateCacheCapabilities = 3; // enables shadowed, the depth test, the face culling and the blending
+const GLuint stateUnknown = 0xffffffff; // shadow value before the first call and after an invalidation
+
+// state cache statistics since the last reset
+struct StateCacheStats
+{
+	int calls;       // state calls made to the device
+	int filtered;    // calls dropped because the state was already set
+	int buffers;     // dropped buffer binds
+	int vertexArrays; // dropped vertex array binds
+	int attributes;  // dropped attribute enables and pointers
+	int textures;    // dropped texture unit changes and binds
+	int programs;    // dropped program changes
+	int enables;     // dropped enables and disables
+	int clears;      // dropped clear colors
+	int mismatches;  // shadow values found different from OpenGL by the validation
+};
+
+// recorded command, the uniforms keep their values in the data of the device
+struct RenderCommand
+{
+	int type;    // RenderCommandType
+	GLuint target; // target, location, capability or mode
+	GLuint name;   // buffer, texture or program, or the first value of the uniform data
+	GLint value;   // parameter, size or count
+};
+
+// buffers, textures, programs, state and draws of the scene drawing
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() {}
+
+	// buffers and vertex attributes
+	virtual GLuint createBuffer() = 0;
+	virtual void deleteBuffer(GLuint buffer) = 0;
+	virtual void bindBuffer(GLenum target, GLuint buffer) = 0;
+	virtual void bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) = 0;
+	virtual void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) = 0;
+	virtual void enableVertexAttribArray(GLuint index) = 0;
+	virtual void vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset) = 0;
+	virtual void bindVertexArray(GLuint vertexArray) = 0;
+
+	// textures
+	virtual GLuint createTexture() = 0;
+	virtual void activeTexture(GLenum unit) = 0;
+	virtual void bindTexture(GLenum target, GLuint texture) = 0;
+	virtual void texParameteri(GLenum target, GLenum name, GLint value) = 0;
+	virtual void texImage2D(GLenum target, GLint internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* data) = 0;
+
+	// programs and uniforms
+	virtual GLuint createProgram(const char* vertexShaderFile, const char* fragmentShaderFile) = 0;
+	virtual void useProgram(GLuint program) = 0;
+	virtual GLint getAttribLocation(GLuint program, const char* name) = 0;
+	virtual GLint getUniformLocation(GLuint program, const char* name) = 0;
+	virtual void uniform1i(GLint location, GLint value) = 0;
+	virtual void uniform1f(GLint location, GLfloat value) = 0;
+	virtual void uniform3fv(GLint location, GLsizei count, const GLfloat* value) = 0;
+	virtual void uniform4fv(GLint location, GLsizei count, const GLfloat* value) = 0;
+	virtual void uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) = 0;
+
+	// state and draws
+	virtual void enable(GLenum capability) = 0;
+	virtual void disable(GLenum capability) = 0;
+	virtual void hint(GLenum target, GLenum mode) = 0;
+	virtual void viewport(GLint x, GLint y, GLsizei width, GLsizei height) = 0;
+	virtual void scissor(GLint x, GLint y, GLsizei width, GLsizei height) = 0;
+	virtual void clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) = 0;
+	virtual void clear(GLbitfield mask) = 0;
+	virtual void drawArrays(GLenum mode, GLint first, GLsizei count) = 0;
+
+	// forget the state assumed by the device, after OpenGL calls made around it,
+	// all of it, only the bound objects and program or only the enables
+	virtual void invalidate() {}
+	virtual void invalidateBindings() {}
+	virtual void invalidateEnables() {}
+};
+
+// device calling OpenGL, the redundant state calls are filtered while caching
+class GLRenderDevice : public RenderDevice
+{
+public:
+	bool caching;          // drop the calls setting the state already set
+	bool validating;       // compare the shadow with OpenGL after every state call, on in debug builds
+	StateCacheStats stats; // state calls since the last reset
+
+	GLRenderDevice();
+
+	void resetStats();
+	int validate();
+	void invalidate();
+	void invalidateBindings();
+	void invalidateEnables();
+
+	GLuint createBuffer();
+	void deleteBuffer(GLuint buffer);
+	void bindBuffer(GLenum target, GLuint buffer);
+	void bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+	void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+	void enableVertexAttribArray(GLuint index);
+	void vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset);
+	void bindVertexArray(GLuint vertexArray);
+
+	GLuint createTexture();
+	void activeTexture(GLenum unit);
+	void bindTexture(GLenum target, GLuint texture);
+	void texParameteri(GLenum target, GLenum name, GLint value);
+	void texImage2D(GLenum target, GLint internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* data);
+
+	GLuint createProgram(const char* vertexShaderFile, const char* fragmentShaderFile);
+	void useProgram(GLuint program);
+	GLint getAttribLocation(GLuint program, const char* name);
+	GLint getUniformLocation(GLuint program, const char* name);
+	void uniform1i(GLint location, GLint value);
+	void uniform1f(GLint location, GLfloat value);
+	void uniform3fv(GLint location, GLsizei count, const GLfloat* value);
+	void uniform4fv(GLint location, GLsizei count, const GLfloat* value);
+	void uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void hint(GLenum target, GLenum mode);
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	void scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+	void clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+	void clear(GLbitfield mask);
+	void drawArrays(GLenum mode, GLint first, GLsizei count);
+
+private:
+	// pointer of a vertex attribute, with the array buffer bound when it was set
+	struct AttributeState
+	{
+		GLuint enabled; // 0, 1 or unknown
+		GLuint buffer;
+		GLint size;
+		GLenum type;
+		GLboolean normalized;
+		GLsizei stride;
+		GLintptr offset;
+	};
+
+	// shadow of the OpenGL state, stateUnknown where the device does not know it
+	GLuint arrayBuffer, elementBuffer, vertexArray, program;
+	GLuint activeUnit;                      // texture unit from 0
+	GLuint textures[stateCacheUnits];       // 2D texture of every unit
+	AttributeState attributes[stateCacheAttributes]; // attributes of the bound vertex array
+	GLuint enables[stateCacheCapabilities]; // 0, 1 or unknown
+	GLfloat clearValue[4];
+	bool clearKnown;
+
+	bool redundant(bool same, int& dropped);
+	void invalidateAttributes();
+	int findCapability(GLenum capability) const;
+	void setCapability(GLenum capability, bool value);
+	void check(const char* name, GLint value, GLuint shadow);
+};
+
+// device recording the commands without drawing anything
+class NullRenderDevice : public RenderDevice
+{
+public:
+	std::vector<RenderCommand> commands; // commands since the last reset
+	std::vector<GLfloat> data;           // uniform values of the commands
+	int counts[nRenderCommands];         // commands of every type since the last reset
+	long long triangles;                 // triangles drawn since the last reset
+
+	NullRenderDevice();
+
+	void reset();
+	void report() const;
+
+	GLuint createBuffer();
+	void deleteBuffer(GLuint buffer);
+	void bindBuffer(GLenum target, GLuint buffer);
+	void bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+	void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+	void enableVertexAttribArray(GLuint index);
+	void vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset);
+	void bindVertexArray(GLuint vertexArray);
+
+	GLuint createTexture();
+	void activeTexture(GLenum unit);
+	void bindTexture(GLenum target, GLuint texture);
+	void texParameteri(GLenum target, GLenum name, GLint value);
+	void texImage2D(GLenum target, GLint internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* data);
+
+	GLuint createProgram(const char* vertexShaderFile, const char* fragmentShaderFile);
+	void useProgram(GLuint program);
+	GLint getAttribLocation(GLuint program, const char* name);
+	GLint getUniformLocation(GLuint program, const char* name);
+	void uniform1i(GLint location, GLint value);
+	void uniform1f(GLint location, GLfloat value);
+	void uniform3fv(GLint location, GLsizei count, const GLfloat* value);
+	void uniform4fv(GLint location, GLsizei count, const GLfloat* value);
+	void uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void hint(GLenum target, GLenum mode);
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	void scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+	void clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+	void clear(GLbitfield mask);
+	void drawArrays(GLenum mode, GLint first, GLsizei count);
+
+private:
+	GLuint nextName;                     // buffer, texture and program names handed out
+	std::vector<std::string> locations;  // attribute and uniform names, the location is the position
+
+	void record(int type, GLuint target, GLuint name, GLint value);
+	void recordUniform(GLint location, const GLfloat* values, int n);
+	GLint findLocation(const char* name);
+};
+
+// locations of the attributes and uniforms the per-object drawing sets in the lighting program
+struct ObjectLocations
+{
+	GLint position, normal, texcoord; // attributes
+	GLint shininess;
+	GLint ambient[2], diffuse[2], specular[2], lightPosition[2]; // products and positions of both lights
+	GLint spotDirection;
+	GLint modelView;
+};
+
+// per-object drawing through a device with the locations looked up once for the program,
+// the buffer and the attributes, the lighting uniforms, then the model-view matrix, the
+// texture if not 0 and the draw
+void getObjectLocations(RenderDevice* device, GLuint program, ObjectLocations& locations);
+void setObjectAttributes(RenderDevice* device, const ObjectLocations& locations, const Object* object);
+void setObjectLighting(RenderDevice* device, const ObjectLocations& locations, const Material& material, const Light lights[2], float flash, const vec3& spotDirection);
+void drawObject(RenderDevice* device, const ObjectLocations& locations, const Object* object, GLuint texture, const mat4& modelViewMatrix);
+
+#endif // __RENDERDEVICE_H__
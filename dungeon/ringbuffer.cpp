@@ -0,0 +1,123 @@
+#include "ringbuffer.h"
+#include "timer.h"
+
+RingBuffer::RingBuffer() : buffer(0), data(NULL), regionSize(0), nRegions(0), region(0), head(0)
+{
+	for(int i = 0; i < maxRingRegions; i++)
+	{
+		fences[i] = 0;
+	}
+	stats.bytesWritten = stats.allocations = stats.overflows = stats.fenceWaits = 0;
+	stats.waitTime = 0;
+}
+
+RingBuffer::~RingBuffer()
+{
+	destroy();
+}
+
+// create and map the buffer, false if the context has no persistent mapping
+bool RingBuffer::create(GLsizeiptr regionSize, int nRegions)
+{
+	if(!GLEW_ARB_buffer_storage || !GLEW_ARB_sync) return false;
+
+	this->regionSize = regionSize;
+	this->nRegions = nRegions < maxRingRegions ? nRegions : maxRingRegions;
+	region = 0;
+	head = 0;
+
+	// immutable storage mapped once for the whole run
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize * this->nRegions, NULL, flags);
+	data = (GLubyte*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * this->nRegions, flags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if(!data)
+	{
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+// unmap and delete the buffer
+void RingBuffer::destroy()
+{
+	for(int i = 0; i < maxRingRegions; i++)
+	{
+		if(fences[i]) glDeleteSync(fences[i]);
+		fences[i] = 0;
+	}
+
+	if(buffer)
+	{
+		if(data)
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &buffer);
+	}
+	buffer = 0;
+	data = NULL;
+}
+
+// move to the next region, waiting until the GPU is done with it
+void RingBuffer::beginFrame()
+{
+	stats.bytesWritten = stats.allocations = stats.overflows = stats.fenceWaits = 0;
+	stats.waitTime = 0;
+	if(!buffer) return;
+
+	region = (region + 1) % nRegions;
+	head = 0;
+
+	GLsync fence = fences[region];
+	if(fence)
+	{
+		// usually signaled already, otherwise flush and wait
+		if(glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			double start = currentTime();
+			stats.fenceWaits++;
+			GLenum result;
+			do
+			{
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+			}
+			while(result == GL_TIMEOUT_EXPIRED);
+			stats.waitTime = currentTime() - start;
+		}
+		glDeleteSync(fence);
+		fences[region] = 0;
+	}
+}
+
+// memory for the data of this frame, NULL if the region is full
+void* RingBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment, GLintptr* offset)
+{
+	if(!buffer) return NULL;
+
+	GLsizeiptr start = alignment > 1 ? (head + alignment - 1) / alignment * alignment : head;
+	if(start + size > regionSize)
+	{
+		stats.overflows++;
+		return NULL;
+	}
+
+	head = start + size;
+	stats.bytesWritten += (int)size;
+	stats.allocations++;
+	*offset = region * regionSize + start;
+	return data + *offset;
+}
+
+// guard the region until the GPU has read the commands of this frame
+void RingBuffer::endFrame()
+{
+	if(!buffer) return;
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
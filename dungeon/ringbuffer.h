@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- ringbuffer.h ---
+//
+//   Ring allocator for per-frame dynamic data over one persistently
+//   mapped buffer.  The buffer is split into regions used by consecutive
+//   frames in turn, a fence sync guards each region until the GPU has
+//   finished reading it, so writes need no driver copies.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __RINGBUFFER_H__
+#define __RINGBUFFER_H__
+
+#include "Angel.h"
+
+const int maxRingRegions = 4; // maximal number of frames in flight
+
+// ring statistics of the last frame
+struct RingStats
+{
+	int bytesWritten;  // bytes allocated in the frame
+	int allocations;   // allocations in the frame
+	int overflows;     // allocations that did not fit
+	int fenceWaits;    // waits for the GPU before reusing the region
+	double waitTime;   // time spent waiting in milliseconds
+};
+
+// persistently mapped ring of per-frame regions
+class RingBuffer
+{
+public:
+	GLuint buffer;   // buffer ID, 0 if not supported
+	RingStats stats; // statistics of the last frame
+
+	RingBuffer();
+	~RingBuffer();
+
+	bool create(GLsizeiptr regionSize, int nRegions = 3);
+	void destroy();
+	bool isAvailable() const { return buffer != 0; }
+
+	void beginFrame();
+	void* allocate(GLsizeiptr size, GLsizeiptr alignment, GLintptr* offset);
+	void endFrame();
+
+private:
+	GLubyte* data;          // mapped buffer memory
+	GLsizeiptr regionSize;  // size of one region in bytes
+	int nRegions;           // number of regions
+	int region;             // region of the current frame
+	GLsizeiptr head;        // first free byte in the current region
+	GLsync fences[maxRingRegions];
+};
+
+#endif // __RINGBUFFER_H__
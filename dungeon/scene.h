@@ -0,0 +1,202 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- scene.h ---
+//
+//   Objects, materials, lights and the scene graph hierarchy
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SCENE_H__
+#define __SCENE_H__
+
+#include <vector>
+#include "Angel.h"
+#include "transform.h"
+#include "occlusion.h"
+
+// material parameters
+struct Material
+{
+	vec4 diffuse, ambient, specular;
+	float shininess;
+};
+
+// light parameters
+struct Light
+{
+	vec4 position;
+	vec4 diffuse, ambient, specular;
+};
+
+// ambient, diffuse and specular products of the light and the material scaled by the intensity
+inline void lightProducts(const Light& light, const Material& material, float intensity, vec4 products[3])
+{
+	products[0] = light.ambient * material.ambient * intensity;
+	products[1] = light.diffuse * material.diffuse * intensity;
+	products[2] = light.specular * material.specular * intensity;
+}
+
+// object data
+class Object
+{
+public:
+	bool visible;      // object visibility
+	vec3* vertices;    // vertex positions
+	vec3* normals;     // vertex normals
+	vec2* texcoords;   // vertex texture coordinates
+	int nVertices;     // actual number of vertices
+	Material material; // object material
+	GLuint buffer;     // buffer ID
+	int mesh;          // mesh in the shared buffers of the multi-draw indirect path
+	Transform transform; // local object transformation, changed by setTransform
+	bool dirty;        // local transformation changed since the last transform update
+	int index;         // position in the scene graph traversal order
+	vec3 boundsMin;    // bounding box in object coordinates
+	vec3 boundsMax;    // bounding box in object coordinates
+	OccluderMesh* occluder; // simplified mesh hiding other objects, NULL if none
+	int proxy;         // leaf in the bounding volume hierarchy, -1 if none
+	int frustumFrame;  // last frame the object was found inside the view frustum
+	GLuint texture;    // texture IDs
+	Object *next;      // next object in scene graph hierarchy
+	Object *children;  // child objects in scene graph hierarchy
+
+	Object() : visible(true), vertices(NULL), normals(NULL), texcoords(NULL), nVertices(0), buffer(0), mesh(-1), dirty(true), index(-1), occluder(NULL), proxy(-1), frustumFrame(-1), texture(0), next(NULL), children(NULL)
+	{
+	}
+
+	void addChild(Object* child)
+	{
+		child->next = children;
+		children = child;
+	}
+
+	void setTransform(const Transform& t)
+	{
+		transform = t;
+		dirty = true;
+	}
+
+	// the matrix must be affine, its bottom row is dropped
+	void setMatrix(const mat4& m)
+	{
+		setTransform(Transform(m));
+	}
+};
+
+// scene graph hierarchy
+class SceneGraph
+{
+public:
+	Object *root;
+
+	// flattened hierarchy in traversal order, parents before children
+	std::vector<Object*> objects;    // objects in traversal order
+	std::vector<int> parents;        // parent position of every object, -1 for the root
+	std::vector<int> subtreeEnds;    // position after the last descendant of every object
+	std::vector<Transform> worldTransforms; // world transformation of every object
+	std::vector<char> worldVisible;  // visibility of every object combined with its parents
+	std::vector<int> updated;        // positions whose world transform changed in the last update
+	bool orderChanged;               // objects were added since the last update
+
+	SceneGraph() : orderChanged(true)
+	{
+		root = new Object;
+	}
+
+	// add the object to the hierarchy
+	void addObject(Object* parent, Object* child)
+	{
+		parent->addChild(child);
+		orderChanged = true;
+	}
+
+	// recompute the world transforms of the changed subtrees
+	void updateTransforms()
+	{
+		if(orderChanged)
+		{
+			// flatten the hierarchy, every object gets recomputed
+			objects.clear();
+			parents.clear();
+			subtreeEnds.clear();
+			flatten(root, -1);
+			worldTransforms.resize(objects.size());
+			worldVisible.resize(objects.size());
+			root->dirty = true;
+			orderChanged = false;
+		}
+
+		// a dirty object makes its whole subtree dirty
+		updated.clear();
+		int dirtyEnd = 0;
+		for(int i = 0; i < (int)objects.size(); i++)
+		{
+			Object* object = objects[i];
+			int parent = parents[i];
+
+			if(object->dirty && subtreeEnds[i] > dirtyEnd) dirtyEnd = subtreeEnds[i];
+			if(i < dirtyEnd)
+			{
+				worldTransforms[i] = parent < 0 ? object->transform : worldTransforms[parent] * object->transform;
+				object->dirty = false;
+				updated.push_back(i);
+			}
+		}
+	}
+
+	// combine the visibility of every object with its parents
+	void updateVisibility()
+	{
+		for(int i = 0; i < (int)objects.size(); i++)
+		{
+			int parent = parents[i];
+			worldVisible[i] = objects[i]->visible && (parent < 0 || worldVisible[parent]);
+		}
+	}
+
+	void flatten(Object* object, int parent)
+	{
+		// traverse the scene graph
+		while(object)
+		{
+			int index = (int)objects.size();
+			object->index = index;
+			objects.push_back(object);
+			parents.push_back(parent);
+			subtreeEnds.push_back(0);
+
+			// flatten object's children recursively
+			flatten(object->children, index);
+			subtreeEnds[index] = (int)objects.size();
+
+			// move to the next object in scene graph hierarchy
+			object = object->next;
+		}
+	}
+
+	~SceneGraph()
+	{
+		deleteObjects(root);
+	}
+
+	void deleteObjects(Object* object)
+	{
+		// traverse the scene graph
+		while(object)
+		{
+			// delete object's children recursively
+			deleteObjects(object->children);
+
+			// no buffer, and no OpenGL, if the program stopped before loading the object
+			if(object->buffer) glDeleteBuffers(1, &object->buffer);
+			delete object->occluder;
+
+			// delete the object and move to the next child
+			Object *next = object->next;
+			delete object;
+			object = next;
+		}
+	}
+};
+
+#endif // __SCENE_H__
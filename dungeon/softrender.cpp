@@ -0,0 +1,1082 @@
+#include <stdio.h>
+#include <string.h>
+#include "softrender.h"
+#include "arena.h"
+#include "timer.h"
+#include "profiler.h"
+
+#if !defined(ANGEL_NO_SIMD) && defined(__AVX2__)
+#define SOFT_AVX2
+#include <immintrin.h>
+#elif !defined(ANGEL_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SOFT_SSE
+#include <emmintrin.h>
+#elif !defined(ANGEL_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define SOFT_NEON
+#include <arm_neon.h>
+#endif
+
+#include "alloctrack.h"
+
+const float softGuardBand = 4;   // clipping happens this many screen sizes around the center
+const int softMaxThreads = 16;   // threads of the pool when the hardware has more
+
+// lanes of laneWidth pixels side by side, with masks of the covered ones
+#if defined(SOFT_AVX2)
+
+typedef __m256 lanef;
+typedef __m256 lanem;
+const int laneWidth = 8;
+inline lanef laneSet(float s) { return _mm256_set1_ps(s); }
+inline lanef laneLoad(const float* p) { return _mm256_loadu_ps(p); }
+inline void laneStore(float* p, lanef a) { _mm256_storeu_ps(p, a); }
+inline lanef laneRamp() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+inline lanef laneAdd(lanef a, lanef b) { return _mm256_add_ps(a, b); }
+inline lanef laneSub(lanef a, lanef b) { return _mm256_sub_ps(a, b); }
+inline lanef laneMul(lanef a, lanef b) { return _mm256_mul_ps(a, b); }
+inline lanef laneDiv(lanef a, lanef b) { return _mm256_div_ps(a, b); }
+inline lanef laneMin(lanef a, lanef b) { return _mm256_min_ps(a, b); }
+inline lanef laneMax(lanef a, lanef b) { return _mm256_max_ps(a, b); }
+inline lanef laneFloor(lanef a) { return _mm256_floor_ps(a); }
+inline lanem laneLess(lanef a, lanef b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline lanem laneGreater(lanef a, lanef b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+inline lanem laneGreaterEqual(lanef a, lanef b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+inline lanem laneEqual(lanef a, lanef b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+inline lanem laneAnd(lanem a, lanem b) { return _mm256_and_ps(a, b); }
+inline lanef laneSelect(lanem m, lanef a, lanef b) { return _mm256_blendv_ps(b, a, m); }
+inline int laneBits(lanem m) { return _mm256_movemask_ps(m); }
+
+// 1 / sqrt with one Newton step
+inline lanef laneRsqrt(lanef a)
+{
+	__m256 r = _mm256_rsqrt_ps(a);
+	return _mm256_mul_ps(r, _mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), a), _mm256_mul_ps(r, r))));
+}
+
+// exponent and mantissa in [1, 2) of positive numbers
+inline void laneSplit(lanef x, lanef& exponent, lanef& mantissa)
+{
+	__m256i bits = _mm256_castps_si256(x);
+	exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+	mantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x7fffff)), _mm256_set1_epi32(0x3f800000)));
+}
+
+// a * 2^i for whole i in [-126, 127]
+inline lanef laneScale(lanef a, lanef i)
+{
+	__m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(i), _mm256_set1_epi32(127)), 23);
+	return _mm256_mul_ps(a, _mm256_castsi256_ps(bits));
+}
+
+// RGB of the texels at the indices, from 0 to 255
+inline void laneTexels(const unsigned* texels, lanef index, lanef* rgb)
+{
+	__m256i t = _mm256_i32gather_epi32((const int*)texels, _mm256_cvttps_epi32(index), 4);
+	__m256i mask = _mm256_set1_epi32(0xff);
+	rgb[0] = _mm256_cvtepi32_ps(_mm256_and_si256(t, mask));
+	rgb[1] = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t, 8), mask));
+	rgb[2] = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t, 16), mask));
+}
+
+// write the pixels of the mask, the colors scaled to 0..255 and rounded
+inline void laneStorePixels(unsigned* p, const lanef* rgb, lanem m)
+{
+	__m256i r = _mm256_cvttps_epi32(rgb[0]);
+	__m256i g = _mm256_slli_epi32(_mm256_cvttps_epi32(rgb[1]), 8);
+	__m256i b = _mm256_slli_epi32(_mm256_cvttps_epi32(rgb[2]), 16);
+	__m256i pixel = _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, _mm256_set1_epi32((int)0xff000000)));
+	__m256i old = _mm256_loadu_si256((const __m256i*)p);
+	_mm256_storeu_si256((__m256i*)p, _mm256_blendv_epi8(old, pixel, _mm256_castps_si256(m)));
+}
+
+#elif defined(SOFT_SSE)
+
+typedef __m128 lanef;
+typedef __m128 lanem;
+const int laneWidth = 4;
+inline lanef laneSet(float s) { return _mm_set1_ps(s); }
+inline lanef laneLoad(const float* p) { return _mm_loadu_ps(p); }
+inline void laneStore(float* p, lanef a) { _mm_storeu_ps(p, a); }
+inline lanef laneRamp() { return _mm_setr_ps(0, 1, 2, 3); }
+inline lanef laneAdd(lanef a, lanef b) { return _mm_add_ps(a, b); }
+inline lanef laneSub(lanef a, lanef b) { return _mm_sub_ps(a, b); }
+inline lanef laneMul(lanef a, lanef b) { return _mm_mul_ps(a, b); }
+inline lanef laneDiv(lanef a, lanef b) { return _mm_div_ps(a, b); }
+inline lanef laneMin(lanef a, lanef b) { return _mm_min_ps(a, b); }
+inline lanef laneMax(lanef a, lanef b) { return _mm_max_ps(a, b); }
+inline lanem laneLess(lanef a, lanef b) { return _mm_cmplt_ps(a, b); }
+inline lanem laneGreater(lanef a, lanef b) { return _mm_cmpgt_ps(a, b); }
+inline lanem laneGreaterEqual(lanef a, lanef b) { return _mm_cmpge_ps(a, b); }
+inline lanem laneEqual(lanef a, lanef b) { return _mm_cmpeq_ps(a, b); }
+inline lanem laneAnd(lanem a, lanem b) { return _mm_and_ps(a, b); }
+inline lanef laneSelect(lanem m, lanef a, lanef b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+inline int laneBits(lanem m) { return _mm_movemask_ps(m); }
+
+// truncation moved down for the negative numbers
+inline lanef laneFloor(lanef a)
+{
+	__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+	return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1)));
+}
+
+// 1 / sqrt with one Newton step
+inline lanef laneRsqrt(lanef a)
+{
+	__m128 r = _mm_rsqrt_ps(a);
+	return _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), a), _mm_mul_ps(r, r))));
+}
+
+// exponent and mantissa in [1, 2) of positive numbers
+inline void laneSplit(lanef x, lanef& exponent, lanef& mantissa)
+{
+	__m128i bits = _mm_castps_si128(x);
+	exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+	mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x7fffff)), _mm_set1_epi32(0x3f800000)));
+}
+
+// a * 2^i for whole i in [-126, 127]
+inline lanef laneScale(lanef a, lanef i)
+{
+	__m128i bits = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(i), _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(a, _mm_castsi128_ps(bits));
+}
+
+// RGB of the texels at the indices, from 0 to 255
+inline void laneTexels(const unsigned* texels, lanef index, lanef* rgb)
+{
+	int i[4];
+	_mm_storeu_si128((__m128i*)i, _mm_cvttps_epi32(index));
+	__m128i t = _mm_setr_epi32((int)texels[i[0]], (int)texels[i[1]], (int)texels[i[2]], (int)texels[i[3]]);
+	__m128i mask = _mm_set1_epi32(0xff);
+	rgb[0] = _mm_cvtepi32_ps(_mm_and_si128(t, mask));
+	rgb[1] = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(t, 8), mask));
+	rgb[2] = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(t, 16), mask));
+}
+
+// write the pixels of the mask, the colors scaled to 0..255 and rounded
+inline void laneStorePixels(unsigned* p, const lanef* rgb, lanem m)
+{
+	__m128i r = _mm_cvttps_epi32(rgb[0]);
+	__m128i g = _mm_slli_epi32(_mm_cvttps_epi32(rgb[1]), 8);
+	__m128i b = _mm_slli_epi32(_mm_cvttps_epi32(rgb[2]), 16);
+	__m128i pixel = _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, _mm_set1_epi32((int)0xff000000)));
+	__m128i old = _mm_loadu_si128((const __m128i*)p);
+	__m128i mask = _mm_castps_si128(m);
+	_mm_storeu_si128((__m128i*)p, _mm_or_si128(_mm_and_si128(mask, pixel), _mm_andnot_si128(mask, old)));
+}
+
+#elif defined(SOFT_NEON)
+
+typedef float32x4_t lanef;
+typedef uint32x4_t lanem;
+const int laneWidth = 4;
+inline lanef laneSet(float s) { return vdupq_n_f32(s); }
+inline lanef laneLoad(const float* p) { return vld1q_f32(p); }
+inline void laneStore(float* p, lanef a) { vst1q_f32(p, a); }
+inline lanef laneRamp() { static const float ramp[4] = {0, 1, 2, 3}; return vld1q_f32(ramp); }
+inline lanef laneAdd(lanef a, lanef b) { return vaddq_f32(a, b); }
+inline lanef laneSub(lanef a, lanef b) { return vsubq_f32(a, b); }
+inline lanef laneMul(lanef a, lanef b) { return vmulq_f32(a, b); }
+inline lanef laneMin(lanef a, lanef b) { return vminq_f32(a, b); }
+inline lanef laneMax(lanef a, lanef b) { return vmaxq_f32(a, b); }
+inline lanem laneLess(lanef a, lanef b) { return vcltq_f32(a, b); }
+inline lanem laneGreater(lanef a, lanef b) { return vcgtq_f32(a, b); }
+inline lanem laneGreaterEqual(lanef a, lanef b) { return vcgeq_f32(a, b); }
+inline lanem laneEqual(lanef a, lanef b) { return vceqq_f32(a, b); }
+inline lanem laneAnd(lanem a, lanem b) { return vandq_u32(a, b); }
+inline lanef laneSelect(lanem m, lanef a, lanef b) { return vbslq_f32(m, a, b); }
+
+inline int laneBits(lanem m)
+{
+	return (vgetq_lane_u32(m, 0) & 1) | (vgetq_lane_u32(m, 1) & 2) | (vgetq_lane_u32(m, 2) & 4) | (vgetq_lane_u32(m, 3) & 8);
+}
+
+// reciprocal estimate refined by two Newton steps
+inline lanef laneDiv(lanef a, lanef b)
+{
+	float32x4_t r = vrecpeq_f32(b);
+	r = vmulq_f32(r, vrecpsq_f32(b, r));
+	r = vmulq_f32(r, vrecpsq_f32(b, r));
+	return vmulq_f32(a, r);
+}
+
+// truncation moved down for the negative numbers
+inline lanef laneFloor(lanef a)
+{
+	float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(a));
+	return vsubq_f32(t, vbslq_f32(vcgtq_f32(t, a), vdupq_n_f32(1), vdupq_n_f32(0)));
+}
+
+// 1 / sqrt estimate refined by two Newton steps
+inline lanef laneRsqrt(lanef a)
+{
+	float32x4_t r = vrsqrteq_f32(a);
+	r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a, r), r));
+	r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a, r), r));
+	return r;
+}
+
+// exponent and mantissa in [1, 2) of positive numbers
+inline void laneSplit(lanef x, lanef& exponent, lanef& mantissa)
+{
+	uint32x4_t bits = vreinterpretq_u32_f32(x);
+	exponent = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+	mantissa = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x7fffff)), vdupq_n_u32(0x3f800000)));
+}
+
+// a * 2^i for whole i in [-126, 127]
+inline lanef laneScale(lanef a, lanef i)
+{
+	int32x4_t bits = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(i), vdupq_n_s32(127)), 23);
+	return vmulq_f32(a, vreinterpretq_f32_s32(bits));
+}
+
+// RGB of the texels at the indices, from 0 to 255
+inline void laneTexels(const unsigned* texels, lanef index, lanef* rgb)
+{
+	int i[4];
+	unsigned values[4];
+	vst1q_s32(i, vcvtq_s32_f32(index));
+	for(int j = 0; j < 4; j++) values[j] = texels[i[j]];
+	uint32x4_t t = vld1q_u32(values);
+	uint32x4_t mask = vdupq_n_u32(0xff);
+	rgb[0] = vcvtq_f32_u32(vandq_u32(t, mask));
+	rgb[1] = vcvtq_f32_u32(vandq_u32(vshrq_n_u32(t, 8), mask));
+	rgb[2] = vcvtq_f32_u32(vandq_u32(vshrq_n_u32(t, 16), mask));
+}
+
+// write the pixels of the mask, the colors scaled to 0..255 and rounded
+inline void laneStorePixels(unsigned* p, const lanef* rgb, lanem m)
+{
+	uint32x4_t r = vcvtq_u32_f32(rgb[0]);
+	uint32x4_t g = vshlq_n_u32(vcvtq_u32_f32(rgb[1]), 8);
+	uint32x4_t b = vshlq_n_u32(vcvtq_u32_f32(rgb[2]), 16);
+	uint32x4_t pixel = vorrq_u32(vorrq_u32(r, g), vorrq_u32(b, vdupq_n_u32(0xff000000)));
+	vst1q_u32(p, vbslq_u32(m, pixel, vld1q_u32(p)));
+}
+
+#else
+
+typedef float lanef;
+typedef bool lanem;
+const int laneWidth = 1;
+inline lanef laneSet(float s) { return s; }
+inline lanef laneLoad(const float* p) { return *p; }
+inline void laneStore(float* p, lanef a) { *p = a; }
+inline lanef laneRamp() { return 0; }
+inline lanef laneAdd(lanef a, lanef b) { return a + b; }
+inline lanef laneSub(lanef a, lanef b) { return a - b; }
+inline lanef laneMul(lanef a, lanef b) { return a * b; }
+inline lanef laneDiv(lanef a, lanef b) { return a / b; }
+inline lanef laneMin(lanef a, lanef b) { return a < b ? a : b; }
+inline lanef laneMax(lanef a, lanef b) { return a > b ? a : b; }
+inline lanef laneFloor(lanef a) { return floorf(a); }
+inline lanef laneRsqrt(lanef a) { return 1 / sqrtf(a); }
+inline lanem laneLess(lanef a, lanef b) { return a < b; }
+inline lanem laneGreater(lanef a, lanef b) { return a > b; }
+inline lanem laneGreaterEqual(lanef a, lanef b) { return a >= b; }
+inline lanem laneEqual(lanef a, lanef b) { return a == b; }
+inline lanem laneAnd(lanem a, lanem b) { return a && b; }
+inline lanef laneSelect(lanem m, lanef a, lanef b) { return m ? a : b; }
+inline int laneBits(lanem m) { return m ? 1 : 0; }
+
+// exponent and mantissa in [1, 2) of positive numbers
+inline void laneSplit(lanef x, lanef& exponent, lanef& mantissa)
+{
+	int e;
+	mantissa = frexpf(x, &e) * 2;
+	exponent = (float)(e - 1);
+}
+
+// a * 2^i for whole i
+inline lanef laneScale(lanef a, lanef i) { return ldexpf(a, (int)i); }
+
+// RGB of the texel at the index, from 0 to 255
+inline void laneTexels(const unsigned* texels, lanef index, lanef* rgb)
+{
+	unsigned t = texels[(int)index];
+	rgb[0] = (float)(t & 0xff);
+	rgb[1] = (float)((t >> 8) & 0xff);
+	rgb[2] = (float)((t >> 16) & 0xff);
+}
+
+// write the pixel if covered, the colors scaled to 0..255 and rounded
+inline void laneStorePixels(unsigned* p, const lanef* rgb, lanem m)
+{
+	if(m) *p = (unsigned)rgb[0] | ((unsigned)rgb[1] << 8) | ((unsigned)rgb[2] << 16) | 0xff000000;
+}
+
+#endif // SOFT_AVX2
+
+// log2 of positive numbers, the atanh series of the mantissa
+inline lanef laneLog2(lanef x)
+{
+	lanef exponent, mantissa;
+	laneSplit(x, exponent, mantissa);
+	lanef t = laneDiv(laneSub(mantissa, laneSet(1)), laneAdd(mantissa, laneSet(1)));
+	lanef t2 = laneMul(t, t);
+	lanef s = laneAdd(laneMul(laneSet(1.0f / 9), t2), laneSet(1.0f / 7));
+	s = laneAdd(laneMul(s, t2), laneSet(1.0f / 5));
+	s = laneAdd(laneMul(s, t2), laneSet(1.0f / 3));
+	s = laneAdd(laneMul(s, t2), laneSet(1));
+	return laneAdd(exponent, laneMul(laneMul(t, s), laneSet(2.885390082f))); // 2 / ln 2
+}
+
+// 2^y for y in [-126, 0], the Taylor series of the fraction
+inline lanef laneExp2(lanef y)
+{
+	lanef i = laneFloor(y);
+	lanef f = laneSub(y, i);
+	lanef p = laneAdd(laneMul(laneSet(1.540353e-4f), f), laneSet(1.333355e-3f));
+	p = laneAdd(laneMul(p, f), laneSet(9.618129e-3f));
+	p = laneAdd(laneMul(p, f), laneSet(5.550411e-2f));
+	p = laneAdd(laneMul(p, f), laneSet(2.402265e-1f));
+	p = laneAdd(laneMul(p, f), laneSet(6.931472e-1f));
+	p = laneAdd(laneMul(p, f), laneSet(1));
+	return laneScale(p, i);
+}
+
+// x^s for x in [0, 1], 0 for x = 0
+inline lanef lanePow(lanef x, float s)
+{
+	lanef y = laneMul(laneLog2(laneMax(x, laneSet(1e-30f))), laneSet(s));
+	return laneExp2(laneMax(y, laneSet(-126)));
+}
+
+inline lanef laneDot(const lanef* a, const lanef* b)
+{
+	return laneAdd(laneAdd(laneMul(a[0], b[0]), laneMul(a[1], b[1])), laneMul(a[2], b[2]));
+}
+
+inline void laneNormalize(lanef* v)
+{
+	lanef r = laneRsqrt(laneDot(v, v));
+	v[0] = laneMul(v[0], r);
+	v[1] = laneMul(v[1], r);
+	v[2] = laneMul(v[2], r);
+}
+
+// color packed as the pixels are, red in the low byte
+static unsigned packPixel(const vec4& color)
+{
+	unsigned pixel = 0xff000000;
+	for(int i = 0; i < 3; i++)
+	{
+		float c = color[i] < 0 ? 0 : color[i] > 1 ? 1 : color[i];
+		pixel |= (unsigned)(c * 255 + 0.5f) << (8 * i);
+	}
+	return pixel;
+}
+
+SoftRenderer::SoftRenderer(int nThreads) : width(0), height(0), stride(0), tilesX(0), tilesY(0), flash(0), clearPixel(0xff000000), nTriangles(0), frameStart(0),
+	generation(0), pending(0), quit(false), phase(geometryPhase), taskCount(0), steals(0)
+{
+	stats.draws = stats.triangles = stats.setup = stats.binned = stats.steals = 0;
+	stats.geometryTime = stats.rasterTime = 0;
+
+	// the calling thread works as the first thread of the pool
+	if(nThreads <= 0)
+	{
+		nThreads = (int)std::thread::hardware_concurrency();
+		if(nThreads > softMaxThreads) nThreads = softMaxThreads;
+		if(nThreads < 1) nThreads = 1;
+	}
+	queues = new TaskQueue[nThreads];
+	for(int i = 0; i < nThreads; i++)
+	{
+		queues[i].range = 0;
+		tileBuffers.push_back(new TileBuffers);
+	}
+	bins.resize(nThreads * softTasksPerThread);
+	for(int i = 1; i < nThreads; i++)
+	{
+		workers.push_back(std::thread(&SoftRenderer::workerLoop, this, i));
+	}
+}
+
+SoftRenderer::~SoftRenderer()
+{
+	// stop the workers
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	startCondition.notify_all();
+	for(int i = 0; i < (int)workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+	for(int i = 0; i < (int)tileBuffers.size(); i++)
+	{
+		delete tileBuffers[i];
+	}
+	delete [] queues;
+}
+
+// copy the triangle list, returns the mesh ID
+int SoftRenderer::addMesh(const vec3* vertices, const vec3* normals, const vec2* texcoords, int nVertices)
+{
+	Mesh mesh;
+	mesh.nVertices = nVertices - nVertices % 3;
+	meshes.push_back(mesh);
+
+	Mesh& m = meshes.back();
+	for(int i = 0; i < m.nVertices; i++)
+	{
+		m.x.push_back(vertices[i].x);
+		m.y.push_back(vertices[i].y);
+		m.z.push_back(vertices[i].z);
+		m.nx.push_back(normals[i].x);
+		m.ny.push_back(normals[i].y);
+		m.nz.push_back(normals[i].z);
+		m.s.push_back(texcoords[i].x);
+		m.t.push_back(texcoords[i].y);
+	}
+	return (int)meshes.size() - 1;
+}
+
+// keep the RGB texture as packed texels
+void SoftRenderer::addTexture(int index, const GLubyte* data, int width, int height)
+{
+	if(index >= (int)textures.size()) textures.resize(index + 1);
+	Texture& texture = textures[index];
+	texture.width = width;
+	texture.height = height;
+	texture.texels.resize(width * height);
+	for(int i = 0; i < width * height; i++)
+	{
+		texture.texels[i] = data[3 * i] | (data[3 * i + 1] << 8) | (data[3 * i + 2] << 16) | 0xff000000;
+	}
+}
+
+// size the color buffer and the tile bins
+void SoftRenderer::resize(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	tilesX = (width + softTileSize - 1) / softTileSize;
+	tilesY = (height + softTileSize - 1) / softTileSize;
+	stride = tilesX * softTileSize;
+	colorBuffer.assign(stride * tilesY * softTileSize, clearPixel);
+	for(int i = 0; i < (int)bins.size(); i++)
+	{
+		bins[i].tiles.resize(tilesX * tilesY);
+	}
+}
+
+// start a frame with the lights in world coordinates
+void SoftRenderer::begin(const mat4& viewMatrix, const mat4& projMatrix, const Light* lights, const vec3& spotDirection, float flash, const vec4& clearColor)
+{
+	frameStart = currentTime();
+	this->projMatrix = projMatrix;
+	this->lights[0] = lights[0];
+	this->lights[1] = lights[1];
+	this->flash = flash;
+	draws.clear();
+	nTriangles = 0;
+
+	// the light positions and the spot direction in camera space, as the shader finds them
+	for(int i = 0; i < 2; i++)
+	{
+		vec4 p = viewMatrix * lights[i].position;
+		lightPositions[i] = vec3(p.x, p.y, p.z);
+	}
+	vec4 d = viewMatrix * vec4(spotDirection, 0);
+	this->spotDirection = normalize(vec3(d.x, d.y, d.z));
+	clearPixel = packPixel(clearColor);
+}
+
+// collect a draw of the mesh
+void SoftRenderer::add(int mesh, int texture, const mat4& modelViewMatrix, const Material& material, const vec4& clipRect)
+{
+	if(mesh < 0 || mesh >= (int)meshes.size()) return;
+
+	Draw draw;
+	draw.mesh = mesh;
+	draw.texture = texture;
+	draw.modelViewMatrix = modelViewMatrix;
+	lightProducts(lights[0], material, 1, draw.products[0]);
+	lightProducts(lights[1], material, flash, draw.products[1]);
+	draw.shininess = material.shininess;
+	draw.firstTriangle = nTriangles;
+	draw.clipRect = clipRect;
+	draw.clipped = clipRect.x > -1 || clipRect.y > -1 || clipRect.z < 1 || clipRect.w < 1;
+	nTriangles += meshes[mesh].nVertices / 3;
+	draws.push_back(draw);
+}
+
+// transform and bin the collected triangles, then rasterize the tiles
+void SoftRenderer::end()
+{
+	PROFILE_ZONE("soft render");
+	stats.draws = (int)draws.size();
+	stats.triangles = nTriangles;
+	steals = 0;
+
+	double start = currentTime();
+	runTasks(geometryPhase, (int)bins.size());
+	stats.setup = stats.binned = 0;
+	for(int i = 0; i < (int)bins.size(); i++)
+	{
+		stats.setup += (int)bins[i].triangles.size();
+		for(int j = 0; j < tilesX * tilesY; j++)
+		{
+			stats.binned += (int)bins[i].tiles[j].size();
+		}
+	}
+	double geometryEnd = currentTime();
+	stats.geometryTime = geometryEnd - start;
+
+	runTasks(rasterPhase, tilesX * tilesY);
+	stats.rasterTime = currentTime() - geometryEnd;
+	stats.steals = steals;
+}
+
+// hand the tasks out to the queues and work on them with the workers
+void SoftRenderer::runTasks(Phase phase, int nTasks)
+{
+	int nThreads = getThreadCount();
+	for(int i = 0; i < nThreads; i++)
+	{
+		unsigned long long first = (unsigned long long)nTasks * i / nThreads;
+		unsigned long long end = (unsigned long long)nTasks * (i + 1) / nThreads;
+		queues[i].range = first << 32 | end;
+	}
+	this->phase = phase;
+	taskCount = nTasks;
+
+	// wake the workers up
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending = nThreads - 1;
+		generation++;
+	}
+	startCondition.notify_all();
+
+	workTasks(0);
+
+	// wait for the tasks of the others
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while(pending > 0) doneCondition.wait(lock);
+	}
+}
+
+// worker thread waiting for the phases
+void SoftRenderer::workerLoop(int thread)
+{
+	PROFILE_THREAD("soft worker");
+	ALLOC_SCOPE("soft");
+	int seen = 0;
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while(!quit && generation == seen) startCondition.wait(lock);
+			if(quit) return;
+			seen = generation;
+		}
+
+		workTasks(thread);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending--;
+		}
+		doneCondition.notify_one();
+	}
+}
+
+// run the tasks of the own queue, then the ones stolen from the others
+void SoftRenderer::workTasks(int thread)
+{
+	int task;
+	while(popTask(thread, task) || stealTask(thread, task))
+	{
+		if(phase == geometryPhase) transformTriangles(task, taskCount);
+			else rasterizeTile(task, thread);
+	}
+}
+
+// take the first task of the own queue
+bool SoftRenderer::popTask(int thread, int& task)
+{
+	std::atomic<unsigned long long>& range = queues[thread].range;
+	unsigned long long r = range.load();
+	for(;;)
+	{
+		unsigned first = (unsigned)(r >> 32), end = (unsigned)r;
+		if(first >= end) return false;
+		if(range.compare_exchange_weak(r, (unsigned long long)(first + 1) << 32 | end))
+		{
+			task = (int)first;
+			return true;
+		}
+	}
+}
+
+// take the last task of another queue
+bool SoftRenderer::stealTask(int thread, int& task)
+{
+	int nThreads = getThreadCount();
+	for(int i = 1; i < nThreads; i++)
+	{
+		std::atomic<unsigned long long>& range = queues[(thread + i) % nThreads].range;
+		unsigned long long r = range.load();
+		for(;;)
+		{
+			unsigned first = (unsigned)(r >> 32), end = (unsigned)r;
+			if(first >= end) break;
+			if(range.compare_exchange_weak(r, (unsigned long long)first << 32 | (end - 1)))
+			{
+				task = (int)end - 1;
+				steals++;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// transform the triangles of one part of the frame and bin them into the tiles
+void SoftRenderer::transformTriangles(int task, int nTasks)
+{
+	PROFILE_ZONE("soft geometry");
+	GeometryBin& bin = bins[task];
+	bin.triangles.clear();
+	for(int i = 0; i < (int)bin.tiles.size(); i++)
+	{
+		bin.tiles[i].clear();
+	}
+
+	int first = (int)((long long)nTriangles * task / nTasks);
+	int last = (int)((long long)nTriangles * (task + 1) / nTasks);
+	if(first >= last) return;
+
+	// clip, camera and normal coordinates of a batch of vertices
+	Arena& arena = threadArena();
+	ArenaMark mark(arena);
+	GLfloat* scratch = arena.allocateArray<GLfloat>(10 * softBatchVertices);
+	std::vector<GLfloat> heapScratch;
+	if(!scratch)
+	{
+		heapScratch.resize(10 * softBatchVertices);
+		scratch = &heapScratch[0];
+	}
+	GLfloat* out[10];
+	for(int i = 0; i < 10; i++) out[i] = scratch + i * softBatchVertices;
+	vec4SoA clip = {out[0], out[1], out[2], out[3]};
+	vec3SoA eye = {out[4], out[5], out[6]};
+	vec3SoA normal = {out[7], out[8], out[9]};
+
+	// the draws overlapping the range of triangles
+	int d = 0;
+	while(d + 1 < (int)draws.size() && draws[d + 1].firstTriangle <= first) d++;
+	for(; d < (int)draws.size() && draws[d].firstTriangle < last; d++)
+	{
+		const Draw& draw = draws[d];
+		Mesh& mesh = meshes[draw.mesh];
+		int begin = (first > draw.firstTriangle ? first - draw.firstTriangle : 0) * 3;
+		int end = (last - draw.firstTriangle) * 3;
+		if(end > mesh.nVertices) end = mesh.nVertices;
+		mat4 clipMatrix = projMatrix * draw.modelViewMatrix;
+
+		for(int v = begin; v < end; v += softBatchVertices)
+		{
+			int n = end - v < softBatchVertices ? end - v : softBatchVertices;
+			vec3SoA position = {&mesh.x[v], &mesh.y[v], &mesh.z[v]};
+			vec3SoA direction = {&mesh.nx[v], &mesh.ny[v], &mesh.nz[v]};
+			transformPoints(clipMatrix, position, clip, n);
+			transformPoints(draw.modelViewMatrix, position, eye, n);
+			transformDirections(draw.modelViewMatrix, direction, normal, n);
+
+			for(int i = 0; i < n; i += 3)
+			{
+				float vertices[3][12];
+				for(int j = 0; j < 3; j++)
+				{
+					for(int k = 0; k < 10; k++) vertices[j][k] = out[k][i + j];
+					vertices[j][10] = mesh.s[v + i + j];
+					vertices[j][11] = mesh.t[v + i + j];
+				}
+				setupTriangle(bin, d, vertices);
+			}
+		}
+	}
+}
+
+// clip the triangle, cull the back faces and bin what is left into the tiles
+void SoftRenderer::setupTriangle(GeometryBin& bin, int draw, float vertices[][12])
+{
+	// triangles outside of one frustum plane are gone
+	int outside = 0x3f;
+	bool inGuardBand = true;
+	for(int i = 0; i < 3; i++)
+	{
+		const float* v = vertices[i];
+		int code = (v[0] < -v[3] ? 1 : 0) | (v[0] > v[3] ? 2 : 0) | (v[1] < -v[3] ? 4 : 0) | (v[1] > v[3] ? 8 : 0) | (v[2] < -v[3] ? 16 : 0) | (v[2] > v[3] ? 32 : 0);
+		outside &= code;
+		float g = softGuardBand * v[3];
+		if(code & 48 || v[0] < -g || v[0] > g || v[1] < -g || v[1] > g) inGuardBand = false;
+	}
+	if(outside) return;
+
+	// the rectangle of a draw seen through a portal clips like four more planes,
+	// x >= xmin w, x <= xmax w, y >= ymin w and y <= ymax w
+	const Draw& d = draws[draw];
+	float rect[4] = {-d.clipRect.x, d.clipRect.z, -d.clipRect.y, d.clipRect.w};
+	if(d.clipped)
+	{
+		outside = 0xf;
+		for(int i = 0; i < 3; i++)
+		{
+			const float* v = vertices[i];
+			outside &= (v[0] < d.clipRect.x * v[3] ? 1 : 0) | (v[0] > d.clipRect.z * v[3] ? 2 : 0) | (v[1] < d.clipRect.y * v[3] ? 4 : 0) | (v[1] > d.clipRect.w * v[3] ? 8 : 0);
+		}
+		if(outside) return;
+	}
+
+	// Sutherland-Hodgman against the near and far planes and the guard band,
+	// then against the rectangle of the draw
+	float polygons[2][13][12]; // a corner more for every plane cutting the triangle
+	memcpy(polygons[0], vertices, sizeof(float) * 36);
+	int n = 3, current = 0;
+	for(int plane = inGuardBand ? 6 : 0; plane < (d.clipped ? 10 : 6); plane++)
+	{
+		const float (*in)[12] = polygons[current];
+		float (*out)[12] = polygons[1 - current];
+		int m = 0;
+		for(int i = 0; i < n; i++)
+		{
+			const float* a = in[i];
+			const float* b = in[(i + 1) % n];
+			float w = plane < 2 ? 1 : plane < 6 ? softGuardBand : rect[plane - 6];
+			int axis = plane < 2 ? 2 : plane < 4 || (plane >= 6 && plane < 8) ? 0 : 1;
+			float sign = plane & 1 ? -1.0f : 1.0f;
+			float da = a[3] * w + a[axis] * sign;
+			float db = b[3] * w + b[axis] * sign;
+			if(da >= 0) memcpy(out[m++], a, sizeof(float) * 12);
+			if((da >= 0) != (db >= 0))
+			{
+				float t = da / (da - db);
+				for(int k = 0; k < 12; k++) out[m][k] = a[k] + (b[k] - a[k]) * t;
+				m++;
+			}
+		}
+		n = m;
+		current = 1 - current;
+		if(n < 3) return;
+	}
+	const float (*polygon)[12] = polygons[current];
+
+	// project the corners onto the screen, y going down
+	float x[13], y[13], z[13], iw[13];
+	for(int i = 0; i < n; i++)
+	{
+		iw[i] = 1 / polygon[i][3];
+		x[i] = (polygon[i][0] * iw[i] * 0.5f + 0.5f) * width;
+		y[i] = (0.5f - polygon[i][1] * iw[i] * 0.5f) * height;
+		z[i] = polygon[i][2] * iw[i];
+	}
+
+	// split into a fan, the front faces turn clockwise on the screen
+	for(int i = 1; i + 1 < n; i++)
+	{
+		int k[3] = {0, i, i + 1};
+		float area = (x[k[1]] - x[k[0]]) * (y[k[2]] - y[k[0]]) - (x[k[2]] - x[k[0]]) * (y[k[1]] - y[k[0]]);
+		if(!(area < 0)) continue;
+
+		float fxmin = x[k[0]], fxmax = x[k[0]], fymin = y[k[0]], fymax = y[k[0]];
+		for(int j = 1; j < 3; j++)
+		{
+			fxmin = x[k[j]] < fxmin ? x[k[j]] : fxmin;
+			fxmax = x[k[j]] > fxmax ? x[k[j]] : fxmax;
+			fymin = y[k[j]] < fymin ? y[k[j]] : fymin;
+			fymax = y[k[j]] > fymax ? y[k[j]] : fymax;
+		}
+		int xmin = fxmin < 0 ? 0 : (int)fxmin;
+		int xmax = fxmax > width - 1 ? width - 1 : (int)fxmax;
+		int ymin = fymin < 0 ? 0 : (int)fymin;
+		int ymax = fymax > height - 1 ? height - 1 : (int)fymax;
+		if(xmin > xmax || ymin > ymax) continue;
+
+		Triangle t;
+		t.x0 = x[k[0]];
+		t.y0 = y[k[0]];
+		t.xmin = xmin;
+		t.xmax = xmax;
+		t.ymin = ymin;
+		t.ymax = ymax;
+		t.draw = draw;
+
+		// edge functions from every corner to the next, relative to the first corner
+		for(int j = 0; j < 3; j++)
+		{
+			int a = k[j], b = k[(j + 1) % 3];
+			t.a[j] = y[b] - y[a];
+			t.b[j] = x[a] - x[b];
+			t.c[j] = t.a[j] * (t.x0 - x[a]) + t.b[j] * (t.y0 - y[a]);
+		}
+
+		// depth, 1 / w and the varyings over w are linear on the screen
+		float values[3][10];
+		for(int j = 0; j < 3; j++)
+		{
+			values[j][0] = z[k[j]];
+			values[j][1] = iw[k[j]];
+			for(int v = 0; v < 8; v++) values[j][2 + v] = polygon[k[j]][4 + v] * iw[k[j]];
+		}
+		float x1 = x[k[1]] - t.x0, y1 = y[k[1]] - t.y0, x2 = x[k[2]] - t.x0, y2 = y[k[2]] - t.y0;
+		for(int p = 0; p < 10; p++)
+		{
+			float v1 = values[1][p] - values[0][p], v2 = values[2][p] - values[0][p];
+			t.planes[p][0] = values[0][p];
+			t.planes[p][1] = (v1 * y2 - v2 * y1) / area;
+			t.planes[p][2] = (x1 * v2 - x2 * v1) / area;
+		}
+
+		// the tiles under the bounds
+		int index = (int)bin.triangles.size();
+		bin.triangles.push_back(t);
+		for(int ty = ymin / softTileSize; ty <= ymax / softTileSize; ty++)
+		{
+			for(int tx = xmin / softTileSize; tx <= xmax / softTileSize; tx++)
+			{
+				bin.tiles[ty * tilesX + tx].push_back(index);
+			}
+		}
+	}
+}
+
+// find the visible triangle of every pixel of the tile, then shade them
+void SoftRenderer::rasterizeTile(int tile, int thread)
+{
+	PROFILE_ZONE("soft tile");
+	TileBuffers& buffers = *tileBuffers[thread];
+	int tileX = (tile % tilesX) * softTileSize;
+	int tileY = (tile / tilesX) * softTileSize;
+	for(int i = 0; i < softTileSize * softTileSize; i++)
+	{
+		buffers.depth[i] = 1;
+		buffers.ids[i] = -1;
+	}
+
+	// depth test of the triangles in the order of the draws, the nearest keeps the pixel
+	float id = 0;
+	lanef ramp = laneAdd(laneRamp(), laneSet(0.5f));
+	lanef zero = laneSet(0);
+	for(int b = 0; b < (int)bins.size(); b++)
+	{
+		const GeometryBin& bin = bins[b];
+		const std::vector<int>& list = bin.tiles[tile];
+		for(int i = 0; i < (int)list.size(); i++, id++)
+		{
+			const Triangle& t = bin.triangles[list[i]];
+			int x0 = (t.xmin > tileX ? t.xmin : tileX) & ~(laneWidth - 1);
+			int x1 = t.xmax < tileX + softTileSize - 1 ? t.xmax : tileX + softTileSize - 1;
+			int y0 = t.ymin > tileY ? t.ymin : tileY;
+			int y1 = t.ymax < tileY + softTileSize - 1 ? t.ymax : tileY + softTileSize - 1;
+			lanef a0 = laneSet(t.a[0]), a1 = laneSet(t.a[1]), a2 = laneSet(t.a[2]);
+			lanef dzdx = laneSet(t.planes[0][1]), triangle = laneSet(id);
+
+			for(int y = y0; y <= y1; y++)
+			{
+				float dy = y + 0.5f - t.y0;
+				lanef e0 = laneSet(t.b[0] * dy + t.c[0]);
+				lanef e1 = laneSet(t.b[1] * dy + t.c[1]);
+				lanef e2 = laneSet(t.b[2] * dy + t.c[2]);
+				lanef zr = laneSet(t.planes[0][0] + t.planes[0][2] * dy);
+				float* depth = buffers.depth + (y - tileY) * softTileSize - tileX;
+				float* ids = buffers.ids + (y - tileY) * softTileSize - tileX;
+				for(int x = x0; x <= x1; x += laneWidth)
+				{
+					// edge functions of laneWidth pixel centers
+					lanef dx = laneAdd(laneSet(x - t.x0), ramp);
+					lanem inside = laneAnd(laneAnd(laneGreaterEqual(laneAdd(laneMul(a0, dx), e0), zero),
+						laneGreaterEqual(laneAdd(laneMul(a1, dx), e1), zero)), laneGreaterEqual(laneAdd(laneMul(a2, dx), e2), zero));
+					if(laneBits(inside) == 0) continue;
+
+					lanef z = laneAdd(laneMul(dzdx, dx), zr);
+					lanef old = laneLoad(depth + x);
+					lanem nearer = laneAnd(inside, laneLess(z, old));
+					if(laneBits(nearer) == 0) continue;
+					laneStore(depth + x, laneSelect(nearer, z, old));
+					laneStore(ids + x, laneSelect(nearer, triangle, laneLoad(ids + x)));
+				}
+			}
+		}
+	}
+
+	// the background, then every triangle shades the pixels it kept
+	for(int y = 0; y < softTileSize; y++)
+	{
+		unsigned* row = &colorBuffer[(tileY + y) * stride + tileX];
+		for(int x = 0; x < softTileSize; x++) row[x] = clearPixel;
+	}
+	id = 0;
+	for(int b = 0; b < (int)bins.size(); b++)
+	{
+		const GeometryBin& bin = bins[b];
+		const std::vector<int>& list = bin.tiles[tile];
+		for(int i = 0; i < (int)list.size(); i++, id++)
+		{
+			shadeTriangle(bin.triangles[list[i]], id, tileX, tileY, buffers);
+		}
+	}
+}
+
+// the lighting of the fragment shader on the pixels the triangle kept
+void SoftRenderer::shadeTriangle(const Triangle& t, float id, int tileX, int tileY, const TileBuffers& buffers)
+{
+	const Draw& draw = draws[t.draw];
+	int x0 = (t.xmin > tileX ? t.xmin : tileX) & ~(laneWidth - 1);
+	int x1 = t.xmax < tileX + softTileSize - 1 ? t.xmax : tileX + softTileSize - 1;
+	int y0 = t.ymin > tileY ? t.ymin : tileY;
+	int y1 = t.ymax < tileY + softTileSize - 1 ? t.ymax : tileY + softTileSize - 1;
+
+	// the texture, white without one
+	static const unsigned white = 0xffffffff;
+	const unsigned* texels = &white;
+	float textureWidth = 1, textureHeight = 1;
+	if(draw.texture >= 0 && draw.texture < (int)textures.size() && !textures[draw.texture].texels.empty())
+	{
+		const Texture& texture = textures[draw.texture];
+		texels = &texture.texels[0];
+		textureWidth = (float)texture.width;
+		textureHeight = (float)texture.height;
+	}
+	lanef tw = laneSet(textureWidth), th = laneSet(textureHeight);
+	lanef tiw = laneSet(1 / textureWidth), tih = laneSet(1 / textureHeight);
+
+	// the spot light is skipped while the flashlight is off, its products are 0
+	int nLights = flash != 0 ? 2 : 1;
+	lanef lightPosition[2][3], products[2][3][3], spot[3];
+	for(int i = 0; i < nLights; i++)
+	{
+		for(int c = 0; c < 3; c++)
+		{
+			lightPosition[i][c] = laneSet(lightPositions[i][c]);
+			for(int p = 0; p < 3; p++) products[i][p][c] = laneSet(draw.products[i][p][c]);
+		}
+	}
+	for(int c = 0; c < 3; c++) spot[c] = laneSet(-spotDirection[c]);
+
+	lanef ramp = laneAdd(laneRamp(), laneSet(0.5f));
+	lanef zero = laneSet(0), one = laneSet(1), half = laneSet(0.5f);
+	lanef triangle = laneSet(id);
+	lanef ddx[9];
+	for(int p = 0; p < 9; p++) ddx[p] = laneSet(t.planes[1 + p][1]);
+
+	for(int y = y0; y <= y1; y++)
+	{
+		float dy = y + 0.5f - t.y0;
+		lanef rows[9];
+		for(int p = 0; p < 9; p++) rows[p] = laneSet(t.planes[1 + p][0] + t.planes[1 + p][2] * dy);
+		const float* ids = buffers.ids + (y - tileY) * softTileSize - tileX;
+		unsigned* pixels = &colorBuffer[y * stride];
+
+		for(int x = x0; x <= x1; x += laneWidth)
+		{
+			lanem kept = laneEqual(laneLoad(ids + x), triangle);
+			if(laneBits(kept) == 0) continue;
+
+			// perspective correct varyings, the position and the normal in camera space
+			lanef dx = laneAdd(laneSet(x - t.x0), ramp);
+			lanef w = laneDiv(one, laneAdd(laneMul(ddx[0], dx), rows[0]));
+			lanef varyings[8];
+			for(int p = 0; p < 8; p++) varyings[p] = laneMul(laneAdd(laneMul(ddx[1 + p], dx), rows[1 + p]), w);
+			lanef* position = varyings;
+			lanef* N = varyings + 3;
+			lanef V[3] = {laneSub(zero, position[0]), laneSub(zero, position[1]), laneSub(zero, position[2])};
+			laneNormalize(V);
+			laneNormalize(N);
+
+			// ambient, diffuse and specular terms of the lights
+			lanef total[3] = {zero, zero, zero};
+			for(int i = 0; i < nLights; i++)
+			{
+				lanef L[3], H[3];
+				for(int c = 0; c < 3; c++) L[c] = laneSub(lightPosition[i][c], position[c]);
+				laneNormalize(L);
+				for(int c = 0; c < 3; c++) H[c] = laneAdd(L[c], V[c]);
+				laneNormalize(H);
+
+				lanef LN = laneDot(L, N);
+				lanef kd = laneMax(LN, zero);
+				lanem lit = laneGreater(LN, zero);
+				lanef ks = zero;
+				if(laneBits(lit)) ks = laneSelect(lit, lanePow(laneMax(laneDot(N, H), zero), draw.shininess), zero);
+
+				lanef color[3];
+				for(int c = 0; c < 3; c++)
+				{
+					color[c] = laneAdd(laneAdd(products[i][0][c], laneMul(kd, products[i][1][c])), laneMul(ks, products[i][2][c]));
+				}
+
+				// the flashlight cone fading out from the spot direction
+				if(i == 1)
+				{
+					lanef cone = laneMul(laneSet(30), laneSub(laneDot(spot, L), laneSet(0.95f)));
+					cone = laneMin(laneMax(cone, zero), one);
+					for(int c = 0; c < 3; c++) color[c] = laneMul(color[c], cone);
+				}
+				for(int c = 0; c < 3; c++) total[c] = laneAdd(total[c], color[c]);
+			}
+
+			// bilinear texture filtering with the coordinates repeating, the pixels
+			// not kept read the first texel as their varyings may be anything
+			lanef u = laneSelect(kept, laneSub(laneMul(varyings[6], tw), half), zero);
+			lanef v = laneSelect(kept, laneSub(laneMul(varyings[7], th), half), zero);
+			u = laneSub(u, laneMul(laneFloor(laneMul(u, tiw)), tw));
+			v = laneSub(v, laneMul(laneFloor(laneMul(v, tih)), th));
+			lanef u0 = laneMax(laneMin(laneFloor(u), laneSub(tw, one)), zero);
+			lanef v0 = laneMax(laneMin(laneFloor(v), laneSub(th, one)), zero);
+			lanef fu = laneSub(u, u0), fv = laneSub(v, v0);
+			lanef u1 = laneAdd(u0, one), v1 = laneAdd(v0, one);
+			u1 = laneSelect(laneGreaterEqual(u1, tw), zero, u1);
+			v1 = laneSelect(laneGreaterEqual(v1, th), zero, v1);
+			lanef row0 = laneMul(v0, tw), row1 = laneMul(v1, tw);
+			lanef t00[3], t10[3], t01[3], t11[3];
+			laneTexels(texels, laneAdd(row0, u0), t00);
+			laneTexels(texels, laneAdd(row0, u1), t10);
+			laneTexels(texels, laneAdd(row1, u0), t01);
+			laneTexels(texels, laneAdd(row1, u1), t11);
+
+			// the lit color times the texture color, rounded to 0..255
+			lanef rgb[3];
+			for(int c = 0; c < 3; c++)
+			{
+				lanef top = laneAdd(t00[c], laneMul(laneSub(t10[c], t00[c]), fu));
+				lanef bottom = laneAdd(t01[c], laneMul(laneSub(t11[c], t01[c]), fu));
+				lanef texel = laneAdd(top, laneMul(laneSub(bottom, top), fv));
+				lanef color = laneMul(total[c], texel);
+				rgb[c] = laneAdd(laneMin(laneMax(color, zero), laneSet(255)), half);
+			}
+			laneStorePixels(pixels + x, rgb, kept);
+		}
+	}
+}
+
+// save the color buffer as a raw PPM file
+bool SoftRenderer::writeFrame(const char* filename) const
+{
+	FILE* file = fopen(filename, "wb");
+	if(!file) return false;
+
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	std::vector<GLubyte> row(width * 3);
+	for(int y = 0; y < height; y++)
+	{
+		const unsigned* pixel = &colorBuffer[y * stride];
+		for(int x = 0; x < width; x++)
+		{
+			row[3 * x] = (GLubyte)(pixel[x] & 0xff);
+			row[3 * x + 1] = (GLubyte)((pixel[x] >> 8) & 0xff);
+			row[3 * x + 2] = (GLubyte)((pixel[x] >> 16) & 0xff);
+		}
+		fwrite(&row[0], 1, width * 3, file);
+	}
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,169 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- softrender.h ---
+//
+//   Tile-based software rasterizer drawing the scene on the CPU with the
+//   lighting of the v120 shaders.  The draws of a frame are collected,
+//   their triangles are transformed, clipped, culled and binned into
+//   screen tiles, then the tiles are rasterized and shaded in parallel.
+//   A pool of worker threads takes the tasks of both phases from
+//   per-thread queues and steals from the others when its queue is empty.
+//   Every tile first resolves its visible triangle per pixel and shades
+//   each pixel once.  No OpenGL calls are made.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SOFTRENDER_H__
+#define __SOFTRENDER_H__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include "Angel.h"
+#include "scene.h"
+
+const int softTileSize = 64;      // tile width and height in pixels (multiple of 8)
+const int softTasksPerThread = 4; // geometry tasks of every thread, the triangles are split among them
+const int softBatchVertices = 768; // vertices transformed at once by the geometry tasks (multiple of 3)
+
+// software rendering statistics of the last frame
+struct SoftStats
+{
+	int draws;         // draws collected
+	int triangles;     // triangles submitted
+	int setup;         // triangles left after clipping and culling
+	int binned;        // triangle references in the tiles
+	int steals;        // tasks taken from the queue of another thread
+	double geometryTime; // transform, clipping and binning time in milliseconds
+	double rasterTime;   // rasterization and shading time in milliseconds
+};
+
+// CPU renderer of the textured and lit meshes
+class SoftRenderer
+{
+public:
+	SoftStats stats; // statistics of the last frame
+
+	SoftRenderer(int nThreads = 0);
+	~SoftRenderer();
+
+	int addMesh(const vec3* vertices, const vec3* normals, const vec2* texcoords, int nVertices);
+	void addTexture(int index, const GLubyte* data, int width, int height);
+	void resize(int width, int height);
+
+	void begin(const mat4& viewMatrix, const mat4& projMatrix, const Light* lights, const vec3& spotDirection, float flash, const vec4& clearColor);
+	void add(int mesh, int texture, const mat4& modelViewMatrix, const Material& material, const vec4& clipRect = vec4(-1, -1, 1, 1));
+	void end();
+
+	int getThreadCount() const { return (int)workers.size() + 1; }
+	const unsigned* pixels() const { return &colorBuffer[0]; } // RGBA rows from the top, getStride() apart
+	int getStride() const { return stride; }
+	bool writeFrame(const char* filename) const;
+
+private:
+	// mesh in structure-of-arrays layout for the batch transforms
+	struct Mesh
+	{
+		int nVertices;
+		std::vector<GLfloat> x, y, z, nx, ny, nz, s, t;
+	};
+
+	// RGBA texels with the rows of the image
+	struct Texture
+	{
+		int width, height;
+		std::vector<unsigned> texels;
+	};
+
+	// draw of the frame with the light products of its material
+	struct Draw
+	{
+		int mesh, texture;
+		mat4 modelViewMatrix;
+		vec4 products[2][3]; // ambient, diffuse and specular product of every light
+		float shininess;
+		int firstTriangle;   // triangles of the frame before this draw
+		vec4 clipRect;       // screen rectangle the triangles are clipped to, xmin, ymin, xmax and ymax in normalized device coordinates
+		bool clipped;        // the rectangle is smaller than the screen
+	};
+
+	// triangle set up for the tiles, the functions are taken at pixel (x, y)
+	// relative to the first corner, dx = x - x0 and dy = y - y0
+	struct Triangle
+	{
+		float a[3], b[3], c[3]; // edge functions a * dx + b * dy + c, positive inside
+		float x0, y0;           // screen position of the first corner
+		float planes[10][3];    // depth, 1 / w and the eight varyings over w as value + ddx * dx + ddy * dy
+		int xmin, ymin, xmax, ymax; // pixel bounds on the screen
+		int draw;
+	};
+
+	// output of one geometry task
+	struct GeometryBin
+	{
+		std::vector<Triangle> triangles;
+		std::vector<std::vector<int> > tiles; // triangles overlapping every tile
+	};
+
+	// range of tasks, the owner takes from the front and the thieves from the back
+	struct TaskQueue
+	{
+		std::atomic<unsigned long long> range; // first task in the high half, end in the low half
+		char padding[64 - sizeof(std::atomic<unsigned long long>)];
+	};
+
+	// per thread buffers of the tile being rasterized
+	struct TileBuffers
+	{
+		float depth[softTileSize * softTileSize];
+		float ids[softTileSize * softTileSize]; // visible triangle in the order of the tile, -1 for none
+	};
+
+	enum Phase { geometryPhase, rasterPhase };
+
+	std::vector<Mesh> meshes;
+	std::vector<Texture> textures;
+	std::vector<Draw> draws;
+	std::vector<GeometryBin> bins;
+
+	// color buffer padded to whole tiles
+	std::vector<unsigned> colorBuffer;
+	int width, height, stride, tilesX, tilesY;
+
+	// frame constants, the positions in camera space
+	Light lights[2];
+	float flash;
+	vec3 lightPositions[2];
+	vec3 spotDirection;
+	unsigned clearPixel;
+	mat4 projMatrix;
+	int nTriangles;
+	double frameStart;
+
+	// worker threads of the pool
+	std::vector<std::thread> workers;
+	std::vector<TileBuffers*> tileBuffers;
+	TaskQueue* queues;
+	std::mutex mutex;
+	std::condition_variable startCondition, doneCondition;
+	int generation, pending;
+	bool quit;
+	Phase phase;
+	int taskCount;
+	std::atomic<int> steals;
+
+	void runTasks(Phase phase, int nTasks);
+	void workerLoop(int thread);
+	void workTasks(int thread);
+	bool popTask(int thread, int& task);
+	bool stealTask(int thread, int& task);
+
+	void transformTriangles(int task, int nTasks);
+	void setupTriangle(GeometryBin& bin, int draw, float vertices[][12]);
+	void rasterizeTile(int tile, int thread);
+	void shadeTriangle(const Triangle& t, float id, int tileX, int tileY, const TileBuffers& buffers);
+};
+
+#endif // __SOFTRENDER_H__
@@ -0,0 +1,46 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <string.h>
+#include "Angel.h"
+#include "swapinterval.h"
+
+#if defined(_WIN32)
+typedef BOOL (WINAPI* SwapIntervalEXT)(int interval);
+#elif defined(__linux__)
+#include <GL/glx.h>
+typedef void (*SwapIntervalEXT)(Display* display, GLXDrawable drawable, int interval);
+typedef int (*SwapIntervalSGI)(int interval);
+#endif
+
+bool setSwapInterval(int interval)
+{
+#if defined(_WIN32)
+	SwapIntervalEXT swapInterval = (SwapIntervalEXT)wglGetProcAddress("wglSwapIntervalEXT");
+	return swapInterval && swapInterval(interval);
+#elif defined(__linux__)
+	// only the extensions in the list, glXGetProcAddress returns a pointer for any name
+	Display* display = glXGetCurrentDisplay();
+	GLXDrawable drawable = glXGetCurrentDrawable();
+	if(!display || !drawable) return false;
+	const char* extensions = glXQueryExtensionsString(display, DefaultScreen(display));
+	if(!extensions) return false;
+	if(strstr(extensions, "GLX_EXT_swap_control"))
+	{
+		SwapIntervalEXT swapInterval = (SwapIntervalEXT)glXGetProcAddress((const GLubyte*)"glXSwapIntervalEXT");
+		if(!swapInterval) return false;
+		swapInterval(display, drawable, interval);
+		return true;
+	}
+
+	// the SGI extension cannot turn the vsync off
+	if(strstr(extensions, "GLX_SGI_swap_control") && interval > 0)
+	{
+		SwapIntervalSGI swapInterval = (SwapIntervalSGI)glXGetProcAddress((const GLubyte*)"glXSwapIntervalSGI");
+		return swapInterval && swapInterval(interval) == 0;
+	}
+	return false;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,18 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- swapinterval.h ---
+//
+//   Swap interval of the current window through the platform extension,
+//   wglSwapIntervalEXT on Windows and glXSwapIntervalEXT, or the SGI one,
+//   on X11.  With an interval of 1 the buffer swap waits for the vsync.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SWAPINTERVAL_H__
+#define __SWAPINTERVAL_H__
+
+// set the vertical retraces the swaps of the current context wait for, 0 not
+// to wait, false if the platform offers no way to set it
+bool setSwapInterval(int interval);
+
+#endif // __SWAPINTERVAL_H__
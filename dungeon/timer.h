@@ -0,0 +1,72 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- timer.h ---
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include <chrono>
+#include <thread>
+#include <math.h>
+
+// current time of the monotonic clock in milliseconds
+inline double currentTime()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// sleep until the given time of the monotonic clock
+inline void sleepUntil(double time)
+{
+	double delay = time - currentTime();
+	if(delay > 0) std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(delay));
+}
+
+// simulation clock advancing in fixed steps to catch up with the real time
+class FixedTimestep
+{
+public:
+	double step;  // step length in milliseconds
+	double time;  // simulated time in milliseconds
+	double alpha; // fraction of a step the real time is ahead of the simulation
+
+	FixedTimestep(double rate, int maxSteps = 8) : step(1000 / rate), time(0), alpha(0), maxSteps(maxSteps), accumulator(0), last(-1) {}
+
+	// number of steps to simulate up to the given real time
+	int advance(double now)
+	{
+		if(last < 0) last = now;
+		accumulator += now - last;
+		last = now;
+
+		// after a long stall drop the time that cannot be caught up with
+		int steps = (int)(accumulator / step);
+		if(steps > maxSteps)
+		{
+			steps = maxSteps;
+			accumulator = fmod(accumulator, step);
+		}
+		else accumulator -= steps * step;
+
+		time += steps * step;
+		alpha = accumulator / step;
+		return steps;
+	}
+
+	// restart from the given real time, the time passed while nothing was simulated is dropped
+	void resync(double now)
+	{
+		last = now;
+		accumulator = 0;
+		alpha = 0;
+	}
+
+private:
+	int maxSteps;       // steps simulated at most at once
+	double accumulator; // real time not simulated yet
+	double last;        // real time of the last advance
+};
+
+#endif // __TIMER_H__
@@ -0,0 +1,176 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- transform.h ---
+//
+//   Affine transformation kept as the top three rows of a mat4, the bottom
+//   row being (0, 0, 0, 1).  Composing two takes 36 multiplies where a mat4
+//   product takes 64, and the inverse and the normal matrix only invert the
+//   3x3 part.  The rows are combined in the order of the mat4 kernels, so a
+//   composed transform equals the mat4 product of the same matrices.  The
+//   scene graph works with transforms and turns them into a mat4 where they
+//   meet the projection or get uploaded.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TRANSFORM_H__
+#define __TRANSFORM_H__
+
+#include "Angel.h"
+
+class Transform
+{
+public:
+	vec4 rows[3]; // top rows of the matrix, the translation in w
+
+	constexpr Transform() : rows{vec4(1, 0, 0, 0), vec4(0, 1, 0, 0), vec4(0, 0, 1, 0)}
+	{
+	}
+
+	// the top rows of an affine matrix
+	explicit constexpr Transform(const mat4& m) : rows{m[0], m[1], m[2]}
+	{
+	}
+
+	constexpr const vec4& operator[](int i) const { return rows[i]; }
+
+	// the full matrix
+	constexpr mat4 toMat4() const
+	{
+		return mat4(rows[0], rows[1], rows[2], vec4(0, 0, 0, 1));
+	}
+
+	vec3 translation() const
+	{
+		return vec3(rows[0].w, rows[1].w, rows[2].w);
+	}
+
+	// this * t, the transformation t followed by this one
+	Transform operator*(const Transform& t) const
+	{
+		Transform c;
+#if defined(ANGEL_SSE)
+		// the rows of t weighted by the rows of this, the bottom row of t being (0, 0, 0, 1)
+		__m128 t0 = _mm_loadu_ps(&t.rows[0].x);
+		__m128 t1 = _mm_loadu_ps(&t.rows[1].x);
+		__m128 t2 = _mm_loadu_ps(&t.rows[2].x);
+		__m128 t3 = _mm_set_ps(1, 0, 0, 0);
+		for(int i = 0; i < 3; i++)
+		{
+			__m128 row = _mm_loadu_ps(&rows[i].x);
+			__m128 r = _mm_mul_ps(ANGEL_SWIZZLE(row, 0, 0, 0, 0), t0);
+			r = _mm_add_ps(r, _mm_mul_ps(ANGEL_SWIZZLE(row, 1, 1, 1, 1), t1));
+			r = _mm_add_ps(r, _mm_mul_ps(ANGEL_SWIZZLE(row, 2, 2, 2, 2), t2));
+			r = _mm_add_ps(r, _mm_mul_ps(ANGEL_SWIZZLE(row, 3, 3, 3, 3), t3));
+			_mm_storeu_ps(&c.rows[i].x, r);
+		}
+#elif defined(ANGEL_NEON)
+		float32x4_t t0 = vld1q_f32(&t.rows[0].x);
+		float32x4_t t1 = vld1q_f32(&t.rows[1].x);
+		float32x4_t t2 = vld1q_f32(&t.rows[2].x);
+		float32x4_t t3 = vsetq_lane_f32(1, vdupq_n_f32(0), 3);
+		for(int i = 0; i < 3; i++)
+		{
+			float32x4_t r = vmulq_n_f32(t0, rows[i].x);
+			r = vaddq_f32(r, vmulq_n_f32(t1, rows[i].y));
+			r = vaddq_f32(r, vmulq_n_f32(t2, rows[i].z));
+			r = vaddq_f32(r, vmulq_n_f32(t3, rows[i].w));
+			vst1q_f32(&c.rows[i].x, r);
+		}
+#else
+		for(int i = 0; i < 3; i++)
+		{
+			const vec4& a = rows[i];
+			c.rows[i] = t.rows[0] * a.x + t.rows[1] * a.y + t.rows[2] * a.z + vec4(0, 0, 0, 1) * a.w;
+		}
+#endif
+		return c;
+	}
+
+	Transform& operator*=(const Transform& t)
+	{
+		return *this = *this * t;
+	}
+
+	// the transformed point (w = 1) or direction (w = 0)
+	vec4 operator*(const vec4& v) const
+	{
+		return vec4(rows[0].x * v.x + rows[0].y * v.y + rows[0].z * v.z + rows[0].w * v.w,
+			rows[1].x * v.x + rows[1].y * v.y + rows[1].z * v.z + rows[1].w * v.w,
+			rows[2].x * v.x + rows[2].y * v.y + rows[2].z * v.z + rows[2].w * v.w, v.w);
+	}
+
+	// inverse transpose of the 3x3 part, the matrix transforming the normals
+	mat3 normalMatrix() const
+	{
+		vec3 c0 = cross(rows[1], rows[2]);
+		vec3 c1 = cross(rows[2], rows[0]);
+		vec3 c2 = cross(rows[0], rows[1]);
+		float d = 1 / dot(vec3(rows[0].x, rows[0].y, rows[0].z), c0);
+		return mat3(c0 * d, c1 * d, c2 * d);
+	}
+
+	// the transformation undoing this one, the 3x3 inverse has the cofactor rows as its columns
+	Transform inverse() const
+	{
+		Transform r;
+#if defined(ANGEL_SSE)
+		__m128 r0 = _mm_loadu_ps(&rows[0].x);
+		__m128 r1 = _mm_loadu_ps(&rows[1].x);
+		__m128 r2 = _mm_loadu_ps(&rows[2].x);
+		__m128 c0 = crossRows(r1, r2);
+		__m128 c1 = crossRows(r2, r0);
+		__m128 c2 = crossRows(r0, r1);
+
+		// 1 / determinant in every lane, the w lanes of the cofactors are 0
+		__m128 p = _mm_mul_ps(r0, c0);
+		p = _mm_add_ps(p, ANGEL_SWIZZLE(p, 1, 0, 3, 2));
+		p = _mm_add_ps(p, ANGEL_SWIZZLE(p, 2, 3, 0, 1));
+		__m128 d = _mm_div_ps(_mm_set1_ps(1), p);
+		c0 = _mm_mul_ps(c0, d);
+		c1 = _mm_mul_ps(c1, d);
+		c2 = _mm_mul_ps(c2, d);
+
+		// the translation moved back, then the columns turned into rows
+		__m128 t = _mm_mul_ps(c0, ANGEL_SWIZZLE(r0, 3, 3, 3, 3));
+		t = _mm_add_ps(t, _mm_mul_ps(c1, ANGEL_SWIZZLE(r1, 3, 3, 3, 3)));
+		t = _mm_add_ps(t, _mm_mul_ps(c2, ANGEL_SWIZZLE(r2, 3, 3, 3, 3)));
+		t = _mm_sub_ps(_mm_setzero_ps(), t);
+		_MM_TRANSPOSE4_PS(c0, c1, c2, t);
+		_mm_storeu_ps(&r.rows[0].x, c0);
+		_mm_storeu_ps(&r.rows[1].x, c1);
+		_mm_storeu_ps(&r.rows[2].x, c2);
+#else
+		vec3 c0 = cross(rows[1], rows[2]);
+		vec3 c1 = cross(rows[2], rows[0]);
+		vec3 c2 = cross(rows[0], rows[1]);
+		float d = 1 / dot(vec3(rows[0].x, rows[0].y, rows[0].z), c0);
+		c0 *= d;
+		c1 *= d;
+		c2 *= d;
+		vec3 t = -(c0 * rows[0].w + c1 * rows[1].w + c2 * rows[2].w);
+		for(int i = 0; i < 3; i++)
+		{
+			r.rows[i] = vec4(c0[i], c1[i], c2[i], t[i]);
+		}
+#endif
+		return r;
+	}
+
+private:
+#if defined(ANGEL_SSE)
+	// cross product of the xyz parts, w is 0
+	static __m128 crossRows(__m128 a, __m128 b)
+	{
+		return _mm_sub_ps(_mm_mul_ps(ANGEL_SWIZZLE(a, 1, 2, 0, 3), ANGEL_SWIZZLE(b, 2, 0, 1, 3)),
+			_mm_mul_ps(ANGEL_SWIZZLE(a, 2, 0, 1, 3), ANGEL_SWIZZLE(b, 1, 2, 0, 3)));
+	}
+#endif
+};
+
+// the matrix followed by the transformation, where a transform meets the view or the projection
+inline mat4 operator*(const mat4& m, const Transform& t)
+{
+	return m * t.toMat4();
+}
+
+#endif // __TRANSFORM_H__
@@ -9,6 +9,62 @@
 
 #include "Angel.h"
 
+//
+//  --- SIMD support ---
+//
+//  The mat4 kernels use SSE (and AVX when compiled for it) on x86 and NEON
+//  on ARM, plain C++ elsewhere or when ANGEL_NO_SIMD is defined.  vec4 is
+//  aligned to 16 bytes, except for 32-bit Visual C++ which can't pass
+//  aligned types by value as std::vector does; the kernels use unaligned
+//  loads so either works.
+//
+
+#if !defined(ANGEL_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#  define ANGEL_SSE
+#  include <xmmintrin.h>
+#  ifdef __AVX__
+#    define ANGEL_AVX
+#    include <immintrin.h>
+#  endif
+#elif !defined(ANGEL_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#  define ANGEL_NEON
+#  include <arm_neon.h>
+#endif
+
+//
+//  --- Compile-time evaluation ---
+//
+//  The types are trivially copyable and their constructors and operators
+//  constexpr, so constant vectors and transforms fold at compile time.
+//  ANGEL_RUNTIME() tells the constexpr functions using the SIMD kernels or
+//  the math library whether they run at run time; without a compiler
+//  builtin to tell, they always take their plain constexpr path.
+//
+
+#if defined(__has_builtin)
+#  if __has_builtin(__builtin_is_constant_evaluated)
+#    define ANGEL_RUNTIME() (!__builtin_is_constant_evaluated())
+#  endif
+#endif
+#if !defined(ANGEL_RUNTIME) && defined(_MSC_VER) && _MSC_VER >= 1925
+#  define ANGEL_RUNTIME() (!__builtin_is_constant_evaluated())
+#endif
+#ifndef ANGEL_RUNTIME
+#  define ANGEL_RUNTIME() false
+#endif
+
+#if defined(_MSC_VER) && !defined(_WIN64)
+#  define ANGEL_ALIGN16
+#elif defined(_MSC_VER)
+#  define ANGEL_ALIGN16 __declspec(align(16))
+#else
+#  define ANGEL_ALIGN16 __attribute__((aligned(16)))
+#endif
+
+#ifdef ANGEL_EXPRESSION_TEMPLATES
+#include "vecexpr.h"
+#endif
+
 namespace Angel {
 
 //////////////////////////////////////////////////////////////////////////////
@@ -25,14 +81,17 @@ struct vec2 {
     //  --- Constructors and Destructors ---
     //
 
-    vec2( GLfloat s = GLfloat(0.0) ) :
+    constexpr vec2( GLfloat s = GLfloat(0.0) ) :
 	x(s), y(s) {}
 
-    vec2( GLfloat x, GLfloat y ) :
+    constexpr vec2( GLfloat x, GLfloat y ) :
 	x(x), y(y) {}
 
-    vec2( const vec2& v )
-	{ x = v.x;  y = v.y;  }
+#ifdef ANGEL_EXPRESSION_TEMPLATES
+    template< class E, class = typename VecExpression<E, 2>::type >
+    constexpr vec2( const E& e ) :  // evaluate the expression
+	x(e.at(0)), y(e.at(1)) {}
+#endif // ANGEL_EXPRESSION_TEMPLATES
 
     //
     //  --- Indexing Operator ---
@@ -45,22 +104,24 @@ struct vec2 {
     //  --- (non-modifying) Arithematic Operators ---
     //
 
-    vec2 operator - () const // unary minus operator
+#ifndef ANGEL_EXPRESSION_TEMPLATES
+
+    constexpr vec2 operator - () const // unary minus operator
 	{ return vec2( -x, -y ); }
 
-    vec2 operator + ( const vec2& v ) const
+    constexpr vec2 operator + ( const vec2& v ) const
 	{ return vec2( x + v.x, y + v.y ); }
 
-    vec2 operator - ( const vec2& v ) const
+    constexpr vec2 operator - ( const vec2& v ) const
 	{ return vec2( x - v.x, y - v.y ); }
 
-    vec2 operator * ( const GLfloat s ) const
+    constexpr vec2 operator * ( const GLfloat s ) const
 	{ return vec2( s*x, s*y ); }
 
-    vec2 operator * ( const vec2& v ) const
+    constexpr vec2 operator * ( const vec2& v ) const
 	{ return vec2( x*v.x, y*v.y ); }
 
-    friend vec2 operator * ( const GLfloat s, const vec2& v )
+    friend constexpr vec2 operator * ( const GLfloat s, const vec2& v )
 	{ return v * s; }
 
     vec2 operator / ( const GLfloat s ) const {
@@ -76,6 +137,8 @@ struct vec2 {
 	return *this * r;
     }
 
+#endif // ANGEL_EXPRESSION_TEMPLATES
+
     //
     //  --- (modifying) Arithematic Operators ---
     //
@@ -164,15 +227,20 @@ struct vec3 {
     //  --- Constructors and Destructors ---
     //
 
-    vec3( GLfloat s = GLfloat(0.0) ) :
+    constexpr vec3( GLfloat s = GLfloat(0.0) ) :
 	x(s), y(s), z(s) {}
 
-    vec3( GLfloat x, GLfloat y, GLfloat z ) :
+    constexpr vec3( GLfloat x, GLfloat y, GLfloat z ) :
 	x(x), y(y), z(z) {}
 
-    vec3( const vec3& v ) { x = v.x;  y = v.y;  z = v.z; }
+    constexpr vec3( const vec2& v, const float f ) :
+	x(v.x), y(v.y), z(f) {}
 
-    vec3( const vec2& v, const float f ) { x = v.x;  y = v.y;  z = f; }
+#ifdef ANGEL_EXPRESSION_TEMPLATES
+    template< class E, class = typename VecExpression<E, 3>::type >
+    constexpr vec3( const E& e ) :  // evaluate the expression
+	x(e.at(0)), y(e.at(1)), z(e.at(2)) {}
+#endif // ANGEL_EXPRESSION_TEMPLATES
 
     //
     //  --- Indexing Operator ---
@@ -185,22 +253,24 @@ struct vec3 {
     //  --- (non-modifying) Arithematic Operators ---
     //
 
-    vec3 operator - () const  // unary minus operator
+#ifndef ANGEL_EXPRESSION_TEMPLATES
+
+    constexpr vec3 operator - () const  // unary minus operator
 	{ return vec3( -x, -y, -z ); }
 
-    vec3 operator + ( const vec3& v ) const
+    constexpr vec3 operator + ( const vec3& v ) const
 	{ return vec3( x + v.x, y + v.y, z + v.z ); }
 
-    vec3 operator - ( const vec3& v ) const
+    constexpr vec3 operator - ( const vec3& v ) const
 	{ return vec3( x - v.x, y - v.y, z - v.z ); }
 
-    vec3 operator * ( const GLfloat s ) const
+    constexpr vec3 operator * ( const GLfloat s ) const
 	{ return vec3( s*x, s*y, s*z ); }
 
-    vec3 operator * ( const vec3& v ) const
+    constexpr vec3 operator * ( const vec3& v ) const
 	{ return vec3( x*v.x, y*v.y, z*v.z ); }
 
-    friend vec3 operator * ( const GLfloat s, const vec3& v )
+    friend constexpr vec3 operator * ( const GLfloat s, const vec3& v )
 	{ return v * s; }
 
     vec3 operator / ( const GLfloat s ) const {
@@ -216,6 +286,8 @@ struct vec3 {
 	return *this * r;
     }
 
+#endif // ANGEL_EXPRESSION_TEMPLATES
+
     //
     //  --- (modifying) Arithematic Operators ---
     //
@@ -303,7 +375,7 @@ vec3 cross(const vec3& a, const vec3& b )
 //
 //////////////////////////////////////////////////////////////////////////////
 
-struct vec4 {
+struct ANGEL_ALIGN16 vec4 {
 
     GLfloat  x;
     GLfloat  y;
@@ -314,19 +386,27 @@ struct vec4 {
     //  --- Constructors and Destructors ---
     //
 
-    vec4( GLfloat s = GLfloat(0.0) ) :
+    constexpr vec4( GLfloat s = GLfloat(0.0) ) :
 	x(s), y(s), z(s), w(s) {}
 
-    vec4( GLfloat x, GLfloat y, GLfloat z, GLfloat w ) :
+    constexpr vec4( GLfloat x, GLfloat y, GLfloat z, GLfloat w ) :
 	x(x), y(y), z(z), w(w) {}
 
-    vec4( const vec4& v ) { x = v.x;  y = v.y;  z = v.z;  w = v.w; }
+    constexpr vec4( const vec3& v, const float w = 1.0 ) :
+	x(v.x), y(v.y), z(v.z), w(w) {}
+
+    constexpr vec4( const vec2& v, const float z, const float w ) :
+	x(v.x), y(v.y), z(z), w(w) {}
 
-    vec4( const vec3& v, const float w = 1.0 ) : w(w)
-	{ x = v.x;  y = v.y;  z = v.z; }
+#ifdef ANGEL_EXPRESSION_TEMPLATES
+    template< class E, class = typename VecExpression<E, 4>::type >
+    constexpr vec4( const E& e ) :  // evaluate the expression
+	x(e.at(0)), y(e.at(1)), z(e.at(2)), w(e.at(3)) {}
 
-    vec4( const vec2& v, const float z, const float w ) : z(z), w(w)
-	{ x = v.x;  y = v.y; }
+    template< class E, class = typename VecExpression<E, 3>::type >
+    constexpr vec4( const E& e, const float w = 1.0 ) :
+	x(e.at(0)), y(e.at(1)), z(e.at(2)), w(w) {}
+#endif // ANGEL_EXPRESSION_TEMPLATES
 
     //
     //  --- Indexing Operator ---
@@ -339,22 +419,24 @@ struct vec4 {
     //  --- (non-modifying) Arithematic Operators ---
     //
 
-    vec4 operator - () const  // unary minus operator
+#ifndef ANGEL_EXPRESSION_TEMPLATES
+
+    constexpr vec4 operator - () const  // unary minus operator
 	{ return vec4( -x, -y, -z, -w ); }
 
-    vec4 operator + ( const vec4& v ) const
+    constexpr vec4 operator + ( const vec4& v ) const
 	{ return vec4( x + v.x, y + v.y, z + v.z, w + v.w ); }
 
-    vec4 operator - ( const vec4& v ) const
+    constexpr vec4 operator - ( const vec4& v ) const
 	{ return vec4( x - v.x, y - v.y, z - v.z, w - v.w ); }
 
-    vec4 operator * ( const GLfloat s ) const
+    constexpr vec4 operator * ( const GLfloat s ) const
 	{ return vec4( s*x, s*y, s*z, s*w ); }
 
-    vec4 operator * ( const vec4& v ) const
-	{ return vec4( x*v.x, y*v.y, z*v.z, w*v.z ); }
+    constexpr vec4 operator * ( const vec4& v ) const
+	{ return vec4( x*v.x, y*v.y, z*v.z, w*v.w ); }
 
-    friend vec4 operator * ( const GLfloat s, const vec4& v )
+    friend constexpr vec4 operator * ( const GLfloat s, const vec4& v )
 	{ return v * s; }
 
     vec4 operator / ( const GLfloat s ) const {
@@ -370,6 +452,8 @@ struct vec4 {
 	return *this * r;
     }
 
+#endif // ANGEL_EXPRESSION_TEMPLATES
+
     //
     //  --- (modifying) Arithematic Operators ---
     //
@@ -0,0 +1,248 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- vecexpr.h ---
+//
+//   Expression templates for the vector arithmetic, enabled by defining
+//   ANGEL_EXPRESSION_TEMPLATES before including Angel.h.  The +, -, * and /
+//   operators of vec2, vec3 and vec4 then build expression nodes instead of
+//   vectors, and a whole chain such as  a * b * s + c  is evaluated once per
+//   component when it is assigned to a vector, without the temporaries.  The
+//   components are computed in the order of the plain operators, so the
+//   results are the same either way.
+//
+//   The nodes refer to the vectors they combine, so an expression must be
+//   turned into a vector before the end of the statement:  auto e = a + b
+//   keeps references to a and b.  The matrix products still evaluate at
+//   once through the mat4 kernels, their operands being converted first.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __ANGEL_VECEXPR_H__
+#define __ANGEL_VECEXPR_H__
+
+#include <type_traits>
+
+namespace Angel {
+
+struct vec2;
+struct vec3;
+struct vec4;
+
+//
+//  --- Operand traits ---
+//
+//  size is the number of components, 0 for anything that is not a vector
+//  or an expression.  Vectors are held by reference, the nodes by value.
+//
+
+template< class T >
+struct VecTraits {
+    enum { size = 0, expression = 0 };
+};
+
+template<>
+struct VecTraits<vec2> {
+    enum { size = 2, expression = 0 };
+    typedef const vec2&  operand;
+    template< class V >
+    static constexpr GLfloat at( const V& v, int i )
+	{ return i == 0 ? v.x : v.y; }
+};
+
+template<>
+struct VecTraits<vec3> {
+    enum { size = 3, expression = 0 };
+    typedef const vec3&  operand;
+    template< class V >
+    static constexpr GLfloat at( const V& v, int i )
+	{ return i == 0 ? v.x : i == 1 ? v.y : v.z; }
+};
+
+template<>
+struct VecTraits<vec4> {
+    enum { size = 4, expression = 0 };
+    typedef const vec4&  operand;
+    template< class V >
+    static constexpr GLfloat at( const V& v, int i )
+	{ return i == 0 ? v.x : i == 1 ? v.y : i == 2 ? v.z : v.w; }
+};
+
+//  The size of two operands of the same size, 0 for any other pair
+template< class A, class B >
+struct VecPair {
+    enum { size = int(VecTraits<A>::size) != 0 &&
+	   int(VecTraits<A>::size) == int(VecTraits<B>::size) ? int(VecTraits<A>::size) : 0 };
+};
+
+//
+//  --- Expression nodes ---
+//
+
+struct VecAdd {
+    static constexpr GLfloat apply( GLfloat a, GLfloat b ) { return a + b; }
+};
+
+struct VecSub {
+    static constexpr GLfloat apply( GLfloat a, GLfloat b ) { return a - b; }
+};
+
+struct VecMul {
+    static constexpr GLfloat apply( GLfloat a, GLfloat b ) { return a * b; }
+};
+
+//  Component-wise a op b
+template< class Op, class A, class B >
+struct VecBinary {
+    typename VecTraits<A>::operand  a;
+    typename VecTraits<B>::operand  b;
+
+    constexpr VecBinary( const A& a, const B& b ) : a(a), b(b) {}
+
+    constexpr GLfloat at( int i ) const
+	{ return Op::apply( VecTraits<A>::at( a, i ), VecTraits<B>::at( b, i ) ); }
+};
+
+//  Every component of a vector times the scalar, s * v
+template< class A >
+struct VecScale {
+    typename VecTraits<A>::operand  a;
+    GLfloat  s;
+
+    constexpr VecScale( const A& a, GLfloat s ) : a(a), s(s) {}
+
+    constexpr GLfloat at( int i ) const
+	{ return s * VecTraits<A>::at( a, i ); }
+};
+
+template< class A >
+struct VecNegate {
+    typename VecTraits<A>::operand  a;
+
+    constexpr VecNegate( const A& a ) : a(a) {}
+
+    constexpr GLfloat at( int i ) const
+	{ return -VecTraits<A>::at( a, i ); }
+};
+
+template< class Op, class A, class B >
+struct VecTraits< VecBinary<Op, A, B> > {
+    enum { size = VecPair<A, B>::size, expression = 1 };
+    typedef VecBinary<Op, A, B>  operand;
+    template< class E >
+    static constexpr GLfloat at( const E& e, int i ) { return e.at( i ); }
+};
+
+template< class A >
+struct VecTraits< VecScale<A> > {
+    enum { size = VecTraits<A>::size, expression = 1 };
+    typedef VecScale<A>  operand;
+    template< class E >
+    static constexpr GLfloat at( const E& e, int i ) { return e.at( i ); }
+};
+
+template< class A >
+struct VecTraits< VecNegate<A> > {
+    enum { size = VecTraits<A>::size, expression = 1 };
+    typedef VecNegate<A>  operand;
+    template< class E >
+    static constexpr GLfloat at( const E& e, int i ) { return e.at( i ); }
+};
+
+//  An expression of n components, for the converting constructors
+template< class E, int n >
+struct VecExpression
+    : std::enable_if< VecTraits<E>::expression && VecTraits<E>::size == n > {};
+
+//
+//  --- Operators ---
+//
+
+template< class A, class B >
+constexpr typename std::enable_if< VecPair<A, B>::size != 0, VecBinary<VecAdd, A, B> >::type
+operator + ( const A& a, const B& b )
+    { return VecBinary<VecAdd, A, B>( a, b ); }
+
+template< class A, class B >
+constexpr typename std::enable_if< VecPair<A, B>::size != 0, VecBinary<VecSub, A, B> >::type
+operator - ( const A& a, const B& b )
+    { return VecBinary<VecSub, A, B>( a, b ); }
+
+template< class A, class B >
+constexpr typename std::enable_if< VecPair<A, B>::size != 0, VecBinary<VecMul, A, B> >::type
+operator * ( const A& a, const B& b )
+    { return VecBinary<VecMul, A, B>( a, b ); }
+
+template< class A >
+constexpr typename std::enable_if< VecTraits<A>::size != 0, VecScale<A> >::type
+operator * ( const A& a, const GLfloat s )
+    { return VecScale<A>( a, s ); }
+
+template< class A >
+constexpr typename std::enable_if< VecTraits<A>::size != 0, VecScale<A> >::type
+operator * ( const GLfloat s, const A& a )
+    { return VecScale<A>( a, s ); }
+
+template< class A >
+typename std::enable_if< VecTraits<A>::size != 0, VecScale<A> >::type
+operator / ( const A& a, const GLfloat s ) {
+#ifdef DEBUG
+    if ( std::fabs(s) < DivideByZeroTolerance ) {
+	std::cerr << "[" << __FILE__ << ":" << __LINE__ << "] "
+		  << "Division by zero" << std::endl;
+	return VecScale<A>( a, GLfloat(0.0) );
+    }
+#endif // DEBUG
+
+    return VecScale<A>( a, GLfloat(1.0) / s );
+}
+
+template< class A >
+constexpr typename std::enable_if< VecTraits<A>::size != 0, VecNegate<A> >::type
+operator - ( const A& a )
+    { return VecNegate<A>( a ); }
+
+//
+//  --- Functions ---
+//
+//  The functions overloaded for several vector types would be ambiguous
+//  for an expression, it converts to more than one of them.  These take
+//  the expressions, evaluate them and call the vector version.
+//
+
+template< int n >
+struct VecOfSize { typedef void type; };
+
+template<> struct VecOfSize<2> { typedef vec2 type; };
+template<> struct VecOfSize<3> { typedef vec3 type; };
+template<> struct VecOfSize<4> { typedef vec4 type; };
+
+//  The vector type of an expression
+template< class E >
+struct VecValue
+    : std::enable_if< VecTraits<E>::expression, typename VecOfSize<VecTraits<E>::size>::type > {};
+
+//  The vector type of two operands of one size, at least one an expression
+template< class A, class B >
+struct VecMixed
+    : std::enable_if< VecPair<A, B>::size != 0 && (VecTraits<A>::expression || VecTraits<B>::expression),
+		      typename VecOfSize<VecPair<A, B>::size>::type > {};
+
+template< class A, class B, class V = typename VecMixed<A, B>::type >
+inline GLfloat dot( const A& a, const B& b )
+    { return dot( V( a ), V( b ) ); }
+
+template< class A, class B, class V = typename VecMixed<A, B>::type >
+inline auto cross( const A& a, const B& b ) -> decltype( cross( V( a ), V( b ) ) )
+    { return cross( V( a ), V( b ) ); }
+
+template< class E, class V = typename VecValue<E>::type >
+inline GLfloat length( const E& e )
+    { return length( V( e ) ); }
+
+template< class E, class V = typename VecValue<E>::type >
+inline V normalize( const E& e )
+    { return normalize( V( e ) ); }
+
+}  // namespace Angel
+
+#endif // __ANGEL_VECEXPR_H__
@@ -0,0 +1,21 @@
+#version 120
+
+// vertex attributes (position in pixels from the top left corner, atlas coordinates, color)
+attribute vec2 vPosition;
+attribute vec2 vTexture;
+attribute vec4 vColor;
+
+varying vec2 fTexture; // to send to the fragment shader
+varying vec4 fColor;   // to send to the fragment shader
+
+uniform vec2 screen_size; // window size in pixels
+
+void main()
+{
+	// pixels to normalized device coordinates
+	gl_Position = vec4(vPosition.x * 2.0 / screen_size.x - 1.0, 1.0 - vPosition.y * 2.0 / screen_size.y, 0.0, 1.0);
+
+	// send to the fragment shader
+	fTexture = vTexture;
+	fColor = vColor;
+}
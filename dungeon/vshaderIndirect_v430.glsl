@@ -0,0 +1,48 @@
+#version 430
+#extension GL_ARB_shader_draw_parameters : require
+
+// vertex attributes (position, normal, texture coordinates)
+layout(location = 0) in vec3 vPosition;
+layout(location = 1) in vec3 vNormal;
+layout(location = 2) in vec2 vTexture;
+
+out vec3 fPosition;     // position in camera space, interpolated along the way
+out vec3 fNormal;       // normal in camera space, interpolated along the way
+out vec2 fTexture;      // to send to the fragment shader, interpolated along the way
+flat out int fDrawID;   // draw index for the per draw data
+
+// per draw data, one entry per object
+struct DrawData
+{
+	mat4 modelMatrix;
+	vec4 ambient, diffuse, specular;
+	float shininess;
+	int layer;
+};
+layout(std430, row_major, binding = 0) readonly buffer Draws
+{
+	DrawData draws[];
+};
+
+// per frame data, camera and lighting stuff for 2 lights
+layout(std140, row_major, binding = 0) uniform Frame
+{
+	mat4 view_matrix; // view matrix
+	mat4 proj_matrix; // projection matrix
+	vec4 LightAmbient[2], LightDiffuse[2], LightSpecular[2], LightPosition[2];
+	vec4 spotDirection;
+};
+
+void main() 
+{
+	// object coordinates to camera coordinates for this draw
+	mat4 modelview_matrix = view_matrix * draws[gl_DrawIDARB].modelMatrix;
+	vec4 posInCam = modelview_matrix * vec4(vPosition, 1.0);
+	gl_Position = proj_matrix * posInCam;
+
+	// send to the fragment shader
+	fPosition = posInCam.xyz;
+	fNormal = (modelview_matrix * vec4(vNormal, 0.0)).xyz;
+	fTexture = vTexture;
+	fDrawID = gl_DrawIDARB;
+}